@@ -0,0 +1,13 @@
+#include "anomaly_detector.h"
+
+#include <algorithm>
+#include <atomic>
+
+// 20 until detection profiles set it
+static std::atomic<std::size_t> minPoints{20};
+
+void setMinBaselinePoints(std::size_t n) {
+    minPoints.store(std::max<std::size_t>(n, 2), std::memory_order_relaxed);
+}
+
+std::size_t minBaselinePoints() { return minPoints.load(std::memory_order_relaxed); }
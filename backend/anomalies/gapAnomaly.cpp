@@ -0,0 +1,108 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+For each bar, gap = open − previous bar close.
+Bars normally open right where the last one closed, so gaps hover around zero.
+
+Keep a rolling history of gaps for the symbol (running sums, no rescans).
+
+Trigger when the newest gap is far from normal:
+If newGap > avgGap + k × stdevGap, it gapped up.
+If newGap < avgGap − k × stdevGap, it gapped down.
+
+*/
+
+std::optional<Anomaly>
+detectGapAnomaly(const std::string &symbol,
+                 const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastBar.has_value() || !state.lastGap.has_value()) {
+        return std::nullopt;
+    }
+
+    const double newGap = state.lastGap.value();
+    const double open = state.lastBar.value().open;
+    const double prevClose = open - newGap;
+    const auto &gaps = state.barGaps;
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (gaps.size() < minPoints) {
+        return std::nullopt;
+    }
+
+    const double avgGap = gaps.mean();
+    const double stdev = gaps.stdev();
+
+    constexpr double EPS = 1e-9;
+    if (stdev <= EPS) {
+        return std::nullopt;
+    }
+
+    if (newGap > avgGap + (k * stdev)) {
+        Anomaly newAnomaly;
+        newAnomaly.points = gaps.size();
+        newAnomaly.type = AnomalyType::Gap;
+        newAnomaly.source = SourceType::Bar;
+        newAnomaly.direction = Direction::Up;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = state.lastBarNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+        newAnomaly.value = newGap;
+        newAnomaly.mean = avgGap;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = (newGap - avgGap) / stdev;
+
+        newAnomaly.lower = avgGap - (k * stdev);
+        newAnomaly.upper = avgGap + (k * stdev);
+        newAnomaly.k = k;
+
+        newAnomaly.note =
+            "Gap up anomaly: " + symbol + " opened at " + std::to_string(open) +
+            " after the previous bar closed at " + std::to_string(prevClose) + ", a gap of " +
+            std::to_string(newGap) + " (" + std::to_string(newAnomaly.zscore) +
+            " standard deviations). "
+            "This suggests the price jumped without trading through the levels in between, "
+            "which usually happens when news lands while trading is thin or paused.";
+
+        return newAnomaly;
+    } else if (newGap < avgGap - (k * stdev)) {
+        Anomaly newAnomaly;
+        newAnomaly.points = gaps.size();
+        newAnomaly.type = AnomalyType::Gap;
+        newAnomaly.source = SourceType::Bar;
+        newAnomaly.direction = Direction::Down;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = state.lastBarNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+        newAnomaly.value = newGap;
+        newAnomaly.mean = avgGap;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = (newGap - avgGap) / stdev;
+
+        newAnomaly.lower = avgGap - (k * stdev);
+        newAnomaly.upper = avgGap + (k * stdev);
+        newAnomaly.k = k;
+
+        newAnomaly.note =
+            "Gap down anomaly: " + symbol + " opened at " + std::to_string(open) +
+            " after the previous bar closed at " + std::to_string(prevClose) + ", a gap of " +
+            std::to_string(newGap) + " (" + std::to_string(-newAnomaly.zscore) +
+            " standard deviations). "
+            "This suggests the price dropped without trading through the levels in between, "
+            "which usually happens when bad news lands while trading is thin or paused.";
+
+        return newAnomaly;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,84 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+For each quote update, depth = bid_size + ask_size
+(the number of shares displayed at the best bid and ask).
+
+Keep a rolling history of depth for the symbol (running sums, no rescans).
+
+Only the collapse side matters here, a thin book is what makes prices jumpy:
+If newDepth < avgDepth − k × stdevDepth, displayed liquidity has dried up.
+
+*/
+
+std::optional<Anomaly>
+detectLiquidityAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastQuote.has_value()) {
+        return std::nullopt;
+    }
+
+    const Quote &quote = state.lastQuote.value();
+    if (quote.bid_size <= 0 || quote.ask_size <= 0) {
+        return std::nullopt;
+    }
+
+    const double newDepth = static_cast<double>(quote.bid_size + quote.ask_size);
+    const auto &depths = state.quoteDepths;
+    const bool timed = windowMode(AnomalyType::Liquidity) == WindowMode::Time;
+    const std::size_t points = timed ? state.timedDepths.size() : depths.size();
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (points < minPoints) {
+        return std::nullopt;
+    }
+
+    const double avgDepth = timed ? state.timedDepths.mean() : depths.mean();
+    const double stdev = timed ? state.timedDepths.stdev() : depths.stdev();
+
+    constexpr double EPS = 1e-9;
+    if (stdev <= EPS) {
+        return std::nullopt;
+    }
+
+    if (newDepth < avgDepth - (k * stdev)) {
+        Anomaly newAnomaly;
+        newAnomaly.points = points;
+        newAnomaly.type = AnomalyType::Liquidity;
+        newAnomaly.source = SourceType::Quote;
+        newAnomaly.direction = Direction::Down;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = state.lastQuoteNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+        newAnomaly.value = newDepth;
+        newAnomaly.mean = avgDepth;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = (newDepth - avgDepth) / stdev;
+
+        newAnomaly.lower = avgDepth - (k * stdev);
+        newAnomaly.upper = avgDepth + (k * stdev);
+        newAnomaly.k = k;
+
+        newAnomaly.note =
+            "Liquidity collapse anomaly: " + symbol + " is showing only " +
+            std::to_string(quote.bid_size) + " shares bid and " + std::to_string(quote.ask_size) +
+            " shares offered at the top of the book, well below the recent average depth of " +
+            std::to_string(avgDepth) + " (" + std::to_string(-newAnomaly.zscore) +
+            " standard deviations). "
+            "This suggests market makers have pulled back, so even modest orders can move the "
+            "price more than usual.";
+
+        return newAnomaly;
+    }
+    return std::nullopt;
+}
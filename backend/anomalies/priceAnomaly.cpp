@@ -37,13 +37,17 @@ detectPriceAnomaly(const std::string &symbol,
     const double newPrice = state.lastTrade.value().price;
     const auto &prices = state.prices;
 
-    constexpr std::size_t MIN_POINTS = 20;
-    if (prices.size() < MIN_POINTS) {
+    const bool timed = windowMode(AnomalyType::Price) == WindowMode::Time;
+    const std::size_t points = timed ? state.timedPrices.size() : prices.size();
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (points < minPoints) {
         return std::nullopt;
     }
 
-    double avgPrice = averagePriceOfRecentTrades(symbol, bySymbol);
-    double stdev = calcSTDEV<double>(prices);
+    double avgPrice =
+        timed ? state.timedPrices.mean() : averagePriceOfRecentTrades(symbol, bySymbol);
+    double stdev = timed ? state.timedPrices.stdev() : calcSTDEV<double>(prices);
 
     constexpr double EPS = 1e-9;
     if (stdev <= EPS) {
@@ -52,12 +56,14 @@ detectPriceAnomaly(const std::string &symbol,
 
     if (newPrice > avgPrice + (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Price;
         newAnomaly.source = SourceType::Trade;
         newAnomaly.direction = Direction::Up;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastTradeTs;
+        newAnomaly.ts_ns = state.lastTradeNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = newPrice;
         newAnomaly.mean = avgPrice;
@@ -80,12 +86,14 @@ detectPriceAnomaly(const std::string &symbol,
         return newAnomaly;
     } else if (newPrice < avgPrice - (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Price;
         newAnomaly.source = SourceType::Trade;
         newAnomaly.direction = Direction::Down;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastTradeTs;
+        newAnomaly.ts_ns = state.lastTradeNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = newPrice;
         newAnomaly.mean = avgPrice;
@@ -0,0 +1,91 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+For each bar, range = high − low (how far the price travelled inside that bar).
+
+Keep a rolling history of bar ranges for the symbol (running sums, no rescans).
+
+Trigger when the newest range is much wider than usual:
+If newRange > avgRange + k × stdevRange, the bar was unusually wide.
+
+The body (close − open) tells us whether the bar went somewhere or just whipsawed.
+
+*/
+
+std::optional<Anomaly>
+detectRangeAnomaly(const std::string &symbol,
+                   const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastBar.has_value()) {
+        return std::nullopt;
+    }
+
+    const Bar &bar = state.lastBar.value();
+    if (bar.high <= 0.0 || bar.low <= 0.0 || bar.high < bar.low) {
+        return std::nullopt;
+    }
+
+    const double newRange = bar.range();
+    const auto &ranges = state.barRanges;
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (ranges.size() < minPoints) {
+        return std::nullopt;
+    }
+
+    const double avgRange = ranges.mean();
+    const double stdev = ranges.stdev();
+
+    constexpr double EPS = 1e-9;
+    if (stdev <= EPS) {
+        return std::nullopt;
+    }
+
+    if (newRange > avgRange + (k * stdev)) {
+        Anomaly newAnomaly;
+        newAnomaly.points = ranges.size();
+        newAnomaly.type = AnomalyType::Range;
+        newAnomaly.source = SourceType::Bar;
+        newAnomaly.direction = Direction::Up;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = state.lastBarNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+        newAnomaly.value = newRange;
+        newAnomaly.mean = avgRange;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = (newRange - avgRange) / stdev;
+
+        newAnomaly.lower = avgRange - (k * stdev);
+        newAnomaly.upper = avgRange + (k * stdev);
+        newAnomaly.k = k;
+
+        // a small body inside a wide range means the bar whipsawed rather than trended
+        const double bodyShare = std::abs(bar.body()) / newRange;
+        const std::string shape =
+            bodyShare < 0.3 ? "most of that move was given back before the close"
+                            : "the bar closed " + std::string(bar.body() >= 0.0 ? "up " : "down ") +
+                                  std::to_string(std::abs(bar.body())) + " from its open";
+
+        newAnomaly.note =
+            "Wide range anomaly: " + symbol + " moved " + std::to_string(newRange) +
+            " between its high and low in one bar across " + std::to_string(bar.trade_count) +
+            " trades, above the recent average range " + std::to_string(avgRange) + " (" +
+            std::to_string(newAnomaly.zscore) + " standard deviations), and " + shape +
+            (bar.vwap.has_value() ? " (bar VWAP " + std::to_string(*bar.vwap) + ")" : "") +
+            ". "
+            "This suggests an unusually turbulent interval, which can happen when large orders "
+            "sweep the book or news causes a burst of repricing.";
+
+        return newAnomaly;
+    }
+    return std::nullopt;
+}
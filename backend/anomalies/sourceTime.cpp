@@ -0,0 +1,25 @@
+#include "anomaly_detector.h"
+
+#include <algorithm>
+
+std::int64_t detectorSourceNs(AnomalyType type, const SymbolState &state) {
+    switch (type) {
+    case AnomalyType::Price:
+    case AnomalyType::TradeSize:
+    case AnomalyType::TradeFlow:
+    case AnomalyType::Vwap:
+        return state.lastTradeNs;
+    case AnomalyType::Spread:
+    case AnomalyType::Liquidity:
+        return state.lastQuoteNs;
+    case AnomalyType::Volume:
+    case AnomalyType::Range:
+    case AnomalyType::Gap:
+        return state.lastBarNs;
+    case AnomalyType::Volatility:
+        // scores trade returns first and falls back to bar closes
+        return std::max(state.lastTradeNs, state.lastBarNs);
+    default:
+        return state.lastEventNs;
+    }
+}
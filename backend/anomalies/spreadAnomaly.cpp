@@ -66,13 +66,17 @@ detectSpreadAnomaly(const std::string &symbol,
     const double newSpread = ap - bp;
     const auto &spreads = state.spreads;
 
-    constexpr std::size_t MIN_POINTS = 20;
-    if (spreads.size() < MIN_POINTS) {
+    const bool timed = windowMode(AnomalyType::Spread) == WindowMode::Time;
+    const std::size_t points = timed ? state.timedSpreads.size() : spreads.size();
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (points < minPoints) {
         return std::nullopt;
     }
 
-    double avgSpread = averageSpreadOfRecentQuotes(symbol, bySymbol);
-    double stdev = calcSTDEV<double>(spreads);
+    double avgSpread =
+        timed ? state.timedSpreads.mean() : averageSpreadOfRecentQuotes(symbol, bySymbol);
+    double stdev = timed ? state.timedSpreads.stdev() : calcSTDEV<double>(spreads);
 
     constexpr double EPS = 1e-9;
     if (stdev <= EPS) {
@@ -81,12 +85,14 @@ detectSpreadAnomaly(const std::string &symbol,
 
     if (newSpread > avgSpread + (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Spread;
         newAnomaly.source = SourceType::Quote;
         newAnomaly.direction = Direction::Up;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastQuoteTs;
+        newAnomaly.ts_ns = state.lastQuoteNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = newSpread;
         newAnomaly.mean = avgSpread;
@@ -109,12 +115,14 @@ detectSpreadAnomaly(const std::string &symbol,
         return newAnomaly;
     } else if (newSpread < avgSpread - (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Spread;
         newAnomaly.source = SourceType::Quote;
         newAnomaly.direction = Direction::Down;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastQuoteTs;
+        newAnomaly.ts_ns = state.lastQuoteNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = newSpread;
         newAnomaly.mean = avgSpread;
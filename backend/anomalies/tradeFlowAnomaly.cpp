@@ -0,0 +1,91 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+Sign every trade as a buy or a sell (see TradeFlow in data_parser.h): against the quote
+standing when it printed, above the mid is a buyer lifting the offer and below it a seller
+hitting the bid; at the mid, or before the first quote, fall back to the tick rule.
+
+imbalance = (buy volume − sell volume) / total volume over the last 50 classified trades,
+kept with running sums so each trade is O(1).
+
+Every imbalance the symbol has shown over the last N trades is the baseline:
+If imbalance > avg + k × stdev, buyers are pressing much harder than usual (Up).
+If imbalance < avg − k × stdev, sellers are (Down).
+
+*/
+
+std::optional<Anomaly>
+detectTradeFlowAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastTrade.has_value()) {
+        return std::nullopt;
+    }
+
+    const auto &flow = state.tradeFlow;
+    const auto &imbalances = flow.imbalances;
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (imbalances.size() < minPoints) {
+        return std::nullopt;
+    }
+
+    const double imbalance = flow.imbalance();
+    const double avgImbalance = imbalances.mean();
+    const double stdev = imbalances.stdev();
+
+    constexpr double EPS = 1e-9;
+    if (stdev <= EPS) {
+        return std::nullopt;
+    }
+
+    const double zscore = (imbalance - avgImbalance) / stdev;
+    if (std::abs(zscore) <= k) {
+        return std::nullopt;
+    }
+    const bool buying = zscore > 0.0;
+
+    Anomaly newAnomaly;
+    newAnomaly.points = imbalances.size();
+    newAnomaly.type = AnomalyType::TradeFlow;
+    newAnomaly.source = SourceType::Trade;
+    newAnomaly.direction = buying ? Direction::Up : Direction::Down;
+
+    newAnomaly.symbol = symbol;
+    newAnomaly.ts_ns = state.lastTradeNs;
+    newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+    newAnomaly.value = imbalance;
+    newAnomaly.mean = avgImbalance;
+    newAnomaly.stdev = stdev;
+    newAnomaly.zscore = zscore;
+
+    newAnomaly.lower = avgImbalance - (k * stdev);
+    newAnomaly.upper = avgImbalance + (k * stdev);
+    newAnomaly.k = k;
+
+    const double total = flow.sizes.sum;
+    const double bought = (total + flow.signedSizes.sum) / 2.0;
+    const double buyShare = total > 0.0 ? 100.0 * bought / total : 0.0;
+
+    newAnomaly.note =
+        std::string(buying ? "Buying pressure anomaly: " : "Selling pressure anomaly: ") +
+        symbol + " buyers initiated " + std::to_string(buyShare) +
+        "% of the volume over its last " + std::to_string(flow.sizes.size()) +
+        " trades, an imbalance of " +
+        std::to_string(imbalance) + " against a usual " + std::to_string(avgImbalance) + " (" +
+        std::to_string(zscore) + " standard deviations). " +
+        (buying ? "This suggests aggressive buyers are lifting offers, which often comes from "
+                  "a large order being worked or traders reacting to news."
+                : "This suggests aggressive sellers are hitting bids, which often comes from "
+                  "a large order being unwound or traders reacting to news.");
+
+    return newAnomaly;
+}
@@ -0,0 +1,93 @@
+#include "anomaly_detector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+/*
+
+Block trades.
+
+A 200-trade window says nothing about whether 50,000 shares is a lot for a name, so this one
+scores trade size against the long-horizon distribution in tradeSizeQuantiles (a t-digest that
+spans the session, and several sessions once snapshots carry it over).
+
+If size > quantile(p) for the configured percentile p (p99.9 by default), it is a block trade.
+
+The z-score is the normal-equivalent of the trade's percentile rank, Phi^-1(cdf(size)), so
+episodes, peaks and the dashboard compare it on the same scale as every other detector. That
+also means percentiles below Phi(k) (p97.7 at k = 2) fire but never open an episode.
+
+*/
+
+static std::atomic<double> percentile{0.999};
+
+void setTradeSizePercentile(double p) { percentile.store(std::clamp(p, 0.5, 0.99999)); }
+
+double tradeSizePercentile() { return percentile.load(); }
+
+std::optional<Anomaly>
+detectTradeSizeAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastTrade.has_value() || state.lastTrade->size <= 0) {
+        return std::nullopt;
+    }
+
+    const double p = tradeSizePercentile();
+    const auto &sizes = state.tradeSizeQuantiles;
+
+    // the tail needs a few observations beyond it before it means anything
+    const double minPoints = std::max(200.0, 2.0 / (1.0 - p));
+    if (sizes.count() < minPoints) {
+        return std::nullopt;
+    }
+
+    const double size = static_cast<double>(state.lastTrade->size);
+    const double threshold = sizes.quantile(p);
+    if (size <= threshold) {
+        return std::nullopt;
+    }
+
+    const double median = sizes.quantile(0.5);
+    const double rank = std::min(sizes.cdf(size), 1.0 - 0.5 / sizes.count());
+
+    Anomaly newAnomaly;
+
+    newAnomaly.points = static_cast<std::size_t>(sizes.count());
+    newAnomaly.type = AnomalyType::TradeSize;
+    newAnomaly.source = SourceType::Trade;
+    newAnomaly.direction = Direction::Up;
+
+    newAnomaly.symbol = symbol;
+    newAnomaly.ts_ns = state.lastTradeNs;
+    newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+    newAnomaly.value = size;
+    newAnomaly.mean = median;
+    newAnomaly.zscore = normalQuantile(rank);
+    newAnomaly.stdev = newAnomaly.zscore > 0.0 ? (size - median) / newAnomaly.zscore : 0.0;
+
+    newAnomaly.lower = sizes.min();
+    newAnomaly.upper = threshold;
+    newAnomaly.k = k;
+
+    char pct[16];
+    std::snprintf(pct, sizeof(pct), "p%g", p * 100.0);
+
+    newAnomaly.note =
+        "Block trade anomaly: " + symbol + " printed " + std::to_string(state.lastTrade->size) +
+        " shares in a single trade at $" + std::to_string(state.lastTrade->price) +
+        ", above the " + pct + " trade size of " +
+        std::to_string(threshold) + " shares (median " + std::to_string(median) + ", " +
+        std::to_string(static_cast<std::int64_t>(sizes.count())) +
+        " trades observed). "
+        "Prints this large usually come from institutions moving a position at once, and "
+        "often precede or confirm a bigger move.";
+
+    return newAnomaly;
+}
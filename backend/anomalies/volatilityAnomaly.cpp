@@ -0,0 +1,141 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+For every trade (and every bar close) take the log return against the previous print.
+Keep the squared returns over a short window (last 20 returns) and a long window
+(last N returns), with running sums so nothing gets rescanned.
+
+Realized variance of a window = average squared return.
+
+Compare the newest short slice against the older part of the long window:
+ratio = shortVariance / longVariance
+
+If returns are behaving like they did before, ratio sits around 1 and the sampling noise
+of an average of n squared returns is about sqrt(2 / n), so
+zscore = (ratio - 1) / sqrt(2 / n)
+
+Trigger when the ratio breaks out by more than k of those, which catches price churning
+violently around a flat average that the price detector can't see.
+
+*/
+
+static std::optional<Anomaly> detectReturnVolatility(const std::string &symbol,
+                                                     const ReturnVolatility &vol,
+                                                     SourceType source,
+                                                     std::int64_t tsNs, double k) {
+    const auto &shortReturns = vol.shortReturns;
+    const auto &longReturns = vol.longReturns;
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (shortReturns.size() < minPoints || longReturns.size() < 2 * shortReturns.size()) {
+        return std::nullopt;
+    }
+
+    // the short window is the tail of the long one, take it out so the baseline is older data
+    const double n = static_cast<double>(shortReturns.size());
+    const double baselineN = static_cast<double>(longReturns.size() - shortReturns.size());
+    const double shortVariance = shortReturns.meanSquare();
+    const double baselineVariance = (longReturns.sumSq - shortReturns.sumSq) / baselineN;
+
+    constexpr double EPS = 1e-12;
+    if (baselineVariance <= EPS) {
+        return std::nullopt;
+    }
+
+    const double ratio = shortVariance / baselineVariance;
+    const double stdev = std::sqrt(2.0 / n);
+    const double zscore = (ratio - 1.0) / stdev;
+
+    const double shortVol = std::sqrt(shortVariance);
+    const double baselineVol = std::sqrt(baselineVariance);
+    const std::string what = source == SourceType::Bar ? "bar-to-bar" : "trade-to-trade";
+
+    if (zscore > k) {
+        Anomaly newAnomaly;
+        newAnomaly.points = shortReturns.size();
+        newAnomaly.type = AnomalyType::Volatility;
+        newAnomaly.source = source;
+        newAnomaly.direction = Direction::Up;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = tsNs;
+        newAnomaly.timestamp = formatTimestampNs(tsNs);
+
+        newAnomaly.value = ratio;
+        newAnomaly.mean = 1.0;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = zscore;
+
+        newAnomaly.lower = 1.0 - (k * stdev);
+        newAnomaly.upper = 1.0 + (k * stdev);
+        newAnomaly.k = k;
+
+        newAnomaly.note =
+            "Upward volatility anomaly: " + symbol + " " + what + " returns have a recent " +
+            "volatility of " + std::to_string(shortVol) + " versus a baseline of " +
+            std::to_string(baselineVol) + ", a variance ratio of " + std::to_string(ratio) +
+            " (" + std::to_string(zscore) +
+            " standard deviations). "
+            "This suggests the price is churning much harder than usual even if its average "
+            "level hasn't moved much, which often happens ahead of or right after news.";
+
+        return newAnomaly;
+    } else if (zscore < -k) {
+        Anomaly newAnomaly;
+        newAnomaly.points = shortReturns.size();
+        newAnomaly.type = AnomalyType::Volatility;
+        newAnomaly.source = source;
+        newAnomaly.direction = Direction::Down;
+
+        newAnomaly.symbol = symbol;
+        newAnomaly.ts_ns = tsNs;
+        newAnomaly.timestamp = formatTimestampNs(tsNs);
+
+        newAnomaly.value = ratio;
+        newAnomaly.mean = 1.0;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = zscore;
+
+        newAnomaly.lower = 1.0 - (k * stdev);
+        newAnomaly.upper = 1.0 + (k * stdev);
+        newAnomaly.k = k;
+
+        newAnomaly.note =
+            "Downward volatility anomaly: " + symbol + " " + what + " returns have a recent " +
+            "volatility of " + std::to_string(shortVol) + " versus a baseline of " +
+            std::to_string(baselineVol) + ", a variance ratio of " + std::to_string(ratio) +
+            " (" + std::to_string(-zscore) +
+            " standard deviations). "
+            "This suggests the stock has gone unusually quiet, which can happen when liquidity "
+            "dries up or the market is waiting on an event before it moves.";
+
+        return newAnomaly;
+    }
+    return std::nullopt;
+}
+
+std::optional<Anomaly>
+detectVolatilityAnomaly(const std::string &symbol,
+                        const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+
+    // trade returns react first, bar closes catch slower regime changes
+    if (state.lastTrade.has_value()) {
+        if (auto a = detectReturnVolatility(symbol, state.tradeVolatility, SourceType::Trade,
+                                            state.lastTradeNs, k)) {
+            return a;
+        }
+    }
+    if (state.lastBar.has_value()) {
+        return detectReturnVolatility(symbol, state.barVolatility, SourceType::Bar,
+                                      state.lastBarNs, k);
+    }
+    return std::nullopt;
+}
@@ -1,6 +1,9 @@
 #include "anomaly_detector.h"
 #include "util/stdev.h"
 
+#include <algorithm>
+#include <cstdio>
+
 std::int64_t
 averageVolumeOfRecentTrades(const std::string &symbol,
                             const std::unordered_map<std::string, SymbolState> &bySymbol) {
@@ -38,27 +41,51 @@ detectVolumeAnomaly(const std::string &symbol,
     const std::int64_t newVolume = state.lastBar.value().volume;
     const auto &volumes = state.barVolumes;
 
-    constexpr std::size_t MIN_POINTS = 20;
-    if (volumes.size() < MIN_POINTS) {
+    const std::size_t minPoints = minBaselinePoints();
+    constexpr std::uint32_t MIN_SESSIONS = 5;
+    constexpr double EPS = 1e-9;
+
+    // inside the session, once the minute has as many sessions behind it as a baseline needs
+    // points, compare the bar with what this time of day usually trades instead of the last
+    // 200 bars, so every open and close is not an anomaly. until then the count window scores
+    // it, a reading with fewer sessions than minPoints would only be dropped
+    const auto &expected = state.lastBarExpected;
+    const bool seasonal = expected.minute >= 0 &&
+                          expected.sessions >= std::max<std::size_t>(MIN_SESSIONS, minPoints) &&
+                          expected.stdev > EPS;
+    if (!seasonal && volumes.size() < minPoints) {
         return std::nullopt;
     }
+    // a seasonal baseline is as deep as the sessions behind this minute, not the bars held
+    const std::size_t points = seasonal ? expected.sessions : volumes.size();
 
-    const double avgVolume = averageVolumeOfRecentTrades(symbol, bySymbol);
-    const double stdev = calcSTDEV<std::int64_t>(volumes);
+    const double avgVolume =
+        seasonal ? expected.mean : averageVolumeOfRecentTrades(symbol, bySymbol);
+    const double stdev = seasonal ? expected.stdev : calcSTDEV<std::int64_t>(volumes);
 
-    constexpr double EPS = 1e-9;
     if (stdev <= EPS) {
         return std::nullopt;
     }
 
+    std::string baseline = "the recent average";
+    if (seasonal) {
+        const int clock = 9 * 60 + 30 + expected.minute;
+        char hhmm[16]; // room for any int, not just 09:30-16:00
+        std::snprintf(hhmm, sizeof(hhmm), "%02d:%02d", clock / 60, clock % 60);
+        baseline = "the usual " + std::string(hhmm) + " ET volume over " +
+                   std::to_string(expected.sessions) + " sessions,";
+    }
+
     if (static_cast<double>(newVolume) > avgVolume + (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Volume;
         newAnomaly.source = SourceType::Bar;
         newAnomaly.direction = Direction::Up;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastBarTs;
+        newAnomaly.ts_ns = state.lastBarNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = static_cast<double>(newVolume);
         newAnomaly.mean = avgVolume;
@@ -71,7 +98,7 @@ detectVolumeAnomaly(const std::string &symbol,
 
         newAnomaly.note =
             "Upward volume anomaly: " + symbol + " had bar volume " + std::to_string(newVolume) +
-            " shares, above the recent average " + std::to_string(avgVolume) + " by " +
+            " shares, above " + baseline + " " + std::to_string(avgVolume) + " by " +
             std::to_string(static_cast<double>(newVolume) - avgVolume) + " (" +
             std::to_string(newAnomaly.zscore) + " standard deviations, threshold > " +
             std::to_string(newAnomaly.upper) +
@@ -82,12 +109,14 @@ detectVolumeAnomaly(const std::string &symbol,
         return newAnomaly;
     } else if (static_cast<double>(newVolume) < avgVolume - (k * stdev)) {
         Anomaly newAnomaly;
+        newAnomaly.points = points;
         newAnomaly.type = AnomalyType::Volume;
         newAnomaly.source = SourceType::Bar;
         newAnomaly.direction = Direction::Down;
 
         newAnomaly.symbol = symbol;
-        newAnomaly.timestamp = state.lastTradeTs;
+        newAnomaly.ts_ns = state.lastBarNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
 
         newAnomaly.value = static_cast<double>(newVolume);
         newAnomaly.mean = avgVolume;
@@ -100,7 +129,7 @@ detectVolumeAnomaly(const std::string &symbol,
 
         newAnomaly.note =
             "Downward volume anomaly: " + symbol + " had bar volume " + std::to_string(newVolume) +
-            " shares, below the recent average " + std::to_string(avgVolume) + " by " +
+            " shares, below " + baseline + " " + std::to_string(avgVolume) + " by " +
             std::to_string(avgVolume - static_cast<double>(newVolume)) + " (" +
             std::to_string(-newAnomaly.zscore) + " standard deviations, threshold < " +
             std::to_string(newAnomaly.lower) +
@@ -0,0 +1,110 @@
+#include "anomaly_detector.h"
+
+/*
+
+What you do:
+
+Keep the session VWAP as running sums (see SessionVwap in data_parser.h):
+vwap = Σ price × size / Σ size over every regular-hours trade since the 09:30 open, so each
+trade is O(1); pre-market and after-hours prints stay out and the next session starts over.
+
+How far the last trade sits from it, in log terms:
+deviation = ln(price / vwap)
+
+Scale that by how far a random walk usually sits from its own running average. σ is the RMS
+log return per trade over the last N trades (the volatility detector's window). After n
+trades the last price minus the average of the whole path has a variance of about
+σ² × n / 3, and the VWAP is that average weighted by size, so with n = trades this session
+zscore = deviation / (σ × √(n / 3))
+
+The spread grows with the session the same way the deviation does, so a quiet random walk
+keeps scoring about the same at 15:30 as at 10:00.
+
+If zscore > k, the price has run away above what the session paid on average (Up).
+If zscore < −k, it has dropped away below it (Down).
+
+Minute bars carry their own vw; summed the same way they give a second session VWAP that
+the note quotes next to the trade one, so a trade channel that missed prints shows up.
+
+*/
+
+std::optional<Anomaly>
+detectVwapAnomaly(const std::string &symbol,
+                  const std::unordered_map<std::string, SymbolState> &bySymbol, double k) {
+    if (symbol.empty() || !bySymbol.contains(symbol)) {
+        return std::nullopt;
+    }
+
+    const auto &state = bySymbol.at(symbol);
+    if (!state.lastTrade.has_value() || !state.vwap.session.contains(state.lastTradeNs)) {
+        return std::nullopt;
+    }
+
+    const auto &session = state.vwap;
+    const auto &returns = state.tradeVolatility.longReturns;
+
+    const std::size_t minPoints = minBaselinePoints();
+    if (session.trades < minPoints || returns.size() < minPoints) {
+        return std::nullopt;
+    }
+
+    const double price = state.lastTrade->price;
+    const double vwap = session.value();
+    if (price <= 0.0 || vwap <= 0.0) {
+        return std::nullopt;
+    }
+
+    const double scale = std::sqrt(returns.meanSquare()) *
+                         std::sqrt(static_cast<double>(session.trades) / 3.0);
+
+    constexpr double EPS = 1e-12;
+    if (scale <= EPS) {
+        return std::nullopt;
+    }
+
+    const double deviation = std::log(price / vwap);
+    const double zscore = deviation / scale;
+    if (std::abs(zscore) <= k) {
+        return std::nullopt;
+    }
+    const bool above = zscore > 0.0;
+
+    Anomaly newAnomaly;
+    newAnomaly.points = returns.size();
+    newAnomaly.type = AnomalyType::Vwap;
+    newAnomaly.source = SourceType::Trade;
+    newAnomaly.direction = above ? Direction::Up : Direction::Down;
+
+    newAnomaly.symbol = symbol;
+    newAnomaly.ts_ns = state.lastTradeNs;
+    newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+    // the band is symmetric in log price, stdev is its first-order width in dollars
+    newAnomaly.value = price;
+    newAnomaly.mean = vwap;
+    newAnomaly.stdev = vwap * scale;
+    newAnomaly.zscore = zscore;
+
+    newAnomaly.lower = vwap * std::exp(-k * scale);
+    newAnomaly.upper = vwap * std::exp(k * scale);
+    newAnomaly.k = k;
+
+    const double percent = 100.0 * (price / vwap - 1.0);
+    const double barVwap = session.barValue();
+
+    newAnomaly.note =
+        std::string(above ? "Above VWAP anomaly: " : "Below VWAP anomaly: ") + symbol +
+        " traded at " + std::to_string(price) + ", " + std::to_string(percent) +
+        "% from its session VWAP of " + std::to_string(vwap) + " over " +
+        std::to_string(static_cast<std::int64_t>(session.volume)) + " shares in " +
+        std::to_string(session.trades) + " trades (" + std::to_string(zscore) +
+        " times the spread its recent volatility allows)" +
+        (barVwap > 0.0 ? ", bars put the session VWAP at " + std::to_string(barVwap) : "") +
+        ". " +
+        (above ? "Buyers are paying well over the day's average price, which often comes from "
+                 "news, a short squeeze or momentum buying."
+               : "Sellers are accepting well under the day's average price, which often comes "
+                 "from news, forced selling or a large order being unwound.");
+
+    return newAnomaly;
+}
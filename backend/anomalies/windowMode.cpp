@@ -0,0 +1,17 @@
+#include "anomaly_detector.h"
+
+#include <array>
+#include <atomic>
+
+static std::array<std::atomic<WindowMode>, 32> modes{};
+
+void setWindowMode(AnomalyType type, WindowMode mode) {
+    const auto index = static_cast<std::size_t>(type);
+    if (index < modes.size())
+        modes[index].store(mode, std::memory_order_relaxed);
+}
+
+WindowMode windowMode(AnomalyType type) {
+    const auto index = static_cast<std::size_t>(type);
+    return index < modes.size() ? modes[index].load(std::memory_order_relaxed) : WindowMode::Count;
+}
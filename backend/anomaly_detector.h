@@ -52,12 +52,20 @@ enum class AnomalyType {
     Gap,
     Liquidity,
     StaleData,
-    ParseError
+    ParseError,
+    Market,
+    Sector,
+    TradeSize,
+    TradeFlow,
+    Vwap
 };
 
 enum class SourceType { Trade, Quote, Bar };
 enum class Direction { Up, Down, None };
 
+// whether a move was the symbol's own or part of something bigger
+enum class MoveScope { Unclassified, Idiosyncratic, Sector, Systemic };
+
 struct Anomaly {
     AnomalyType type = AnomalyType::Price;
     SourceType source = SourceType::Trade;
@@ -65,7 +73,7 @@ struct Anomaly {
 
     std::string symbol;
     std::string timestamp;
-    // std::int64_t ts_ns = 0;
+    std::int64_t ts_ns = 0;
 
     // for why it triggered can be used later
     double value = 0.0;  // observed value (price, volume, spread, etc.)
@@ -77,9 +85,40 @@ struct Anomaly {
     double upper = 0.0; // mean + k*stdev
     double k = 0.0;     // how many std devs you used
 
+    MoveScope scope = MoveScope::Unclassified;
+
+    // one record covers a whole episode, timestamp above is when it opened
+    std::uint64_t episodeId = 0;
+    bool active = false;         // still breaking its band
+    std::string endTimestamp;    // last event that extended the episode
+    std::int64_t durationMs = 0; // endTimestamp - timestamp
+    std::uint64_t eventCount = 0;
+    double peakZscore = 0.0; // largest |zscore| seen, keeps its sign
+
+    std::string profile;    // detection profile that raised it, see detection_profiles.h
+    std::size_t points = 0; // baseline points the detector scored against
+
     std::string note; // message
 };
 
+// which baseline a detector scores against: the last N points (windowN) or everything within
+// the time horizon set by configureTimeWindows. only price, spread and liquidity have time
+// windows; bar detectors already see one point per minute, so N bars is a time span
+enum class WindowMode { Count, Time };
+
+// set at startup, read by the detectors on every evaluation
+void setWindowMode(AnomalyType type, WindowMode mode);
+WindowMode windowMode(AnomalyType type);
+
+// fewest baseline points a detector scores against. each detection profile sets its own
+// minimum, this is the smallest of them so one evaluation can serve every profile
+void setMinBaselinePoints(std::size_t n);
+std::size_t minBaselinePoints();
+
+// time of the newest event a detector scores (its last trade, quote or bar); a detector has
+// nothing new to say until this moves
+std::int64_t detectorSourceNs(AnomalyType type, const SymbolState &state);
+
 double averagePriceOfRecentTrades(const std::string &symbol,
                                   const std::unordered_map<std::string, SymbolState> &bySymbol);
 
@@ -98,3 +137,37 @@ detectVolumeAnomaly(const std::string &symbol,
 std::optional<Anomaly>
 detectSpreadAnomaly(const std::string &symbol,
                     const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+std::optional<Anomaly>
+detectVolatilityAnomaly(const std::string &symbol,
+                        const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+std::optional<Anomaly>
+detectRangeAnomaly(const std::string &symbol,
+                   const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+std::optional<Anomaly>
+detectGapAnomaly(const std::string &symbol,
+                 const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+std::optional<Anomaly>
+detectLiquidityAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+// trades above this percentile of the symbol's long-horizon size distribution are block trades
+void setTradeSizePercentile(double p);
+double tradeSizePercentile();
+
+std::optional<Anomaly>
+detectTradeSizeAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+// abnormal buy/sell imbalance of the signed trade flow, see TradeFlow
+std::optional<Anomaly>
+detectTradeFlowAnomaly(const std::string &symbol,
+                       const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
+
+// the last trade far from the session VWAP, in units of recent realized volatility
+std::optional<Anomaly>
+detectVwapAnomaly(const std::string &symbol,
+                  const std::unordered_map<std::string, SymbolState> &bySymbol, double k);
@@ -0,0 +1,273 @@
+#include "anomaly_log.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "subscription.h"
+
+namespace {
+
+constexpr char LOG_MAGIC[8] = {'S', 'A', 'R', 'L', 'O', 'G', '0', '1'};
+constexpr std::uint32_t LOG_VERSION = 1;
+
+// entries per write, bounds the batch buffer
+constexpr std::size_t MAX_BATCH = 1024;
+
+std::int64_t wall_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string_view event_name(LogEvent event) {
+    switch (event) {
+    case LogEvent::Opened:
+        return "opened";
+    case LogEvent::Extended:
+        return "extended";
+    case LogEvent::Closed:
+        return "closed";
+    case LogEvent::Dropped:
+        return "dropped";
+    }
+    return "";
+}
+
+void append_json(std::string &out, const AnomalyLogEntry &entry) {
+    nlohmann::json line{{"logged", formatTimestampNs(entry.logged_ns)},
+                        {"level", logLevelName(static_cast<LogLevel>(entry.level))},
+                        {"event", event_name(static_cast<LogEvent>(entry.event))}};
+
+    if (static_cast<LogEvent>(entry.event) == LogEvent::Dropped) {
+        line["count"] = entry.dropped;
+    } else {
+        const AnomalyRecord &r = entry.record;
+        const auto type = static_cast<AnomalyType>(r.type);
+        line["symbol"] = recordSymbol(r);
+        line["type"] = r.type;
+        if (const auto name = detectorName(type); !name.empty())
+            line["detector"] = name;
+        line["source"] = r.source;
+        line["direction"] = r.direction;
+        line["scope"] = r.scope;
+        line["episodeId"] = r.episode_id;
+        line["timestamp"] = formatTimestampNs(r.ts_ns);
+        line["endTimestamp"] = formatTimestampNs(r.end_ns);
+        line["durationMs"] = (r.end_ns - r.ts_ns) / 1'000'000;
+        line["eventCount"] = r.event_count;
+        line["value"] = r.value;
+        line["mean"] = r.mean;
+        line["stdev"] = r.stdev;
+        line["zscore"] = r.zscore;
+        line["lower"] = r.lower;
+        line["upper"] = r.upper;
+        line["k"] = r.k;
+        line["peakZscore"] = r.peak_zscore;
+        line["profile"] = recordProfile(r);
+    }
+    out += line.dump();
+    out += '\n';
+}
+
+} // namespace
+
+LogLevel anomalyLogLevel(LogEvent event, const Anomaly &anomaly) {
+    switch (event) {
+    case LogEvent::Extended:
+        return LogLevel::Debug;
+    case LogEvent::Opened:
+        return anomaly.scope == MoveScope::Sector || anomaly.scope == MoveScope::Systemic
+                   ? LogLevel::Warn
+                   : LogLevel::Info;
+    case LogEvent::Closed:
+        return LogLevel::Info;
+    case LogEvent::Dropped:
+        return LogLevel::Warn;
+    }
+    return LogLevel::Info;
+}
+
+std::optional<LogLevel> parseLogLevel(std::string_view name) {
+    for (auto level : {LogLevel::Debug, LogLevel::Info, LogLevel::Warn, LogLevel::Error,
+                       LogLevel::Off}) {
+        if (logLevelName(level) == name)
+            return level;
+    }
+    return std::nullopt;
+}
+
+std::string_view logLevelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug:
+        return "debug";
+    case LogLevel::Info:
+        return "info";
+    case LogLevel::Warn:
+        return "warn";
+    case LogLevel::Error:
+        return "error";
+    case LogLevel::Off:
+        return "off";
+    }
+    return "";
+}
+
+AnomalyLog::~AnomalyLog() { stop(); }
+
+void AnomalyLog::start(AnomalyLogConfig next) {
+    stop();
+    config = std::move(next);
+
+    std::size_t capacity = 2;
+    while (capacity < config.queueCapacity)
+        capacity *= 2;
+    slots = std::make_unique<Slot[]>(capacity);
+    for (std::size_t i = 0; i < capacity; ++i)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    mask = capacity - 1;
+    tail.store(0, std::memory_order_relaxed);
+    head = 0;
+
+    const bool toStdout = config.path.empty() || config.path == "-";
+    out = toStdout ? stdout : std::fopen(config.path.c_str(), "ab");
+    if (!out)
+        throw std::runtime_error("cannot open anomaly log " + config.path + ": " +
+                                 std::strerror(errno));
+
+    // a binary file starts with its header once, appends to an existing file just continue
+    if (config.format == LogFormat::Binary && (toStdout || std::ftell(out) == 0)) {
+        std::string header(LOG_MAGIC, sizeof(LOG_MAGIC));
+        const std::uint32_t fields[2] = {LOG_VERSION, sizeof(AnomalyLogEntry)};
+        header.append(reinterpret_cast<const char *>(fields), sizeof(fields));
+        write(header);
+    }
+
+    running.store(true, std::memory_order_release);
+    drainThread = std::thread([this] { drain(); });
+}
+
+void AnomalyLog::stop() {
+    if (!running.exchange(false))
+        return;
+    if (drainThread.joinable())
+        drainThread.join();
+    if (out && out != stdout)
+        std::fclose(out);
+    out = nullptr;
+}
+
+// bounded MPMC ring in the style of Vyukov's, used with a single consumer: a slot's sequence
+// equals the position a producer may claim, and position + 1 once the entry is readable
+bool AnomalyLog::push(const AnomalyLogEntry &entry) {
+    std::uint64_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot &slot = slots[pos & mask];
+        const std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::int64_t>(sequence - pos);
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.entry = entry;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // full, the drain thread has not reached this slot yet
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AnomalyLog::pop(AnomalyLogEntry &entry) {
+    Slot &slot = slots[head & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+        return false;
+    entry = slot.entry;
+    slot.sequence.store(head + mask + 1, std::memory_order_release);
+    ++head;
+    return true;
+}
+
+void AnomalyLog::log(LogEvent event, const Anomaly &anomaly) {
+    if (!running.load(std::memory_order_acquire))
+        return;
+    const LogLevel level = anomalyLogLevel(event, anomaly);
+    if (level < config.level)
+        return;
+
+    AnomalyLogEntry entry{};
+    entry.logged_ns = wall_ns();
+    entry.level = static_cast<std::uint8_t>(level);
+    entry.event = static_cast<std::uint8_t>(event);
+    entry.record = toAnomalyRecord(anomaly);
+
+    if (push(entry))
+        queued.fetch_add(1, std::memory_order_relaxed);
+    else
+        dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AnomalyLog::write(const std::string &batch) {
+    if (batch.empty())
+        return;
+    std::fwrite(batch.data(), 1, batch.size(), out);
+    std::fflush(out);
+}
+
+void AnomalyLog::drain() {
+    std::string batch;
+    std::uint64_t reportedDrops = 0;
+    AnomalyLogEntry entry;
+
+    auto add = [&](const AnomalyLogEntry &e) {
+        if (config.format == LogFormat::Json)
+            append_json(batch, e);
+        else
+            batch.append(reinterpret_cast<const char *>(&e), sizeof(e));
+    };
+
+    for (;;) {
+        // read before draining, so nothing pushed ahead of stop() is left behind
+        const bool stopping = !running.load(std::memory_order_acquire);
+
+        batch.clear();
+        std::size_t count = 0;
+        while (count < MAX_BATCH && pop(entry)) {
+            add(entry);
+            ++count;
+        }
+
+        const std::uint64_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops > reportedDrops && LogLevel::Warn >= config.level) {
+            AnomalyLogEntry report{};
+            report.logged_ns = wall_ns();
+            report.level = static_cast<std::uint8_t>(LogLevel::Warn);
+            report.event = static_cast<std::uint8_t>(LogEvent::Dropped);
+            report.dropped = static_cast<std::uint32_t>(
+                std::min<std::uint64_t>(drops - reportedDrops,
+                                        std::numeric_limits<std::uint32_t>::max()));
+            add(report);
+            reportedDrops = drops;
+        }
+
+        write(batch);
+        written.fetch_add(count, std::memory_order_relaxed);
+
+        if (count == MAX_BATCH)
+            continue;
+        if (stopping)
+            return;
+        std::this_thread::sleep_for(std::chrono::milliseconds(config.flushIntervalMs));
+    }
+}
+
+AnomalyLogStats AnomalyLog::stats() const {
+    return {queued.load(std::memory_order_relaxed), written.load(std::memory_order_relaxed),
+            dropped.load(std::memory_order_relaxed)};
+}
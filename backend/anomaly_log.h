@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "anomaly_detector.h"
+#include "anomaly_store.h"
+
+/*
+
+Asynchronous anomaly log.
+
+The feed records anomalies under stateMutex, so it must never wait on whoever reads the log.
+log() turns the anomaly into a fixed 144-byte entry (the store's AnomalyRecord plus level,
+event and wall time) and pushes it onto a bounded lock-free multi-producer queue: one CAS to
+claim a slot, a copy, one release store. When the queue is full the entry is dropped and
+counted instead of waiting. Notes are not copied, they stay in /api/anomalies.
+
+A background thread drains the queue in batches, writes each batch with one call and flushes,
+and reports drops as a "dropped" entry carrying the count since the previous report.
+
+Output goes to a file or stdout, one of:
+
+    json     one object per line
+    binary   header magic "SARLOG01", u32 version, u32 entry size, then raw entries
+
+Levels: extends are debug, opens and closes info, market or sector wide opens and drop
+reports warn.
+
+*/
+
+enum class LogLevel : std::uint8_t { Debug, Info, Warn, Error, Off };
+
+enum class LogEvent : std::uint8_t { Opened, Extended, Closed, Dropped };
+
+enum class LogFormat { Json, Binary };
+
+std::optional<LogLevel> parseLogLevel(std::string_view name);
+std::string_view logLevelName(LogLevel level);
+
+// the level an event is logged at, see above
+LogLevel anomalyLogLevel(LogEvent event, const Anomaly &anomaly);
+
+struct AnomalyLogEntry {
+    std::int64_t logged_ns; // wall clock when queued
+    std::uint8_t level;
+    std::uint8_t event;
+    std::uint8_t reserved[2];
+    std::uint32_t dropped; // only for Dropped
+    AnomalyRecord record;
+};
+
+static_assert(sizeof(AnomalyLogEntry) == 144);
+static_assert(std::is_trivially_copyable_v<AnomalyLogEntry>);
+
+struct AnomalyLogConfig {
+    std::string path; // empty or "-" is stdout
+    LogFormat format = LogFormat::Json;
+    LogLevel level = LogLevel::Info;
+    std::size_t queueCapacity = 8192; // rounded up to a power of two
+    std::size_t flushIntervalMs = 5;  // how long the drain thread sleeps when idle
+};
+
+struct AnomalyLogStats {
+    std::uint64_t queued = 0;
+    std::uint64_t written = 0;
+    std::uint64_t dropped = 0;
+};
+
+class AnomalyLog {
+  public:
+    AnomalyLog() = default;
+    ~AnomalyLog();
+
+    AnomalyLog(const AnomalyLog &) = delete;
+    AnomalyLog &operator=(const AnomalyLog &) = delete;
+
+    // opens the output and starts the drain thread, throws std::runtime_error if the file
+    // cannot be opened
+    void start(AnomalyLogConfig config);
+
+    // writes out everything queued so far and joins the drain thread
+    void stop();
+
+    // any thread, never blocks; does nothing before start() or below the configured level
+    void log(LogEvent event, const Anomaly &anomaly);
+
+    AnomalyLogStats stats() const;
+
+  private:
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        AnomalyLogEntry entry;
+    };
+
+    bool push(const AnomalyLogEntry &entry);
+    bool pop(AnomalyLogEntry &entry);
+    void drain();
+    void write(const std::string &batch);
+
+    AnomalyLogConfig config;
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask = 0;
+
+    alignas(64) std::atomic<std::uint64_t> tail{0}; // next slot producers claim
+    alignas(64) std::uint64_t head = 0;             // drain thread only
+
+    std::atomic<std::uint64_t> queued{0};
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> dropped{0};
+
+    std::FILE *out = nullptr;
+    std::atomic<bool> running{false};
+    std::thread drainThread;
+};
@@ -0,0 +1,465 @@
+#include "anomaly_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "data_parser.h"
+
+namespace {
+
+constexpr std::uint32_t RECORD_MAGIC = 0x52524153; // "SARR"
+constexpr char SEGMENT_MAGIC[8] = {'S', 'A', 'R', 'S', 'E', 'G', '0', '1'};
+constexpr std::uint32_t SEGMENT_VERSION = 1;
+constexpr std::size_t HEADER_BYTES = 4096;
+constexpr std::size_t BLOCK_RECORDS = 64;
+
+struct SegmentHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint64_t capacity;
+    std::uint64_t number;
+    std::int64_t createdNs;
+};
+
+std::uint32_t checksum(const AnomalyRecord &record) {
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&record);
+    std::uint32_t h = 2166136261u;
+    for (std::size_t i = offsetof(AnomalyRecord, ts_ns); i < sizeof(AnomalyRecord); ++i) {
+        h ^= bytes[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool valid(const AnomalyRecord &record) {
+    return record.magic == RECORD_MAGIC && record.checksum == checksum(record);
+}
+
+std::runtime_error io_error(const std::string &what, const std::filesystem::path &path) {
+    return std::runtime_error(what + " " + path.string() + ": " + std::strerror(errno));
+}
+
+std::filesystem::path segment_path(const std::filesystem::path &dir, std::uint64_t number) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "anomalies-%06llu.seg",
+                  static_cast<unsigned long long>(number));
+    return dir / name;
+}
+
+} // namespace
+
+AnomalyRecord toAnomalyRecord(const Anomaly &anomaly) {
+    AnomalyRecord record{};
+    record.magic = RECORD_MAGIC;
+
+    record.ts_ns = anomaly.ts_ns ? anomaly.ts_ns : parseTimestampNs(anomaly.timestamp);
+    record.end_ns = anomaly.endTimestamp.empty() ? record.ts_ns
+                                                 : parseTimestampNs(anomaly.endTimestamp);
+    record.episode_id = anomaly.episodeId;
+
+    std::memcpy(record.symbol, anomaly.symbol.data(),
+                std::min(anomaly.symbol.size(), sizeof(record.symbol) - 1));
+
+    record.type = static_cast<std::uint8_t>(anomaly.type);
+    record.source = static_cast<std::uint8_t>(anomaly.source);
+    record.direction = static_cast<std::uint8_t>(anomaly.direction);
+    record.scope = static_cast<std::uint8_t>(anomaly.scope);
+    record.event_count = static_cast<std::uint32_t>(
+        std::min<std::uint64_t>(anomaly.eventCount, std::numeric_limits<std::uint32_t>::max()));
+
+    record.value = anomaly.value;
+    record.mean = anomaly.mean;
+    record.stdev = anomaly.stdev;
+    record.zscore = anomaly.zscore;
+    record.lower = anomaly.lower;
+    record.upper = anomaly.upper;
+    record.k = anomaly.k;
+    record.peak_zscore = anomaly.peakZscore;
+    std::memcpy(record.profile, anomaly.profile.data(),
+                std::min(anomaly.profile.size(), sizeof(record.profile)));
+
+    record.checksum = checksum(record);
+    return record;
+}
+
+std::string recordSymbol(const AnomalyRecord &record) {
+    return std::string(record.symbol, strnlen(record.symbol, sizeof(record.symbol)));
+}
+
+std::string recordProfile(const AnomalyRecord &record) {
+    const std::size_t length = strnlen(record.profile, sizeof(record.profile));
+    return length == 0 ? "default" : std::string(record.profile, length);
+}
+
+struct AnomalyStore::Segment {
+    std::uint64_t number = 0;
+    std::filesystem::path path;
+
+    void *mapping = nullptr;
+    std::size_t mappedBytes = 0;
+    AnomalyRecord *records = nullptr;
+    std::size_t capacity = 0;
+    std::size_t count = 0;
+    bool writable = false;
+    bool durable = false; // sealed and synced to disk, only maintain() reads or sets it
+
+    std::int64_t minTs = std::numeric_limits<std::int64_t>::max();
+    std::int64_t maxTs = std::numeric_limits<std::int64_t>::min();
+
+    struct Block {
+        std::int64_t minTs = std::numeric_limits<std::int64_t>::max();
+        std::int64_t maxTs = std::numeric_limits<std::int64_t>::min();
+    };
+    std::vector<Block> blocks;
+    std::unordered_map<std::string, std::vector<std::uint32_t>> bySymbol;
+
+    void index(std::uint32_t slot) {
+        const AnomalyRecord &record = records[slot];
+        if (slot / BLOCK_RECORDS >= blocks.size())
+            blocks.emplace_back();
+        Block &block = blocks[slot / BLOCK_RECORDS];
+        block.minTs = std::min(block.minTs, record.ts_ns);
+        block.maxTs = std::max(block.maxTs, record.ts_ns);
+        minTs = std::min(minTs, record.ts_ns);
+        maxTs = std::max(maxTs, record.ts_ns);
+        bySymbol[recordSymbol(record)].push_back(slot);
+    }
+
+    void sync(bool readOnlyAfter) {
+        if (!mapping)
+            return;
+        msync(mapping, mappedBytes, MS_SYNC);
+        if (readOnlyAfter && writable) {
+            mprotect(mapping, mappedBytes, PROT_READ);
+            writable = false;
+            durable = true;
+        }
+    }
+
+    // read-only from here on without waiting for the disk; maintain() syncs it later
+    void seal() {
+        if (!mapping || !writable)
+            return;
+        msync(mapping, mappedBytes, MS_ASYNC);
+        mprotect(mapping, mappedBytes, PROT_READ);
+        writable = false;
+    }
+
+    ~Segment() {
+        if (mapping) {
+            if (writable)
+                msync(mapping, mappedBytes, MS_SYNC);
+            munmap(mapping, mappedBytes);
+        }
+    }
+};
+
+AnomalyStore::AnomalyStore(std::size_t segmentCapacity, std::size_t maxSegments)
+    : segmentCapacity(segmentCapacity), maxSegments(std::max<std::size_t>(maxSegments, 1)) {}
+
+AnomalyStore::~AnomalyStore() = default;
+
+std::unique_ptr<AnomalyStore::Segment> AnomalyStore::mapSegment(std::uint64_t number,
+                                                                bool create) {
+    auto segment = std::make_unique<Segment>();
+    segment->number = number;
+    segment->path = segment_path(directory, number);
+
+    const int fd = ::open(segment->path.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR,
+                          0644);
+    if (fd < 0)
+        throw io_error("cannot open anomaly segment", segment->path);
+
+    SegmentHeader header{};
+    if (create) {
+        std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(header.magic));
+        header.version = SEGMENT_VERSION;
+        header.recordSize = sizeof(AnomalyRecord);
+        header.capacity = segmentCapacity;
+        header.number = number;
+        header.createdNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+
+        // sparse file, slots read back as zeros which never validate
+        const auto bytes =
+            static_cast<off_t>(HEADER_BYTES + segmentCapacity * sizeof(AnomalyRecord));
+        if (::ftruncate(fd, bytes) != 0 || ::pwrite(fd, &header, sizeof(header), 0) !=
+                                               static_cast<ssize_t>(sizeof(header))) {
+            ::close(fd);
+            throw io_error("cannot size anomaly segment", segment->path);
+        }
+    } else if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+               std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(header.magic)) != 0 ||
+               header.version != SEGMENT_VERSION || header.recordSize != sizeof(AnomalyRecord)) {
+        ::close(fd);
+        throw std::runtime_error("unrecognized anomaly segment " + segment->path.string());
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw io_error("cannot stat anomaly segment", segment->path);
+    }
+
+    // a file cut short still maps, just with fewer usable slots
+    const std::size_t fileSlots =
+        st.st_size > static_cast<off_t>(HEADER_BYTES)
+            ? (static_cast<std::size_t>(st.st_size) - HEADER_BYTES) / sizeof(AnomalyRecord)
+            : 0;
+    segment->capacity = std::min<std::size_t>(header.capacity, fileSlots);
+    segment->mappedBytes = HEADER_BYTES + segment->capacity * sizeof(AnomalyRecord);
+
+    void *mapping =
+        ::mmap(nullptr, segment->mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        throw io_error("cannot map anomaly segment", segment->path);
+
+    segment->mapping = mapping;
+    segment->writable = true;
+    segment->records = reinterpret_cast<AnomalyRecord *>(static_cast<char *>(mapping) +
+                                                         HEADER_BYTES);
+
+    // tail recovery: the first slot that doesn't validate ends the segment
+    while (segment->count < segment->capacity && valid(segment->records[segment->count])) {
+        segment->index(static_cast<std::uint32_t>(segment->count));
+        ++segment->count;
+    }
+    if (segment->count < segment->capacity) {
+        AnomalyRecord &tail = segment->records[segment->count];
+        if (tail.magic != 0 || tail.checksum != 0)
+            std::memset(&tail, 0, sizeof(tail));
+    }
+
+    return segment;
+}
+
+void AnomalyStore::open(const std::filesystem::path &dir) {
+    std::unique_lock lock(mutex);
+    directory = dir;
+    segments.clear();
+    spare.reset();
+
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::uint64_t> numbers;
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+        const std::string name = entry.path().filename().string();
+        unsigned long long number = 0;
+        if (std::sscanf(name.c_str(), "anomalies-%llu.seg", &number) == 1)
+            numbers.push_back(number);
+    }
+    std::sort(numbers.begin(), numbers.end());
+
+    for (std::uint64_t number : numbers)
+        segments.push_back(mapSegment(number, false));
+
+    // an empty newest segment is the spare maintain() mapped in the last run, keep it as the
+    // spare so it doesn't push an old segment past maxSegments
+    if (segments.size() >= 2 && segments.back()->count == 0) {
+        spare = std::move(segments.back());
+        segments.pop_back();
+    }
+
+    // everything but the newest is sealed
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i)
+        segments[i]->sync(true);
+
+    if (segments.empty() || segments.back()->count >= segments.back()->capacity) {
+        if (spare) {
+            segments.back()->sync(true);
+            segments.push_back(std::move(spare));
+        } else {
+            startSegment();
+        }
+    }
+    dropOldSegments();
+}
+
+bool AnomalyStore::isOpen() const {
+    std::shared_lock lock(mutex);
+    return !segments.empty();
+}
+
+void AnomalyStore::startSegment() {
+    std::uint64_t number = 0;
+    if (!segments.empty()) {
+        segments.back()->sync(true);
+        number = segments.back()->number + 1;
+    }
+    segments.push_back(mapSegment(number, true));
+}
+
+void AnomalyStore::dropOldSegments() {
+    while (segments.size() > maxSegments) {
+        std::error_code ec;
+        std::filesystem::remove(segments.front()->path, ec);
+        segments.erase(segments.begin());
+    }
+}
+
+void AnomalyStore::prepareSpare() {
+    std::lock_guard creating(spareMutex);
+    std::uint64_t number = 0;
+    {
+        std::shared_lock lock(mutex);
+        if (segments.empty() || spare)
+            return;
+        number = segments.back()->number + 1;
+    }
+    // the file work happens without the store lock; only a rotation could change the newest
+    // segment meanwhile, and a rotation waits for this spare
+    auto next = mapSegment(number, true);
+    std::unique_lock lock(mutex);
+    spare = std::move(next);
+}
+
+void AnomalyStore::maintain() {
+    // segments past maxSegments are unlinked and unmapped outside the lock
+    std::vector<std::unique_ptr<Segment>> dropped;
+    std::vector<Segment *> unsynced;
+    {
+        std::unique_lock lock(mutex);
+        while (segments.size() > maxSegments) {
+            dropped.push_back(std::move(segments.front()));
+            segments.erase(segments.begin());
+        }
+        for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+            if (!segments[i]->durable)
+                unsynced.push_back(segments[i].get());
+        }
+    }
+    for (auto &segment : dropped) {
+        std::error_code ec;
+        std::filesystem::remove(segment->path, ec);
+    }
+    dropped.clear();
+
+    // sealed segments are only dropped above, by this thread, so the pointers stay valid
+    for (Segment *segment : unsynced) {
+        msync(segment->mapping, segment->mappedBytes, MS_SYNC);
+        segment->durable = true;
+    }
+
+    prepareSpare();
+}
+
+void AnomalyStore::append(const Anomaly &anomaly) {
+    const AnomalyRecord record = toAnomalyRecord(anomaly);
+
+    std::unique_lock lock(mutex);
+    if (segments.empty())
+        return;
+
+    // switching to the spare is a pointer move; only when maintain() has not caught up does
+    // the append path create the file itself
+    while (segments.back()->count >= segments.back()->capacity) {
+        if (!spare) {
+            lock.unlock();
+            prepareSpare();
+            lock.lock();
+            if (segments.empty())
+                return;
+            continue; // another append may have rotated meanwhile
+        }
+        segments.back()->seal();
+        segments.push_back(std::move(spare));
+    }
+
+    Segment &segment = *segments.back();
+    const auto slot = static_cast<std::uint32_t>(segment.count);
+    std::memcpy(&segment.records[slot], &record, sizeof(record));
+    segment.index(slot);
+    ++segment.count;
+}
+
+void AnomalyStore::sync() {
+    std::unique_lock lock(mutex);
+    if (!segments.empty())
+        segments.back()->sync(false);
+}
+
+std::size_t AnomalyStore::query(const std::optional<std::string> &symbol,
+                                const std::optional<std::string> &profile, std::int64_t fromNs,
+                                std::int64_t toNs, std::size_t limit,
+                                const std::function<void(const AnomalyRecord &)> &visit) const {
+    std::shared_lock lock(mutex);
+
+    // pointers into the mappings, only these get sorted
+    std::vector<const AnomalyRecord *> hits;
+    auto consider = [&](const AnomalyRecord &record) {
+        if (record.ts_ns >= fromNs && record.ts_ns <= toNs &&
+            (!profile || recordProfile(record) == *profile))
+            hits.push_back(&record);
+    };
+
+    for (const auto &segmentPtr : segments) {
+        const Segment &segment = *segmentPtr;
+        if (segment.count == 0 || segment.maxTs < fromNs || segment.minTs > toNs)
+            continue;
+
+        if (symbol) {
+            auto it = segment.bySymbol.find(*symbol);
+            if (it == segment.bySymbol.end())
+                continue;
+            for (std::uint32_t slot : it->second) {
+                const auto &block = segment.blocks[slot / BLOCK_RECORDS];
+                if (block.maxTs < fromNs || block.minTs > toNs)
+                    continue;
+                consider(segment.records[slot]);
+            }
+            continue;
+        }
+
+        for (std::size_t b = 0; b < segment.blocks.size(); ++b) {
+            const auto &block = segment.blocks[b];
+            if (block.maxTs < fromNs || block.minTs > toNs)
+                continue;
+            const std::size_t end = std::min(segment.count, (b + 1) * BLOCK_RECORDS);
+            for (std::size_t slot = b * BLOCK_RECORDS; slot < end; ++slot)
+                consider(segment.records[slot]);
+        }
+    }
+
+    // only the first limit hits are ordered; episode id breaks ties so pages stay stable
+    const std::size_t n = std::min(hits.size(), limit);
+    std::partial_sort(hits.begin(), hits.begin() + static_cast<std::ptrdiff_t>(n), hits.end(),
+                      [](const AnomalyRecord *a, const AnomalyRecord *b) {
+                          return a->ts_ns != b->ts_ns ? a->ts_ns < b->ts_ns
+                                                      : a->episode_id < b->episode_id;
+                      });
+
+    for (std::size_t i = 0; i < n; ++i)
+        visit(*hits[i]);
+    return n;
+}
+
+std::size_t AnomalyStore::recordCount() const {
+    std::shared_lock lock(mutex);
+    std::size_t total = 0;
+    for (const auto &segment : segments)
+        total += segment->count;
+    return total;
+}
+
+std::uint64_t AnomalyStore::maxEpisodeId() const {
+    std::shared_lock lock(mutex);
+    std::uint64_t highest = 0;
+    for (const auto &segment : segments)
+        for (std::size_t i = 0; i < segment->count; ++i)
+            highest = std::max(highest, segment->records[i].episode_id);
+    return highest;
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "anomaly_detector.h"
+
+/*
+
+On-disk anomaly history.
+
+Closed episodes are appended as fixed 128-byte records to segment files in a directory:
+
+    anomalies-000000.seg, anomalies-000001.seg, ...
+
+Each segment is a 4 KiB header followed by `capacity` record slots. The file is sized up
+front and mapped MAP_SHARED, so appends are a memcpy into the mapping and readers walk the
+same pages without copying records onto the heap. When a segment fills up it is made
+read-only and appends move on to a spare segment that maintain() mapped ahead of time.
+maintain() also syncs sealed segments to disk and deletes the oldest ones past maxSegments,
+so appends (which run under stateMutex) never wait for the filesystem.
+
+Every record carries a magic and a checksum. On startup each segment is scanned until the
+first slot that doesn't validate, which is the tail; a torn write from a crash is zeroed and
+overwritten by the next append.
+
+Two small in-memory indexes are rebuilt during that scan:
+- a zone map of [minTs, maxTs] per block of 64 records (records are appended when an episode
+  closes, so timestamps are only roughly ordered)
+- per-symbol lists of record slots
+
+Layout is native little-endian, version 1. The last 8 bytes were reserved and now hold the
+name of the detection profile that raised the anomaly; records written before profiles have
+zeros there and read back as the default profile.
+
+*/
+
+struct AnomalyRecord {
+    std::uint32_t magic;
+    std::uint32_t checksum; // FNV-1a over everything after this field
+
+    std::int64_t ts_ns;  // episode opened
+    std::int64_t end_ns; // last event in the episode
+    std::uint64_t episode_id;
+
+    char symbol[16]; // NUL padded
+
+    std::uint8_t type;
+    std::uint8_t source;
+    std::uint8_t direction;
+    std::uint8_t scope;
+    std::uint32_t event_count;
+
+    double value;
+    double mean;
+    double stdev;
+    double zscore;
+    double lower;
+    double upper;
+    double k;
+    double peak_zscore;
+
+    char profile[8]; // NUL padded, see detection_profiles.h
+};
+
+static_assert(sizeof(AnomalyRecord) == 128, "anomaly records are fixed 128-byte slots");
+static_assert(std::is_trivially_copyable_v<AnomalyRecord>);
+
+AnomalyRecord toAnomalyRecord(const Anomaly &anomaly);
+std::string recordSymbol(const AnomalyRecord &record);
+std::string recordProfile(const AnomalyRecord &record);
+
+class AnomalyStore {
+  public:
+    explicit AnomalyStore(std::size_t segmentCapacity = 65536, std::size_t maxSegments = 64);
+    ~AnomalyStore();
+
+    AnomalyStore(const AnomalyStore &) = delete;
+    AnomalyStore &operator=(const AnomalyStore &) = delete;
+
+    // maps every existing segment and recovers the tail, throws std::runtime_error on I/O errors
+    void open(const std::filesystem::path &directory);
+    bool isOpen() const;
+
+    void append(const Anomaly &anomaly);
+
+    // segment housekeeping kept off the append path: syncs sealed segments, deletes the ones
+    // past maxSegments and maps the next segment ahead of time. call it from a background
+    // thread every few seconds
+    void maintain();
+
+    // flushes the writable segment to disk, used on shutdown
+    void sync();
+
+    // visits records with fromNs <= ts_ns <= toNs (optionally one symbol and one profile) in
+    // timestamp order, straight out of the mapped segments; returns how many matched before
+    // hitting limit
+    std::size_t query(const std::optional<std::string> &symbol,
+                      const std::optional<std::string> &profile, std::int64_t fromNs,
+                      std::int64_t toNs, std::size_t limit,
+                      const std::function<void(const AnomalyRecord &)> &visit) const;
+
+    std::size_t recordCount() const;
+
+    // highest episode_id on disk, 0 for an empty store; new episodes continue after it
+    std::uint64_t maxEpisodeId() const;
+
+  private:
+    struct Segment;
+
+    std::unique_ptr<Segment> mapSegment(std::uint64_t number, bool create);
+    void startSegment();
+    void dropOldSegments();
+    void prepareSpare();
+
+    std::size_t segmentCapacity;
+    std::size_t maxSegments;
+    std::filesystem::path directory;
+
+    mutable std::shared_mutex mutex; // appends are exclusive, queries shared
+    std::vector<std::unique_ptr<Segment>> segments; // oldest first, last one is writable
+    std::unique_ptr<Segment> spare;                 // next segment, mapped ahead of time
+    std::mutex spareMutex;                          // one creator of the spare at a time
+};
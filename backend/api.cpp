@@ -1,7 +1,19 @@
 #include "api.h"
+#include "instrument.h"
+#include "runtime_mode.h"
+#include "seasonality.h"
+#include "socket.h"
+#include "wire_format.h"
 
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 static std::string normalize_symbol(std::string symbol) {
@@ -24,14 +36,250 @@ static bool is_valid_symbol(const std::string &symbol) {
     });
 }
 
-static json symbols_json(const std::unordered_set<std::string> &symbols) {
-    std::vector<std::string> sorted(symbols.begin(), symbols.end());
+// "tracked" keeps the plain symbol list, "subscriptions" spells out channels and detectors
+static json tracked_json(const SubscriptionMap &subscriptions) {
+    std::vector<std::string> sorted;
+    sorted.reserve(subscriptions.size());
+    for (const auto &[symbol, subscription] : subscriptions)
+        sorted.push_back(symbol);
     std::sort(sorted.begin(), sorted.end());
 
-    json out = json::array();
-    for (const auto &symbol : sorted)
-        out.push_back(symbol);
+    json symbols = json::array();
+    json details = json::array();
+    for (const auto &symbol : sorted) {
+        const Subscription &subscription = subscriptions.at(symbol);
+        symbols.push_back(symbol);
+        details.push_back({{"symbol", symbol},
+                           {"channels", channelNames(subscription.channels)},
+                           {"detectors", detectorNames(subscription.detectors)},
+                           {"priority", priorityName(subscription.priority)}});
+    }
+
+    return json{{"tracked", symbols}, {"subscriptions", details}};
+}
+
+// a plain string tracks everything; an object may narrow channels and detectors
+static std::optional<std::string> parse_subscription(const json &item, std::string &symbol,
+                                                     Subscription &subscription) {
+    subscription = Subscription{};
+
+    if (item.is_string()) {
+        symbol = normalize_symbol(item.get<std::string>());
+    } else if (item.is_object() && item.contains("symbol") && item["symbol"].is_string()) {
+        symbol = normalize_symbol(item["symbol"].get<std::string>());
+    } else {
+        return "ticker entries must be symbols or objects with a symbol";
+    }
+
+    if (!is_valid_symbol(symbol))
+        return "invalid ticker symbol";
+
+    if (!item.is_object())
+        return std::nullopt;
+
+    if (auto it = item.find("channels"); it != item.end()) {
+        if (!it->is_array())
+            return "channels must be an array";
+        subscription.channels = 0;
+        for (const auto &name : *it) {
+            const auto channel =
+                name.is_string() ? parseChannel(name.get<std::string>()) : std::nullopt;
+            if (!channel)
+                return "unknown channel, expected trades, quotes or bars";
+            subscription.channels |= *channel;
+        }
+        if (subscription.channels == 0)
+            return "at least one channel is required";
+    }
+
+    if (auto it = item.find("detectors"); it != item.end()) {
+        if (!it->is_array())
+            return "detectors must be an array";
+        subscription.detectors = 0;
+        for (const auto &name : *it) {
+            const auto type =
+                name.is_string() ? parseDetector(name.get<std::string>()) : std::nullopt;
+            if (!type)
+                return "unknown detector";
+            subscription.detectors |= detectorBit(*type);
+        }
+    }
+
+    if (auto it = item.find("priority"); it != item.end()) {
+        const auto priority =
+            it->is_string() ? parsePriority(it->get<std::string>()) : std::nullopt;
+        if (!priority)
+            return "unknown priority, expected low, normal or high";
+        subscription.priority = *priority;
+    }
+
+    return std::nullopt;
+}
+
+static std::string url_decode(std::string_view in) {
+    std::string out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out.push_back(' ');
+        } else if (in[i] == '%' && i + 2 < in.size() &&
+                   std::isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            out.push_back(
+                static_cast<char>(std::stoi(std::string(in.substr(i + 1, 2)), nullptr, 16)));
+            i += 2;
+        } else {
+            out.push_back(in[i]);
+        }
+    }
+    return out;
+}
+
+static std::unordered_map<std::string, std::string> parse_query(std::string_view query) {
+    std::unordered_map<std::string, std::string> params;
+    while (!query.empty()) {
+        const auto amp = query.find('&');
+        const std::string_view pair = query.substr(0, amp);
+        const auto eq = pair.find('=');
+        if (!pair.empty()) {
+            params[url_decode(pair.substr(0, eq))] =
+                eq == std::string_view::npos ? "" : url_decode(pair.substr(eq + 1));
+        }
+        if (amp == std::string_view::npos)
+            break;
+        query.remove_prefix(amp + 1);
+    }
+    return params;
+}
+
+// "/api/symbols/AAPL/stats" with suffix "/stats" gives "AAPL"
+static std::optional<std::string> symbol_route(const std::string &path, std::string_view suffix) {
+    constexpr std::string_view PREFIX = "/api/symbols/";
+    if (!path.starts_with(PREFIX) || !path.ends_with(suffix) ||
+        path.size() <= PREFIX.size() + suffix.size())
+        return std::nullopt;
+    return normalize_symbol(
+        url_decode(std::string_view(path).substr(PREFIX.size(),
+                                                 path.size() - PREFIX.size() - suffix.size())));
+}
+
+// accepts an RFC 3339 timestamp or an epoch number in s, ms, us or ns (picked by magnitude)
+static std::optional<std::int64_t> parse_time_param(const std::string &value) {
+    if (value.empty())
+        return std::nullopt;
+
+    if (std::all_of(value.begin(), value.end(),
+                    [](unsigned char ch) { return std::isdigit(ch); })) {
+        std::int64_t n = 0;
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), n);
+        if (ec != std::errc())
+            return std::nullopt;
+        std::int64_t scale = 1'000'000'000LL;
+        if (n >= 100'000'000'000'000'000LL)
+            scale = 1;
+        else if (n >= 100'000'000'000'000LL)
+            scale = 1'000;
+        else if (n >= 100'000'000'000LL)
+            scale = 1'000'000;
+        // past year 2262 in nanoseconds, rejected rather than wrapped
+        if (n > std::numeric_limits<std::int64_t>::max() / scale)
+            return std::nullopt;
+        return n * scale;
+    }
+
+    const std::int64_t ns = parseTimestampNs(value);
+    if (ns == 0)
+        return std::nullopt;
+    return ns;
+}
+
+static json lag_json(const FeedLagStats &lag) {
+    return json{{"lagMs", lag.lagMs},
+                {"lastLagMs", lag.lastLagMs},
+                {"peakLagMs", lag.peakLagMs},
+                {"shedLevel", shedLevelName(lag.level)},
+                {"shedSince", lag.levelSinceNs > 0 ? json(formatTimestampNs(lag.levelSinceNs))
+                                                   : json(nullptr)},
+                {"escalations", lag.escalations},
+                {"quotesDropped", lag.quotesDropped},
+                {"detectorsSkipped", lag.detectorsSkipped}};
+}
+
+static json symbol_lag_json(std::string_view symbol, const SymbolLag &lag) {
+    return json{{"symbol", symbol},
+                {"lagMs", lag.lagMs},
+                {"lastLagMs", lag.lastLagMs},
+                {"updated", formatTimestampNs(lag.updatedNs)}};
+}
+
+static json anomaly_json(const Anomaly &a, const FieldSet &fields) {
+    json out = json::object();
+    putField(out, fields, "type", static_cast<int>(a.type));
+    putField(out, fields, "source", static_cast<int>(a.source));
+    putField(out, fields, "direction", static_cast<int>(a.direction));
+    putField(out, fields, "symbol", a.symbol);
+    putField(out, fields, "timestamp", a.timestamp);
+    putField(out, fields, "value", a.value);
+    putField(out, fields, "mean", a.mean);
+    putField(out, fields, "stdev", a.stdev);
+    putField(out, fields, "zscore", a.zscore);
+    putField(out, fields, "lower", a.lower);
+    putField(out, fields, "upper", a.upper);
+    putField(out, fields, "k", a.k);
+    putField(out, fields, "scope", static_cast<int>(a.scope));
+    putField(out, fields, "episodeId", a.episodeId);
+    putField(out, fields, "active", a.active);
+    putField(out, fields, "endTimestamp", a.endTimestamp);
+    putField(out, fields, "durationMs", a.durationMs);
+    putField(out, fields, "eventCount", a.eventCount);
+    putField(out, fields, "peakZscore", a.peakZscore);
+    putField(out, fields, "profile", a.profile);
+    putField(out, fields, "note", a.note);
+    return out;
+}
 
+static json record_json(const AnomalyRecord &r, const FieldSet &fields) {
+    json out = json::object();
+    putField(out, fields, "type", r.type);
+    putField(out, fields, "source", r.source);
+    putField(out, fields, "direction", r.direction);
+    putField(out, fields, "symbol", recordSymbol(r));
+    if (fields.empty() || fields.contains("timestamp"))
+        out["timestamp"] = formatTimestampNs(r.ts_ns);
+    putField(out, fields, "value", r.value);
+    putField(out, fields, "mean", r.mean);
+    putField(out, fields, "stdev", r.stdev);
+    putField(out, fields, "zscore", r.zscore);
+    putField(out, fields, "lower", r.lower);
+    putField(out, fields, "upper", r.upper);
+    putField(out, fields, "k", r.k);
+    putField(out, fields, "scope", r.scope);
+    putField(out, fields, "episodeId", r.episode_id);
+    putField(out, fields, "active", false);
+    if (fields.empty() || fields.contains("endTimestamp"))
+        out["endTimestamp"] = formatTimestampNs(r.end_ns);
+    putField(out, fields, "durationMs", (r.end_ns - r.ts_ns) / 1'000'000);
+    putField(out, fields, "eventCount", r.event_count);
+    putField(out, fields, "peakZscore", r.peak_zscore);
+    putField(out, fields, "profile", recordProfile(r));
+    return out;
+}
+
+static json series_json(const SeriesBucket &b, const FieldSet &fields) {
+    json out = json::object();
+    if (fields.empty() || fields.contains("ts"))
+        out["ts"] = formatTimestampNs(b.start_ns);
+    if (b.trades > 0) {
+        putField(out, fields, "open", b.open);
+        putField(out, fields, "high", b.high);
+        putField(out, fields, "low", b.low);
+        putField(out, fields, "close", b.close);
+    }
+    putField(out, fields, "volume", b.volume);
+    putField(out, fields, "trades", b.trades);
+    if (b.quotes > 0)
+        putField(out, fields, "spread", b.spreadMean());
+    putField(out, fields, "quotes", b.quotes);
     return out;
 }
 
@@ -43,7 +291,7 @@ handle_request(const http::request<http::string_body> &req) {
         res.set(http::field::content_type, "application/json");
         res.set("Access-Control-Allow-Origin", "*");
         res.set("Access-Control-Allow-Headers", "Content-Type");
-        res.set("Access-Control-Allow-Methods", "GET, PUT, OPTIONS");
+        res.set("Access-Control-Allow-Methods", "GET, PUT, DELETE, OPTIONS");
         res.body() = body.dump();
         res.prepare_payload();
         return res;
@@ -53,16 +301,86 @@ handle_request(const http::request<http::string_body> &req) {
         return make_json(http::status::ok, json{{"ok", true}});
     }
 
-    std::string path = std::string(req.target());
+    const std::string target = std::string(req.target());
+    const auto queryPos = target.find('?');
+    const std::string path = target.substr(0, queryPos);
+    const auto params = parse_query(queryPos == std::string::npos
+                                        ? std::string_view{}
+                                        : std::string_view(target).substr(queryPos + 1));
+
+    // bulk endpoints negotiate their encoding and honour a fields= projection
+    auto param = [&](const char *name) {
+        auto it = params.find(name);
+        return it == params.end() ? std::string_view{} : std::string_view(it->second);
+    };
+    const auto accept = req[http::field::accept];
+    const WireFormat format =
+        negotiateWireFormat(param("format"), std::string_view(accept.data(), accept.size()));
+    const FieldSet fields = parseFieldSet(param("fields"));
+
+    auto make_encoded = [&](http::status st, const json &body) {
+        http::response<http::string_body> res{st, req.version()};
+        res.set(http::field::content_type, std::string(wireContentType(format)));
+        res.set("Access-Control-Allow-Origin", "*");
+        res.set("Access-Control-Allow-Headers", "Content-Type");
+        res.set("Access-Control-Allow-Methods", "GET, PUT, DELETE, OPTIONS");
+        res.body() = encodeDocument(body, format);
+        res.prepare_payload();
+        return res;
+    };
+
+    auto make_records = [&](const char *type, std::size_t size, std::uint32_t version,
+                            std::string body) {
+        http::response<http::string_body> res{http::status::ok, req.version()};
+        res.set(http::field::content_type, std::string(wireContentType(WireFormat::Records)));
+        res.set("Access-Control-Allow-Origin", "*");
+        res.set("Access-Control-Allow-Headers", "Content-Type");
+        res.set("Access-Control-Allow-Methods", "GET, PUT, DELETE, OPTIONS");
+        res.set("Access-Control-Expose-Headers", "X-Record-Type, X-Record-Size, X-Record-Version");
+        res.set("X-Record-Type", type);
+        res.set("X-Record-Size", std::to_string(size));
+        res.set("X-Record-Version", std::to_string(version));
+        res.body() = std::move(body);
+        res.prepare_payload();
+        return res;
+    };
+
+    // ?profile= narrows an anomaly listing to one detection profile
+    auto profile_param = [&](std::optional<std::string> &profile)
+        -> std::optional<http::response<http::string_body>> {
+        const std::string_view name = param("profile");
+        if (name.empty())
+            return std::nullopt;
+        if (!isValidProfileName(name))
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid profile"}, {"profile", std::string(name)}});
+        profile = std::string(name);
+        return std::nullopt;
+    };
 
     if (path == "/api/health" && req.method() == http::verb::get) {
-        return make_json(http::status::ok, json{{"ok", true}});
+        const AnomalyLogStats log = anomalyLog.stats();
+        json shm = nullptr;
+        {
+            // the mapping goes away under stateMutex at shutdown
+            std::lock_guard lock(stateMutex);
+            if (shmPublisher.isOpen())
+                shm = json{{"name", shmPublisher.name()},
+                           {"anomaliesPublished", shmPublisher.anomaliesPublished()}};
+        }
+        return make_json(http::status::ok,
+                         json{{"ok", true},
+                              {"anomalyLog",
+                               {{"queued", log.queued},
+                                {"written", log.written},
+                                {"dropped", log.dropped}}},
+                              {"sharedMemory", shm}});
     }
 
     if (path == "/api/tickers" && req.method() == http::verb::get) {
         json out = json::array();
         {
-            std::lock_guard<std::mutex> lock(stateMutex); // acquire lock
+            std::lock_guard lock(stateMutex); // acquire lock
             for (auto const &pair : bySymbol)
                 out.push_back(pair.first);
         }
@@ -81,52 +399,522 @@ handle_request(const http::request<http::string_body> &req) {
             return make_json(http::status::bad_request, json{{"error", "expected ticker array"}});
         }
 
-        std::unordered_set<std::string> nextTrackedSymbols;
+        SubscriptionMap nextTrackedSymbols;
         for (const auto &item : body) {
-            if (!item.is_string()) {
+            std::string symbol;
+            Subscription subscription;
+            if (auto error = parse_subscription(item, symbol, subscription)) {
                 return make_json(http::status::bad_request,
-                                 json{{"error", "ticker symbols must be strings"}});
+                                 json{{"error", *error}, {"symbol", symbol}});
             }
 
-            std::string symbol = normalize_symbol(item.get<std::string>());
-            if (!is_valid_symbol(symbol)) {
-                return make_json(http::status::bad_request,
-                                 json{{"error", "invalid ticker symbol"}, {"symbol", symbol}});
-            }
+            nextTrackedSymbols[symbol] = subscription;
+        }
 
-            nextTrackedSymbols.insert(symbol);
+        // symbols reclaimed earlier get their windows back before the feed resumes
+        std::unordered_set<std::string> added;
+        {
+            std::lock_guard lock(subscriptionMutex);
+            for (const auto &[symbol, subscription] : nextTrackedSymbols) {
+                if (!trackedSymbols.contains(symbol))
+                    added.insert(symbol);
+            }
         }
+        if (!added.empty())
+            symbolLifecycle.restore(added);
 
         {
-            std::lock_guard<std::mutex> lock(subscriptionMutex);
+            std::lock_guard lock(subscriptionMutex);
             trackedSymbols = nextTrackedSymbols;
+            subscriptionGeneration.fetch_add(1, std::memory_order_release);
         }
         subscriptionCv.notify_all();
 
-        return make_json(http::status::ok, json{{"tracked", symbols_json(nextTrackedSymbols)}});
+        return make_json(http::status::ok, tracked_json(nextTrackedSymbols));
+    }
+
+    if (path == "/api/tickers/tracked" && req.method() == http::verb::get) {
+        SubscriptionMap current;
+        {
+            std::lock_guard lock(subscriptionMutex);
+            current = trackedSymbols;
+        }
+        return make_json(http::status::ok, tracked_json(current));
+    }
+
+    if (path == "/api/feed" && req.method() == http::verb::get) {
+        json connections = json::array();
+        for (const auto &c : feedConnections()) {
+            connections.push_back({{"index", c.index},
+                                   {"connected", c.connected},
+                                   {"symbols", c.symbols},
+                                   {"messages", c.messages},
+                                   {"lag", lag_json(c.lag)}});
+        }
+        const FeedLagConfig &lag = feedLagConfig();
+
+        const ConflationStats conflation = quoteConflator.stats();
+        const RuntimeStatus runtime = runtimeStatus();
+        return make_json(http::status::ok,
+                         json{{"connections", connections},
+                              {"conflation",
+                               {{"enabled", conflation.enabled},
+                                {"quotesIn", conflation.quotesIn},
+                                {"quotesConflated", conflation.quotesConflated},
+                                {"flushes", conflation.flushes},
+                                {"pendingSymbols", conflation.pendingSymbols}}},
+                              {"shedding",
+                               {{"conflateMs", lag.conflate.count()},
+                                {"skipDetectorsMs", lag.skipDetectors.count()},
+                                {"dropQuotesMs", lag.dropQuotes.count()},
+                                {"recoverAfterMs", lag.recoverAfter.count()}}},
+                              {"runtime",
+                               {{"lowLatency", runtime.lowLatency},
+                                {"busyPoll", runtime.busyPoll},
+                                {"memoryLocked", runtime.memoryLocked},
+                                {"futureMemoryLocked", runtime.futureMemoryLocked},
+                                {"pinnedThreads", runtime.pinnedThreads},
+                                {"fifoThreads", runtime.fifoThreads},
+                                {"warnings", runtime.warnings}}}});
+    }
+
+    if (path == "/api/feed/lag" && req.method() == http::verb::get) {
+        std::size_t limit = 20;
+        if (auto v = param("limit"); !v.empty()) {
+            auto [ptr, ec] = std::from_chars(v.data(), v.data() + v.size(), limit);
+            if (ec != std::errc{} || ptr != v.data() + v.size() || limit == 0) {
+                return make_json(http::status::bad_request,
+                                 json{{"error", "limit must be a positive integer"}});
+            }
+        }
+
+        json symbols = json::array();
+        for (const auto &[id, lag] : worstSymbolLags(limit))
+            symbols.push_back(symbol_lag_json(symbolName(id), lag));
+
+        json connections = json::array();
+        for (const auto &c : feedConnections())
+            connections.push_back({{"index", c.index}, {"lag", lag_json(c.lag)}});
+        return make_json(http::status::ok,
+                         json{{"connections", connections}, {"symbols", symbols}});
+    }
+
+    if (path == "/api/memory" && req.method() == http::verb::get) {
+        const MemoryReport report = symbolLifecycle.report();
+
+        json symbols = json::array();
+        for (const auto &entry : report.symbols) {
+            symbols.push_back({{"symbol", entry.symbol},
+                               {"bytes", entry.bytes},
+                               {"tracked", entry.tracked},
+                               {"lastEventTs", entry.lastEventNs > 0
+                                                   ? formatTimestampNs(entry.lastEventNs)
+                                                   : std::string{}},
+                               {"reclaimInSec", entry.reclaimInSec}});
+        }
+
+        return make_json(http::status::ok, json{{"totalBytes", report.totalBytes},
+                                                {"budgetBytes", report.budgetBytes},
+                                                {"symbolCount", report.symbols.size()},
+                                                {"reclaimed", report.reclaimed},
+                                                {"evicted", report.evicted},
+                                                {"restored", report.restored},
+                                                {"symbols", symbols}});
+    }
+
+    // zeros and enabled: false unless main was built with -DSAR_INSTRUMENT=ON
+    if (path == "/api/instrumentation" && req.method() == http::verb::get) {
+        const InstrumentReport report = instrumentReport();
+
+        json stages = json::object();
+        for (std::size_t i = 0; i < ALLOC_STAGES; ++i) {
+            const AllocCounters &s = report.stages[i];
+            stages[std::string(allocStageName(static_cast<AllocStage>(i)))] = {
+                {"entries", s.entries},
+                {"allocations", s.allocations},
+                {"bytes", s.bytes},
+                {"frees", s.frees}};
+        }
+
+        json locks = json::object();
+        for (std::size_t i = 0; i < LOCK_IDS; ++i) {
+            const LockCounters &l = report.locks[i];
+            locks[std::string(lockName(static_cast<LockId>(i)))] = {
+                {"acquisitions", l.acquisitions},
+                {"contended", l.contended},
+                {"waitNs", l.waitNs},
+                {"maxWaitNs", l.maxWaitNs},
+                {"holdNs", l.holdNs},
+                {"maxHoldNs", l.maxHoldNs}};
+        }
+
+        return make_json(http::status::ok,
+                         json{{"enabled", report.enabled}, {"stages", stages}, {"locks", locks}});
+    }
+
+    if (path == "/api/profiles" && req.method() == http::verb::get) {
+        json out = json::array();
+        for (const auto &profile : detectionProfiles.list())
+            out.push_back(profileJson(profile));
+        return make_json(http::status::ok, out);
+    }
+
+    // PUT replaces the whole profile, fields left out take the defaults
+    if (path.starts_with("/api/profiles/") &&
+        (req.method() == http::verb::put || req.method() == http::verb::delete_)) {
+        const std::string name = url_decode(std::string_view(path).substr(14));
+        if (!isValidProfileName(name)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "profile names are 1-8 characters of a-z, 0-9, - "
+                                            "and _"},
+                                  {"profile", name}});
+        }
+
+        if (req.method() == http::verb::delete_) {
+            if (name == DEFAULT_PROFILE) {
+                return make_json(http::status::bad_request,
+                                 json{{"error", "the default profile cannot be removed"}});
+            }
+            if (!detectionProfiles.remove(name)) {
+                return make_json(http::status::not_found,
+                                 json{{"error", "no such profile"}, {"profile", name}});
+            }
+            return make_json(http::status::ok, json{{"removed", name}});
+        }
+
+        json body;
+        try {
+            body = json::parse(req.body());
+        } catch (const json::parse_error &) {
+            return make_json(http::status::bad_request, json{{"error", "invalid JSON"}});
+        }
+
+        DetectionProfile profile;
+        if (auto error = parseProfile(body, profile))
+            return make_json(http::status::bad_request, json{{"error", *error}});
+        if (body.contains("name") && profile.name != name) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "name does not match the path"}});
+        }
+        profile.name = name;
+
+        if (auto error = detectionProfiles.put(profile)) {
+            return make_json(http::status::internal_server_error,
+                             json{{"error", *error}, {"profile", profileJson(profile)}});
+        }
+        return make_json(http::status::ok, profileJson(profile));
     }
 
     if (path == "/api/anomalies" && req.method() == http::verb::get) {
+        std::optional<std::string> profile;
+        if (auto error = profile_param(profile))
+            return *error;
+        auto wanted = [&](const Anomaly &a) { return !profile || a.profile == *profile; };
+
+        if (format == WireFormat::Records) {
+            std::string body;
+            {
+                std::lock_guard lock(stateMutex);
+                body.reserve(recentAnomalies.size() * sizeof(AnomalyRecord));
+                for (const auto &a : recentAnomalies) {
+                    if (!wanted(a))
+                        continue;
+                    const AnomalyRecord record = toAnomalyRecord(a);
+                    body.append(reinterpret_cast<const char *>(&record), sizeof(record));
+                }
+            }
+            return make_records("anomaly", sizeof(AnomalyRecord), 1, std::move(body));
+        }
+
         json out = json::array();
         {
-            std::lock_guard<std::mutex> lock(stateMutex); // acquire locks
+            std::lock_guard lock(stateMutex); // acquire locks
             for (auto const &a : recentAnomalies) {
-                out.push_back({{"type", static_cast<int>(a.type)},
-                               {"source", static_cast<int>(a.source)},
-                               {"direction", static_cast<int>(a.direction)},
-                               {"symbol", a.symbol},
-                               {"timestamp", a.timestamp},
-                               {"value", a.value},
-                               {"mean", a.mean},
-                               {"stdev", a.stdev},
-                               {"zscore", a.zscore},
-                               {"lower", a.lower},
-                               {"upper", a.upper},
-                               {"k", a.k},
-                               {"note", a.note}});
+                if (wanted(a))
+                    out.push_back(anomaly_json(a, fields));
             }
         }
-        return make_json(http::status::ok, out);
+        return make_encoded(http::status::ok, out);
+    }
+
+    if (path == "/api/state" && req.method() == http::verb::get) {
+        std::optional<std::string> only;
+        if (auto it = params.find("symbol"); it != params.end() && !it->second.empty())
+            only = normalize_symbol(it->second);
+
+        // rows are copied out under the lock and encoded after it is released
+        std::vector<StateRecord> rows;
+        {
+            std::lock_guard lock(stateMutex);
+            if (only) {
+                if (auto it = bySymbol.find(*only); it != bySymbol.end())
+                    rows.push_back(toStateRecord(it->first, it->second));
+            } else {
+                rows.reserve(bySymbol.size());
+                for (const auto &[symbol, state] : bySymbol)
+                    rows.push_back(toStateRecord(symbol, state));
+            }
+        }
+
+        if (format == WireFormat::Records) {
+            std::string body(reinterpret_cast<const char *>(rows.data()),
+                             rows.size() * sizeof(StateRecord));
+            return make_records("state", sizeof(StateRecord), STATE_RECORD_VERSION,
+                                std::move(body));
+        }
+
+        json out = json::array();
+        for (const auto &row : rows)
+            out.push_back(stateJson(row, fields));
+        return make_encoded(http::status::ok, out);
+    }
+
+    // stat blocks are seqlocked, neither route takes stateMutex
+    if (path == "/api/stats" && req.method() == http::verb::get) {
+        json out = json::array();
+        for (const auto &stats : statsBoard.readAll())
+            out.push_back(statsJson(stats, fields));
+        return make_encoded(http::status::ok, out);
+    }
+
+    if (auto symbol = symbol_route(path, "/stats"); symbol && req.method() == http::verb::get) {
+        if (!is_valid_symbol(*symbol)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+        }
+        SymbolStats stats;
+        if (!statsBoard.read(findSymbol(*symbol), stats)) {
+            return make_json(http::status::not_found,
+                             json{{"error", "no statistics for symbol"}, {"symbol", *symbol}});
+        }
+        return make_encoded(http::status::ok, statsJson(stats, fields));
+    }
+
+    if (auto symbol = symbol_route(path, "/quantiles");
+        symbol && req.method() == http::verb::get) {
+        if (!is_valid_symbol(*symbol)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+        }
+
+        std::vector<double> qs;
+        std::string_view list = param("q").empty() ? "0.5,0.9,0.99,0.999" : param("q");
+        for (const auto &item : parseFieldSet(list)) {
+            char *end = nullptr;
+            const double q = std::strtod(item.c_str(), &end);
+            if (end != item.c_str() + item.size() || !(q >= 0.0 && q <= 1.0)) {
+                return make_json(http::status::bad_request,
+                                 json{{"error", "q must be fractions in [0, 1]"}, {"q", item}});
+            }
+            qs.push_back(q);
+        }
+        std::sort(qs.begin(), qs.end());
+
+        // sketches are a few KB, copy them out and query after the lock is released
+        QuantileSketch sizes, spreads;
+        {
+            std::lock_guard lock(stateMutex);
+            auto it = bySymbol.find(*symbol);
+            if (it == bySymbol.end()) {
+                return make_json(http::status::not_found,
+                                 json{{"error", "unknown symbol"}, {"symbol", *symbol}});
+            }
+            sizes = it->second.tradeSizeQuantiles;
+            spreads = it->second.spreadQuantiles;
+        }
+
+        auto sketch_json = [&](const QuantileSketch &sketch) {
+            json quantiles = json::object();
+            for (double q : qs) {
+                char key[32];
+                std::snprintf(key, sizeof(key), "%g", q);
+                quantiles[key] = sketch.empty() ? json(nullptr) : json(sketch.quantile(q));
+            }
+            return json{{"count", sketch.count()},
+                        {"min", sketch.min()},
+                        {"max", sketch.max()},
+                        {"quantiles", quantiles}};
+        };
+        return make_encoded(http::status::ok,
+                            json{{"symbol", *symbol},
+                                 {"tradeSize", sketch_json(sizes)},
+                                 {"spread", sketch_json(spreads)},
+                                 {"blockTradePercentile", tradeSizePercentile()}});
+    }
+
+    if (auto symbol = symbol_route(path, "/lag"); symbol && req.method() == http::verb::get) {
+        if (!is_valid_symbol(*symbol)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+        }
+        const auto lag = symbolLag(findSymbol(*symbol));
+        if (!lag) {
+            return make_json(http::status::not_found, json{{"error", "no trades or quotes for symbol"},
+                                                           {"symbol", *symbol}});
+        }
+        return make_json(http::status::ok, symbol_lag_json(*symbol, *lag));
+    }
+
+    if (auto symbol = symbol_route(path, "/seasonality");
+        symbol && req.method() == http::verb::get) {
+        if (!is_valid_symbol(*symbol)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+        }
+        auto profile = findVolumeProfile(*symbol);
+        if (!profile) {
+            return make_json(http::status::not_found,
+                             json{{"error", "no volume profile for symbol"}, {"symbol", *symbol}});
+        }
+
+        // updateState writes the buckets under stateMutex
+        std::array<SeasonalExpectation, SESSION_MINUTES> minutes;
+        {
+            std::lock_guard lock(stateMutex);
+            for (std::size_t i = 0; i < SESSION_MINUTES; ++i)
+                minutes[i] = profile->expected(static_cast<int>(i));
+        }
+
+        json out = json::array();
+        for (const auto &m : minutes) {
+            const int clock = 9 * 60 + 30 + m.minute;
+            char hhmm[16]; // room for any int, not just 09:30-16:00
+            std::snprintf(hhmm, sizeof(hhmm), "%02d:%02d", clock / 60, clock % 60);
+            out.push_back({{"minute", m.minute},
+                           {"time", hhmm},
+                           {"sessions", m.sessions},
+                           {"mean", m.mean},
+                           {"stdev", m.stdev}});
+        }
+        return make_encoded(http::status::ok,
+                            json{{"symbol", *symbol}, {"timezone", "America/New_York"},
+                                 {"minutes", out}});
+    }
+
+    if (auto symbol = symbol_route(path, "/series"); symbol && req.method() == http::verb::get) {
+        if (!is_valid_symbol(*symbol)) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+        }
+        const std::string_view resName = param("res").empty() ? "1m" : param("res");
+        const auto resolution = parseSeriesResolution(resName);
+        if (!resolution) {
+            return make_json(http::status::bad_request,
+                             json{{"error", "res must be 1s, 1m or 5m"}});
+        }
+
+        std::int64_t fromNs = std::numeric_limits<std::int64_t>::min();
+        std::int64_t toNs = std::numeric_limits<std::int64_t>::max();
+        for (auto [name, bound] : {std::pair{"from", &fromNs}, std::pair{"to", &toNs}}) {
+            auto it = params.find(name);
+            if (it == params.end())
+                continue;
+            auto ns = parse_time_param(it->second);
+            if (!ns) {
+                return make_json(http::status::bad_request,
+                                 json{{"error", std::string("invalid ") + name + " time"}});
+            }
+            *bound = *ns;
+        }
+
+        std::size_t limit = std::numeric_limits<std::size_t>::max();
+        if (auto it = params.find("limit"); it != params.end()) {
+            std::size_t n = 0;
+            auto [ptr, ec] =
+                std::from_chars(it->second.data(), it->second.data() + it->second.size(), n);
+            if (ec != std::errc() || ptr != it->second.data() + it->second.size() || n == 0) {
+                return make_json(http::status::bad_request, json{{"error", "invalid limit"}});
+            }
+            limit = n;
+        }
+
+        // buckets are copied under the lock, at most a few hundred KB
+        std::vector<SeriesBucket> buckets;
+        {
+            std::lock_guard lock(stateMutex);
+            auto it = bySymbol.find(*symbol);
+            if (it == bySymbol.end()) {
+                return make_json(http::status::not_found,
+                                 json{{"error", "unknown symbol"}, {"symbol", *symbol}});
+            }
+            it->second.series.ring(*resolution).forEach(
+                fromNs, toNs, limit, [&](const SeriesBucket &b) { buckets.push_back(b); });
+        }
+
+        if (format == WireFormat::Records) {
+            std::string body(reinterpret_cast<const char *>(buckets.data()),
+                             buckets.size() * sizeof(SeriesBucket));
+            return make_records("series", sizeof(SeriesBucket), 1, std::move(body));
+        }
+
+        json points = json::array();
+        for (const auto &b : buckets)
+            points.push_back(series_json(b, fields));
+        return make_encoded(http::status::ok,
+                            json{{"symbol", *symbol}, {"res", resName}, {"points", points}});
+    }
+
+    if (path == "/api/anomalies/history" && req.method() == http::verb::get) {
+        constexpr std::size_t DEFAULT_LIMIT = 1000;
+        constexpr std::size_t MAX_LIMIT = 10000;
+
+        std::optional<std::string> symbol;
+        if (auto it = params.find("symbol"); it != params.end() && !it->second.empty()) {
+            symbol = normalize_symbol(it->second);
+            if (!is_valid_symbol(*symbol) && *symbol != "MARKET") {
+                return make_json(http::status::bad_request,
+                                 json{{"error", "invalid ticker symbol"}, {"symbol", *symbol}});
+            }
+        }
+
+        std::optional<std::string> profile;
+        if (auto error = profile_param(profile))
+            return *error;
+
+        std::int64_t fromNs = std::numeric_limits<std::int64_t>::min();
+        std::int64_t toNs = std::numeric_limits<std::int64_t>::max();
+        for (auto [name, bound] : {std::pair{"from", &fromNs}, std::pair{"to", &toNs}}) {
+            auto it = params.find(name);
+            if (it == params.end())
+                continue;
+            auto ns = parse_time_param(it->second);
+            if (!ns) {
+                return make_json(http::status::bad_request,
+                                 json{{"error", std::string("invalid ") + name + " time"}});
+            }
+            *bound = *ns;
+        }
+
+        std::size_t limit = DEFAULT_LIMIT;
+        if (auto it = params.find("limit"); it != params.end()) {
+            std::size_t n = 0;
+            auto [ptr, ec] =
+                std::from_chars(it->second.data(), it->second.data() + it->second.size(), n);
+            if (ec != std::errc() || ptr != it->second.data() + it->second.size() || n == 0) {
+                return make_json(http::status::bad_request, json{{"error", "invalid limit"}});
+            }
+            limit = std::min(n, MAX_LIMIT);
+        }
+
+        if (!anomalyStore.isOpen()) {
+            return make_json(http::status::service_unavailable,
+                             json{{"error", "anomaly history is not enabled"}});
+        }
+
+        // records are read straight out of the mapped segments, no stateMutex needed
+        if (format == WireFormat::Records) {
+            std::string body;
+            anomalyStore.query(symbol, profile, fromNs, toNs, limit, [&](const AnomalyRecord &r) {
+                body.append(reinterpret_cast<const char *>(&r), sizeof(r));
+            });
+            return make_records("anomaly", sizeof(AnomalyRecord), 1, std::move(body));
+        }
+
+        json out = json::array();
+        anomalyStore.query(symbol, profile, fromNs, toNs, limit, [&](const AnomalyRecord &r) {
+            out.push_back(record_json(r, fields));
+        });
+        return make_encoded(http::status::ok, out);
     }
 
     if (req.method() != http::verb::get) {
@@ -137,6 +925,7 @@ handle_request(const http::request<http::string_body> &req) {
 }
 
 static void do_session(tcp::socket socket) {
+    AllocScope stage(AllocStage::Api);
     beast::flat_buffer buffer;
     http::request<http::string_body> req;
 
@@ -5,6 +5,7 @@
 
 #include <condition_variable>
 #include "anomaly_detector.h"
+#include "data_parser.h"
 #include "shared_state.h"
 #include <deque>
 #include <mutex>
@@ -21,9 +22,9 @@ using json = nlohmann::json;
 
 extern std::unordered_map<std::string, SymbolState> bySymbol;
 extern std::deque<Anomaly> recentAnomalies; // keep last N anomalies
-extern std::mutex stateMutex;
-extern std::unordered_set<std::string> trackedSymbols;
-extern std::mutex subscriptionMutex;
-extern std::condition_variable subscriptionCv;
+extern TrackedMutex<LockId::State> stateMutex;
+extern SubscriptionMap trackedSymbols;
+extern TrackedMutex<LockId::Subscription> subscriptionMutex;
+extern TrackedConditionVariable subscriptionCv;
 
 void run_http_server(unsigned short port);
@@ -0,0 +1,94 @@
+// Throughput of the cross-symbol correlation engine.
+//
+// Simulates N symbols that all print once per grid interval, driven by a common market
+// factor plus a sector factor plus noise, and times the observe() calls that roll the grid
+// (those carry the full matrix update).
+//
+//   ./correlation_bench [symbols=2000] [buckets=300]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "correlation.h"
+
+int main(int argc, char *argv[]) {
+    const std::size_t symbols = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    const std::size_t buckets = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 300;
+    constexpr std::size_t SECTORS = 10;
+    constexpr std::int64_t SECOND = 1'000'000'000LL;
+
+    CorrelationEngine engine(symbols);
+
+    std::vector<std::string> names(symbols);
+    std::vector<double> prices(symbols, 100.0);
+    for (std::size_t i = 0; i < symbols; ++i)
+        names[i] = "S" + std::to_string(i);
+
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    std::vector<double> closeNs;
+    closeNs.reserve(buckets);
+    std::size_t anomalies = 0;
+    std::int64_t ts = 1'700'000'000LL * SECOND;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t b = 0; b < buckets; ++b) {
+        const double market = 0.0005 * noise(rng);
+        std::vector<double> sector(SECTORS);
+        for (auto &s : sector)
+            s = 0.0005 * noise(rng);
+
+        ts += SECOND;
+        for (std::size_t i = 0; i < symbols; ++i) {
+            const double r = market + sector[i % SECTORS] + 0.0005 * noise(rng);
+            prices[i] *= std::exp(r);
+
+            // the first print of a new interval closes the previous bucket
+            if (i == 0) {
+                const auto t0 = std::chrono::steady_clock::now();
+                engine.observe(names[i], ts + static_cast<std::int64_t>(i), prices[i]);
+                const auto t1 = std::chrono::steady_clock::now();
+                closeNs.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+            } else {
+                engine.observe(names[i], ts + static_cast<std::int64_t>(i), prices[i]);
+            }
+        }
+        anomalies += engine.takeAnomalies().size();
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    const double totalSec = std::chrono::duration<double>(end - start).count();
+    std::sort(closeNs.begin(), closeNs.end());
+    auto pct = [&](double p) {
+        return closeNs[std::min(closeNs.size() - 1, static_cast<std::size_t>(p * closeNs.size()))];
+    };
+    double sum = 0.0;
+    for (double v : closeNs)
+        sum += v;
+    const double mean = sum / static_cast<double>(closeNs.size());
+
+    // upper triangle including the diagonal
+    const double cells = static_cast<double>(symbols) * static_cast<double>(symbols + 1) / 2.0;
+
+    std::printf("symbols            %zu\n", symbols);
+    std::printf("buckets            %zu\n", buckets);
+    std::printf("observe calls/s    %.0f\n", static_cast<double>(symbols * buckets) / totalSec);
+    std::printf("bucket close mean  %.1f us\n", mean / 1e3);
+    std::printf("bucket close p50   %.1f us\n", pct(0.50) / 1e3);
+    std::printf("bucket close p99   %.1f us\n", pct(0.99) / 1e3);
+    std::printf("matrix cells/s     %.3g\n", cells / (mean / 1e9));
+    std::printf("anomalies emitted  %zu\n", anomalies);
+
+    if (auto c = engine.correlation("S0", "S10"))
+        std::printf("corr same sector   %.3f\n", *c);
+    if (auto c = engine.correlation("S0", "S1"))
+        std::printf("corr other sector  %.3f\n", *c);
+    return 0;
+}
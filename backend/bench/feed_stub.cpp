@@ -0,0 +1,177 @@
+// Local stand-in for Alpaca's market data stream.
+//
+// Speaks just enough of the protocol for the backend: sends the connected and authenticated
+// messages, acknowledges subscribe/unsubscribe, then streams synthetic quotes, trades and
+// bars (random walks) for whatever each connection subscribed to. Any key/secret is accepted.
+// Every client gets its own thread, so SAR_FEED_CONNECTIONS > 1 can be tried locally:
+//
+//   ./feed_stub [port=9100] [events_per_sec=2000]
+//   SAR_FEED_URL=ws://127.0.0.1:9100/v2/iex ./main
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "data_parser.h"
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using json = nlohmann::json;
+
+namespace {
+
+struct Channels {
+    std::set<std::string> trades, quotes, bars;
+};
+
+void apply(Channels &channels, const json &msg) {
+    const bool subscribe = msg.value("action", "") == "subscribe";
+    auto update = [&](const char *name, std::set<std::string> &set) {
+        if (!msg.contains(name))
+            return;
+        for (const auto &s : msg[name]) {
+            if (subscribe)
+                set.insert(s.get<std::string>());
+            else
+                set.erase(s.get<std::string>());
+        }
+    };
+    update("trades", channels.trades);
+    update("quotes", channels.quotes);
+    update("bars", channels.bars);
+}
+
+json ack(const Channels &channels) {
+    return json::array({{{"T", "subscription"},
+                         {"trades", channels.trades},
+                         {"quotes", channels.quotes},
+                         {"bars", channels.bars}}});
+}
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void serve(tcp::socket socket, double eventsPerSec, std::uint64_t seed) {
+    websocket::stream<tcp::socket> ws{std::move(socket)};
+    ws.accept();
+    ws.text(true);
+
+    beast::flat_buffer buffer;
+    ws.write(net::buffer(std::string(R"([{"T":"success","msg":"connected"}])")));
+    ws.read(buffer);
+    buffer.consume(buffer.size());
+    ws.write(net::buffer(std::string(R"([{"T":"success","msg":"authenticated"}])")));
+
+    Channels channels;
+    std::map<std::string, double> prices;
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    std::uniform_int_distribution<int> size(1, 500);
+
+    // events go out in batches of 10, like the real feed groups them
+    constexpr int BATCH = 10;
+    const auto interval = std::chrono::duration<double>(BATCH / eventsPerSec);
+    auto next = std::chrono::steady_clock::now();
+    std::int64_t lastBarMinute = now_ns() / 60'000'000'000LL;
+
+    for (;;) {
+        // subscription changes are small frames, read them whenever something is waiting
+        while (ws.next_layer().available() > 0) {
+            ws.read(buffer);
+            const json msg = json::parse(beast::buffers_to_string(buffer.data()), nullptr, false);
+            buffer.consume(buffer.size());
+            if (msg.is_object() && msg.contains("action")) {
+                apply(channels, msg);
+                ws.write(net::buffer(ack(channels).dump()));
+            }
+        }
+
+        std::this_thread::sleep_until(next);
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+
+        std::vector<std::string> active;
+        for (const auto *set : {&channels.quotes, &channels.trades})
+            active.insert(active.end(), set->begin(), set->end());
+        if (active.empty())
+            continue;
+
+        const std::int64_t ts = now_ns();
+        json batch = json::array();
+        for (int i = 0; i < BATCH; ++i) {
+            const std::string &symbol = active[rng() % active.size()];
+            double &price = prices.try_emplace(symbol, 100.0).first->second;
+            price *= std::exp(0.0005 * noise(rng));
+
+            const bool quote = channels.quotes.contains(symbol) &&
+                               (!channels.trades.contains(symbol) || rng() % 2 == 0);
+            if (quote) {
+                const double half = 0.01 + 0.005 * std::abs(noise(rng));
+                batch.push_back({{"T", "q"}, {"S", symbol}, {"bx", "V"}, {"bp", price - half},
+                                 {"bs", size(rng)}, {"ax", "V"}, {"ap", price + half},
+                                 {"as", size(rng)}, {"c", {"R"}}, {"z", "C"},
+                                 {"t", formatTimestampNs(ts)}});
+            } else {
+                batch.push_back({{"T", "t"}, {"S", symbol}, {"p", price}, {"s", size(rng)},
+                                 {"x", "V"}, {"c", {"@"}}, {"z", "C"},
+                                 {"t", formatTimestampNs(ts)}});
+            }
+        }
+
+        // one minute bar per subscribed symbol whenever the wall clock minute rolls
+        const std::int64_t minute = ts / 60'000'000'000LL;
+        if (minute != lastBarMinute) {
+            lastBarMinute = minute;
+            for (const auto &symbol : channels.bars) {
+                const double close = prices.try_emplace(symbol, 100.0).first->second;
+                batch.push_back({{"T", "b"}, {"S", symbol}, {"o", close}, {"h", close * 1.001},
+                                 {"l", close * 0.999}, {"c", close}, {"v", size(rng) * 100},
+                                 {"n", size(rng)}, {"vw", close},
+                                 {"t", formatTimestampNs((minute - 1) * 60'000'000'000LL)}});
+            }
+        }
+
+        ws.write(net::buffer(batch.dump()));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const unsigned short port =
+        static_cast<unsigned short>(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 9100);
+    const double eventsPerSec = argc > 2 ? std::strtod(argv[2], nullptr) : 2000.0;
+
+    net::io_context ioc;
+    tcp::acceptor acceptor{ioc, {tcp::v4(), port}};
+    std::printf("feed stub listening on ws://127.0.0.1:%u, %.0f events/s per connection\n", port,
+                eventsPerSec);
+
+    for (std::uint64_t seed = 1;; ++seed) {
+        tcp::socket socket{ioc};
+        acceptor.accept(socket);
+        std::thread([s = std::move(socket), eventsPerSec, seed]() mutable {
+            try {
+                serve(std::move(s), eventsPerSec, seed);
+            } catch (const std::exception &e) {
+                std::cerr << "client " << seed << " gone: " << e.what() << "\n";
+            }
+        }).detach();
+    }
+}
@@ -0,0 +1,183 @@
+// Receive-side latency of the feed reader with the low-latency mode off and on.
+//
+// A sender thread writes a timestamped 16-byte message over loopback TCP every interval and
+// the reader records how long each one took from send() to the moment it was read. "off" is
+// what the backend does by default: a blocking recv on an unpinned SCHED_OTHER thread. "on"
+// goes through the same runtime_mode calls as the backend: the reader is pinned, spins on a
+// non-blocking socket and asks for SCHED_FIFO, and memory is locked. Steps the machine does
+// not permit are reported and skipped, see the pinned/fifo/locked columns of each row.
+//
+//   ./jitter_bench [messages=100000] [interval_us=50] [reader_cpu=1] [sender_cpu=2]
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "runtime_mode.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Message {
+    std::uint64_t seq;
+    std::int64_t sentNs;
+};
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch())
+        .count();
+}
+
+// connected loopback pair, [0] reads and [1] writes
+bool loopback_pair(int fds[2]) {
+    const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr *>(&addr), len) != 0 ||
+        ::listen(listener, 1) != 0 ||
+        ::getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &len) != 0)
+        return false;
+
+    fds[1] = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fds[1] < 0 || ::connect(fds[1], reinterpret_cast<sockaddr *>(&addr), len) != 0)
+        return false;
+    fds[0] = ::accept(listener, nullptr, nullptr);
+    ::close(listener);
+
+    const int one = 1;
+    ::setsockopt(fds[1], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fds[0] >= 0;
+}
+
+void send_paced(int fd, std::size_t messages, std::chrono::microseconds interval) {
+    enterThreadRole(ThreadRole::Worker);
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < messages; ++i) {
+        const auto due = start + interval * static_cast<std::int64_t>(i);
+        // sleep while there is time, spin the last stretch so sends stay on schedule
+        while (Clock::now() < due) {
+            if (due - Clock::now() > std::chrono::microseconds(200))
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        const Message m{i, now_ns()};
+        ::send(fd, &m, sizeof(m), MSG_NOSIGNAL);
+    }
+}
+
+// latencies in nanoseconds, one per message
+std::vector<double> receive(int fd, std::size_t messages, bool busyPoll) {
+    enterThreadRole(ThreadRole::Reader);
+    if (busyPoll)
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    std::vector<double> latencies;
+    latencies.reserve(messages);
+    char buffer[4096];
+    std::size_t held = 0;
+
+    while (latencies.size() < messages) {
+        const ssize_t n = ::recv(fd, buffer + held, sizeof(buffer) - held, 0);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            cpuRelax();
+            continue;
+        }
+        if (n <= 0)
+            break;
+
+        const std::int64_t receivedNs = now_ns();
+        held += static_cast<std::size_t>(n);
+        std::size_t used = 0;
+        for (; used + sizeof(Message) <= held; used += sizeof(Message)) {
+            Message m;
+            std::memcpy(&m, buffer + used, sizeof(m));
+            latencies.push_back(static_cast<double>(receivedNs - m.sentNs));
+        }
+        std::memmove(buffer, buffer + used, held - used);
+        held -= used;
+    }
+    return latencies;
+}
+
+void run(const char *label, std::size_t messages, std::chrono::microseconds interval) {
+    int fds[2] = {-1, -1};
+    if (!loopback_pair(fds)) {
+        std::fprintf(stderr, "loopback socket setup failed: %s\n", std::strerror(errno));
+        std::exit(1);
+    }
+
+    std::vector<double> latencies;
+    std::thread reader([&] { latencies = receive(fds[0], messages, runtimeStatus().busyPoll); });
+    std::thread sender(send_paced, fds[1], messages, interval);
+    sender.join();
+    reader.join();
+    ::close(fds[0]);
+    ::close(fds[1]);
+
+    // the first messages pay for connection warmup and page faults in every mode
+    const std::size_t warmup = std::min<std::size_t>(latencies.size() / 100, 1000);
+    latencies.erase(latencies.begin(), latencies.begin() + static_cast<std::ptrdiff_t>(warmup));
+    if (latencies.empty())
+        return;
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) {
+        return latencies[std::min(latencies.size() - 1,
+                                  static_cast<std::size_t>(p * latencies.size()))] /
+               1000.0;
+    };
+
+    const RuntimeStatus status = runtimeStatus();
+    std::printf("%-4s %9zu %8.2f %8.2f %8.2f %8.2f %8.2f %9.2f   pinned=%u fifo=%u locked=%d\n",
+                label, latencies.size(), pct(0.5), pct(0.9), pct(0.99), pct(0.999), pct(0.9999),
+                latencies.back() / 1000.0, status.pinnedThreads, status.fifoThreads,
+                status.memoryLocked ? 1 : 0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const std::size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const std::chrono::microseconds interval(argc > 2 ? std::strtol(argv[2], nullptr, 10) : 50);
+    const int readerCpu = argc > 3 ? std::atoi(argv[3]) : 1;
+    const int senderCpu = argc > 4 ? std::atoi(argv[4]) : 2;
+
+    std::printf("messages %zu, one every %lld us, reader cpu %d, sender cpu %d\n\n", messages,
+                static_cast<long long>(interval.count()), readerCpu, senderCpu);
+    // a spinning reader needs a core of its own, with fewer it only competes with the sender
+    if (std::thread::hardware_concurrency() < 3)
+        std::printf("note: %u CPU(s), the busy-polling reader shares a core and \"on\" will look "
+                    "worse than \"off\"\n\n",
+                    std::thread::hardware_concurrency());
+    std::printf("mode %9s %8s %8s %8s %8s %8s %9s   (microseconds)\n", "samples", "p50", "p90",
+                "p99", "p99.9", "p99.99", "max");
+
+    configureRuntime(RuntimeConfig{});
+    run("off", messages, interval);
+
+    RuntimeConfig on;
+    on.lowLatency = true;
+    on.readerCpus = {readerCpu};
+    on.workerCpus = {senderCpu};
+    on.busyPoll = true;
+    on.fifoPriority = 10;
+    on.lockMemory = true;
+    configureRuntime(on);
+    prepareRuntimeMemory();
+    run("on", messages, interval);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "conflation.h"
+
+#include <algorithm>
+
+void QuoteConflator::configure(ConflationConfig next) { config = next; }
+
+void QuoteConflator::Stage::park(MarketEvent &&ev) {
+    const double spread = ev.quote.spread();
+    auto [it, inserted] = pending.try_emplace(ev.symbol);
+    Pending &p = it->second;
+
+    if (inserted) {
+        p.lastNs = ev.ts_ns;
+        owner.pendingSymbols.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // the previous quote's spread was on the book until this one arrived
+        const std::int64_t heldNs = std::max<std::int64_t>(0, ev.ts_ns - p.lastNs);
+        if (p.lastSpread > 0.0) {
+            p.weightedSpread += p.lastSpread * static_cast<double>(heldNs);
+            p.weightedNs += heldNs;
+        }
+        p.lastNs = std::max(p.lastNs, ev.ts_ns);
+        owner.quotesConflated.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (spread > 0.0) {
+        p.spreadSum += spread;
+        ++p.spreadCount;
+    }
+    p.lastSpread = spread;
+    p.latest = std::move(ev);
+    ++p.merged;
+}
+
+void QuoteConflator::Stage::flush(std::vector<MarketEvent> &events) {
+    for (auto &[symbol, p] : pending) {
+        if (p.merged > 1) {
+            p.latest.spreadSample = p.weightedNs > 0
+                                        ? p.weightedSpread / static_cast<double>(p.weightedNs)
+                                    : p.spreadCount > 0 ? p.spreadSum / p.spreadCount
+                                                        : 0.0;
+        }
+        events.push_back(std::move(p.latest));
+    }
+    owner.pendingSymbols.fetch_sub(pending.size(), std::memory_order_relaxed);
+    pending.clear();
+    owner.flushes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void QuoteConflator::Stage::process(std::vector<MarketEvent> &events, std::size_t backlogBytes,
+                                    bool force) {
+    // parked quotes still go out after conflation was forced and the lag is gone
+    if (!owner.config.enabled && !force && pending.empty())
+        return;
+
+    const bool behind =
+        force || (owner.config.enabled && backlogBytes >= owner.config.minBacklogBytes);
+    if (!behind && pending.empty())
+        return;
+
+    const auto now = Clock::now();
+    if (pending.empty())
+        holdingSince = now;
+
+    // quotes move into the parking map, trades and bars stay in order
+    std::size_t kept = 0;
+    for (auto &ev : events) {
+        if (ev.type == MarketEventType::Quote) {
+            owner.quotesIn.fetch_add(1, std::memory_order_relaxed);
+            park(std::move(ev));
+        } else {
+            if (&events[kept] != &ev)
+                events[kept] = std::move(ev);
+            ++kept;
+        }
+    }
+    events.resize(kept);
+
+    if (!behind || now - holdingSince >= owner.config.maxHold)
+        flush(events);
+}
+
+ConflationStats QuoteConflator::stats() const {
+    ConflationStats out;
+    out.enabled = config.enabled;
+    out.quotesIn = quotesIn.load(std::memory_order_relaxed);
+    out.quotesConflated = quotesConflated.load(std::memory_order_relaxed);
+    out.flushes = flushes.load(std::memory_order_relaxed);
+    out.pendingSymbols = pendingSymbols.load(std::memory_order_relaxed);
+    return out;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "data_parser.h"
+
+/*
+
+Quote conflation under burst load (opt-in, SAR_QUOTE_CONFLATION=1).
+
+At the open a few hundred symbols can send thousands of quotes a second and the reader falls
+behind, so detectors end up scoring quotes that are already stale. While the socket still has
+at least minBacklogBytes waiting, quotes are parked per symbol and only the newest one is kept.
+Parked quotes go back into the batch once the backlog drains or the oldest has waited maxHold.
+
+Trades and bars are never touched, they carry volume that must not be lost.
+
+The surviving quote carries the time-weighted spread of everything it replaced in
+MarketEvent::spreadSample, so the spread window still sees what the book looked like rather than
+whichever quote happened to be last.
+
+Each feed connection runs its own Stage; the counters are shared atomics read by the API.
+
+*/
+
+struct ConflationConfig {
+    bool enabled = false;
+    std::chrono::microseconds maxHold{1000};
+    std::size_t minBacklogBytes = 16 * 1024; // roughly one TLS record
+};
+
+struct ConflationStats {
+    bool enabled = false;
+    std::uint64_t quotesIn = 0;        // quotes seen while the stage was active
+    std::uint64_t quotesConflated = 0; // replaced by a newer quote before reaching detection
+    std::uint64_t flushes = 0;
+    std::uint64_t pendingSymbols = 0;
+};
+
+class QuoteConflator {
+  public:
+    void configure(ConflationConfig config);
+    bool enabled() const { return config.enabled; }
+
+    ConflationStats stats() const;
+
+    // parking area for one reader thread, every feed connection owns its own
+    class Stage {
+      public:
+        explicit Stage(QuoteConflator &owner) : owner(owner) {}
+
+        // backlogBytes is what is still waiting to be read from the socket; force conflates
+        // as if behind even when conflation is off, for feed lag shedding
+        void process(std::vector<MarketEvent> &events, std::size_t backlogBytes,
+                     bool force = false);
+
+      private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Pending {
+            MarketEvent latest;
+            std::uint32_t merged = 0;
+            std::int64_t lastNs = 0;
+            double lastSpread = 0.0;
+            double weightedSpread = 0.0; // sum of spread x time it was on the book
+            std::int64_t weightedNs = 0;
+            double spreadSum = 0.0; // plain mean when every quote shares a timestamp
+            std::uint32_t spreadCount = 0;
+        };
+
+        void park(MarketEvent &&ev);
+        void flush(std::vector<MarketEvent> &events);
+
+        QuoteConflator &owner;
+        std::unordered_map<SymbolId, Pending> pending;
+        Clock::time_point holdingSince;
+    };
+
+  private:
+    ConflationConfig config;
+
+    std::atomic<std::uint64_t> quotesIn{0};
+    std::atomic<std::uint64_t> quotesConflated{0};
+    std::atomic<std::uint64_t> flushes{0};
+    std::atomic<std::uint64_t> pendingSymbols{0}; // summed over every stage
+};
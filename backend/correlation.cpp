@@ -0,0 +1,449 @@
+#include "correlation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "data_parser.h"
+
+namespace {
+
+// 4 float lanes, the SSE2 / NEON baseline every 64-bit target has
+typedef float v4f __attribute__((vector_size(16)));
+constexpr std::size_t LANES = 4;
+
+// columns updated per pass, 512 floats keeps the return slice hot in L1 while rows stream past
+constexpr std::size_t COLUMN_BLOCK = 512;
+
+constexpr std::uint64_t WARMUP_BUCKETS = 30;
+constexpr std::size_t MIN_ACTIVE_SYMBOLS = 5;
+constexpr std::uint64_t SYSTEMIC_LOOKBACK_BUCKETS = 3;
+
+constexpr double PEER_CORRELATION = 0.6; // how correlated a symbol has to be to count as a peer
+constexpr std::size_t MIN_PEERS = 3;
+constexpr double PEER_COMOVE_SHARE = 0.6; // share of peers that must move the same way
+constexpr double PEER_MOVE_Z = 1.0;
+constexpr std::size_t MAX_SECTOR_CHECKS = 16; // bounds the O(n) peer scans per bucket
+
+constexpr double EPS = 1e-12;
+
+std::size_t round_up(std::size_t n, std::size_t multiple) {
+    return (n + multiple - 1) / multiple * multiple;
+}
+
+v4f load(const float *p) {
+    v4f v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void store(float *p, v4f v) { std::memcpy(p, &v, sizeof(v)); }
+
+} // namespace
+
+void CorrelationEngine::AlignedFree::operator()(float *p) const { std::free(p); }
+
+CorrelationEngine::CorrelationEngine(std::size_t maxSymbols, std::int64_t gridNs,
+                                     double halfLifeBuckets, double k)
+    : maxSymbols(maxSymbols), stride(round_up(std::max<std::size_t>(maxSymbols, 1), 16)),
+      gridNs(gridNs), lambda(static_cast<float>(std::pow(0.5, 1.0 / halfLifeBuckets))), k(k),
+      emitK(k) {
+    lastPrice.assign(maxSymbols, 0.0);
+    bucketOpen.assign(maxSymbols, 0.0);
+    prevBucketOpen.assign(maxSymbols, 0.0);
+    touched.assign(maxSymbols, 0);
+    returns.assign(stride, 0.0f);
+
+    // 64-byte aligned rows so every lane group starts on an aligned address
+    const std::size_t bytes = maxSymbols * stride * sizeof(float);
+    void *mem = std::aligned_alloc(64, std::max<std::size_t>(bytes, 64));
+    if (!mem)
+        throw std::bad_alloc();
+    cov.reset(static_cast<float *>(mem));
+    std::memset(cov.get(), 0, bytes);
+}
+
+CorrelationEngine::~CorrelationEngine() = default;
+
+std::optional<std::size_t> CorrelationEngine::slotOf(const std::string &symbol) const {
+    auto it = slots.find(symbol);
+    if (it == slots.end())
+        return std::nullopt;
+    return it->second;
+}
+
+void CorrelationEngine::observe(const std::string &symbol, std::int64_t tsNs, double price) {
+    if (tsNs <= 0 || price <= 0.0)
+        return;
+
+    if (bucketStart == 0)
+        bucketStart = tsNs - tsNs % gridNs;
+
+    // one close per gap, a quiet stretch shows up as a single longer bucket
+    if (tsNs >= bucketStart + gridNs) {
+        closeBucket();
+        bucketStart = tsNs - tsNs % gridNs;
+    }
+
+    auto it = slots.find(symbol);
+    if (it == slots.end()) {
+        if (names.size() >= maxSymbols)
+            return;
+        it = slots.emplace(symbol, names.size()).first;
+        names.push_back(symbol);
+        bucketOpen[it->second] = price;
+        prevBucketOpen[it->second] = price;
+    }
+
+    const std::size_t i = it->second;
+    lastPrice[i] = price;
+    touched[i] = 1;
+}
+
+void CorrelationEngine::remove(const std::string &symbol) {
+    auto it = slots.find(symbol);
+    if (it == slots.end())
+        return;
+
+    const std::size_t hole = it->second;
+    const std::size_t last = names.size() - 1;
+    slots.erase(it);
+
+    float *c = cov.get();
+    auto at = [&](std::size_t a, std::size_t b) -> float & {
+        return a <= b ? c[a * stride + b] : c[b * stride + a];
+    };
+
+    if (hole != last) {
+        // O(n) copy of the moved symbol's row and column
+        for (std::size_t j = 0; j < last; ++j) {
+            if (j != hole)
+                at(hole, j) = at(last, j);
+        }
+        at(hole, hole) = at(last, last);
+
+        names[hole] = std::move(names[last]);
+        slots[names[hole]] = hole;
+        lastPrice[hole] = lastPrice[last];
+        bucketOpen[hole] = bucketOpen[last];
+        prevBucketOpen[hole] = prevBucketOpen[last];
+        touched[hole] = touched[last];
+        returns[hole] = returns[last];
+    }
+
+    // the freed row and column must read as zero when the slot is reused
+    for (std::size_t j = 0; j <= last; ++j)
+        at(last, j) = 0.0f;
+    names.pop_back();
+    lastPrice[last] = 0.0;
+    bucketOpen[last] = 0.0;
+    prevBucketOpen[last] = 0.0;
+    touched[last] = 0;
+    returns[last] = 0.0f;
+}
+
+std::vector<Anomaly> CorrelationEngine::takeAnomalies() {
+    std::vector<Anomaly> out;
+    out.swap(pending);
+    return out;
+}
+
+void CorrelationEngine::closeBucket() {
+    const std::size_t n = names.size();
+    std::size_t active = 0;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        float r = 0.0f;
+        if (bucketOpen[i] > 0.0 && lastPrice[i] > 0.0)
+            r = static_cast<float>(std::log(lastPrice[i] / bucketOpen[i]));
+        returns[i] = r;
+        active += touched[i];
+    }
+
+    detectMarketMove(active);
+    if (closedBuckets >= WARMUP_BUCKETS)
+        detectSectorMoves();
+
+    // variances used above are from before this bucket, so the move doesn't dampen itself
+    updateMatrix();
+
+    for (std::size_t i = 0; i < n; ++i) {
+        prevBucketOpen[i] = bucketOpen[i];
+        bucketOpen[i] = lastPrice[i];
+        touched[i] = 0;
+    }
+    ++closedBuckets;
+}
+
+void CorrelationEngine::updateMatrix() {
+    const std::size_t n = names.size();
+    if (n == 0)
+        return;
+
+    const std::size_t padded = round_up(n, LANES);
+    const float alpha = 1.0f - lambda;
+    const v4f lambdaV = v4f{} + lambda;
+    float *c = cov.get();
+    const float *r = returns.data();
+
+    for (std::size_t jb = 0; jb < padded; jb += COLUMN_BLOCK) {
+        const std::size_t jEnd = std::min(jb + COLUMN_BLOCK, padded);
+
+        // only rows whose upper triangle reaches into this column block; columns run to the
+        // padded width but rows stop at n, the buffer only has maxSymbols of them
+        const std::size_t iEnd = std::min(jEnd, n);
+        for (std::size_t i = 0; i < iEnd; ++i) {
+            const std::size_t jStart = std::max(jb, i / LANES * LANES);
+            const v4f ri = v4f{} + alpha * r[i];
+            float *row = c + i * stride;
+
+            for (std::size_t j = jStart; j < jEnd; j += LANES)
+                store(row + j, load(row + j) * lambdaV + ri * load(r + j));
+        }
+    }
+}
+
+double CorrelationEngine::correlationAt(std::size_t i, std::size_t j) const {
+    if (i > j)
+        std::swap(i, j);
+    const float *c = cov.get();
+    const double vi = c[i * stride + i];
+    const double vj = c[j * stride + j];
+    if (vi <= EPS || vj <= EPS)
+        return 0.0;
+    return c[i * stride + j] / std::sqrt(vi * vj);
+}
+
+std::optional<double> CorrelationEngine::correlation(const std::string &a,
+                                                     const std::string &b) const {
+    const auto i = slotOf(a);
+    const auto j = slotOf(b);
+    if (!i || !j || closedBuckets < WARMUP_BUCKETS)
+        return std::nullopt;
+    return correlationAt(*i, *j);
+}
+
+void CorrelationEngine::detectMarketMove(std::size_t active) {
+    const std::size_t n = names.size();
+    lastMarketZ = 0.0;
+    if (active < MIN_ACTIVE_SYMBOLS)
+        return;
+
+    double sum = 0.0;
+    std::size_t up = 0;
+    std::size_t down = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!touched[i])
+            continue;
+        sum += returns[i];
+        up += returns[i] > 0.0f;
+        down += returns[i] < 0.0f;
+    }
+    const double market = sum / static_cast<double>(active);
+
+    const double prevVariance = marketVariance;
+    marketVariance = lambda * marketVariance + (1.0 - lambda) * market * market;
+
+    if (prevVariance <= EPS)
+        return;
+
+    const double stdev = std::sqrt(prevVariance);
+    const double zscore = market / stdev;
+    lastMarketZ = zscore;
+
+    // keep learning the variance during warmup, just don't report yet
+    if (closedBuckets < WARMUP_BUCKETS || std::abs(zscore) <= emitK)
+        return;
+
+    const bool isUp = zscore > 0.0;
+    const double breadth =
+        static_cast<double>(isUp ? up : down) / static_cast<double>(active) * 100.0;
+
+    Anomaly newAnomaly;
+    newAnomaly.points = static_cast<std::size_t>(closedBuckets);
+    newAnomaly.type = AnomalyType::Market;
+    newAnomaly.source = SourceType::Trade;
+    newAnomaly.direction = isUp ? Direction::Up : Direction::Down;
+    newAnomaly.scope = MoveScope::Systemic;
+
+    newAnomaly.symbol = "MARKET";
+    newAnomaly.ts_ns = bucketStart + gridNs;
+    newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+    newAnomaly.value = market;
+    newAnomaly.mean = 0.0;
+    newAnomaly.stdev = stdev;
+    newAnomaly.zscore = zscore;
+
+    newAnomaly.lower = -(emitK * stdev);
+    newAnomaly.upper = emitK * stdev;
+    newAnomaly.k = emitK;
+
+    newAnomaly.note =
+        std::string(isUp ? "Market-wide rally: " : "Market-wide drop: ") +
+        "the average tracked symbol moved " + std::to_string(market * 100.0) +
+        "% in one interval (" + std::to_string(std::abs(zscore)) +
+        " standard deviations), with " + std::to_string(breadth) + "% of " +
+        std::to_string(active) +
+        " active symbols moving the same way. "
+        "This suggests a systemic move driven by macro news, index flows or risk sentiment "
+        "rather than anything specific to one company.";
+
+    pending.push_back(std::move(newAnomaly));
+    // only a move past k makes later per-symbol anomalies systemic
+    if (std::abs(zscore) > k) {
+        lastMarketAnomalyBucket = closedBuckets;
+        marketAnomalySeen = true;
+    }
+}
+
+void CorrelationEngine::detectSectorMoves() {
+    // the market anomaly already covers a broad move
+    if (std::abs(lastMarketZ) > k)
+        return;
+
+    const std::size_t n = names.size();
+    const float *c = cov.get();
+
+    auto zOf = [&](std::size_t i) {
+        const double v = c[i * stride + i];
+        return v > EPS ? returns[i] / std::sqrt(v) : 0.0;
+    };
+
+    std::vector<std::uint8_t> covered(n, 0);
+    std::size_t checks = 0;
+
+    for (std::size_t i = 0; i < n && checks < MAX_SECTOR_CHECKS; ++i) {
+        const double zi = zOf(i);
+        if (covered[i] || !touched[i] || std::abs(zi) <= emitK)
+            continue;
+        ++checks;
+
+        std::vector<std::size_t> peers;
+        std::size_t comoving = 0;
+        double groupSum = returns[i];
+        for (std::size_t j = 0; j < n; ++j) {
+            if (j == i || correlationAt(i, j) < PEER_CORRELATION)
+                continue;
+            peers.push_back(j);
+            const double zj = zOf(j);
+            if (zj * zi > 0.0 && std::abs(zj) >= PEER_MOVE_Z) {
+                ++comoving;
+                groupSum += returns[j];
+            }
+        }
+
+        if (peers.size() < MIN_PEERS ||
+            static_cast<double>(comoving) < PEER_COMOVE_SHARE * static_cast<double>(peers.size()))
+            continue;
+
+        covered[i] = 1;
+        std::string peerList;
+        std::size_t listed = 0;
+        for (std::size_t j : peers) {
+            covered[j] = 1;
+            if (listed < 5) {
+                peerList += (listed ? ", " : "") + names[j];
+                ++listed;
+            }
+        }
+
+        const double stdev = std::sqrt(static_cast<double>(c[i * stride + i]));
+        const double groupReturn = groupSum / static_cast<double>(comoving + 1);
+
+        Anomaly newAnomaly;
+        newAnomaly.points = static_cast<std::size_t>(closedBuckets);
+        newAnomaly.type = AnomalyType::Sector;
+        newAnomaly.source = SourceType::Trade;
+        newAnomaly.direction = zi > 0.0 ? Direction::Up : Direction::Down;
+        newAnomaly.scope = MoveScope::Sector;
+
+        newAnomaly.symbol = names[i];
+        newAnomaly.ts_ns = bucketStart + gridNs;
+        newAnomaly.timestamp = formatTimestampNs(newAnomaly.ts_ns);
+
+        newAnomaly.value = returns[i];
+        newAnomaly.mean = 0.0;
+        newAnomaly.stdev = stdev;
+        newAnomaly.zscore = zi;
+
+        newAnomaly.lower = -(emitK * stdev);
+        newAnomaly.upper = emitK * stdev;
+        newAnomaly.k = emitK;
+
+        newAnomaly.note =
+            "Sector move: " + names[i] + " moved " + std::to_string(returns[i] * 100.0) +
+            "% together with " + std::to_string(comoving) + " of its " +
+            std::to_string(peers.size()) + " most correlated peers (" + peerList +
+            "), an average of " + std::to_string(groupReturn * 100.0) +
+            "% across the group. "
+            "This suggests news or flows hitting a whole industry or theme rather than a "
+            "single company.";
+
+        pending.push_back(std::move(newAnomaly));
+    }
+}
+
+// returns over the last closed bucket plus the current partial one
+std::size_t CorrelationEngine::recentReturns(std::vector<float> &out) const {
+    const std::size_t n = names.size();
+    out.assign(n, 0.0f);
+    std::size_t active = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (prevBucketOpen[i] > 0.0 && lastPrice[i] > 0.0) {
+            out[i] = static_cast<float>(std::log(lastPrice[i] / prevBucketOpen[i]));
+            ++active;
+        }
+    }
+    return active;
+}
+
+MoveScope CorrelationEngine::classify(const Anomaly &anomaly) const {
+    if (anomaly.type == AnomalyType::Market)
+        return MoveScope::Systemic;
+    if (anomaly.type == AnomalyType::Sector)
+        return MoveScope::Sector;
+
+    const auto slot = slotOf(anomaly.symbol);
+    if (!slot || closedBuckets < WARMUP_BUCKETS)
+        return MoveScope::Unclassified;
+
+    const std::size_t i = *slot;
+    std::vector<float> &recent = scratch;
+    const std::size_t active = recentReturns(recent);
+    const double own = recent[i];
+
+    // recent market move, either flagged in the last few buckets or building right now
+    if (marketAnomalySeen && closedBuckets - lastMarketAnomalyBucket <= SYSTEMIC_LOOKBACK_BUCKETS)
+        return MoveScope::Systemic;
+    if (active >= MIN_ACTIVE_SYMBOLS && marketVariance > EPS) {
+        double sum = 0.0;
+        for (float r : recent)
+            sum += r;
+        const double market = sum / static_cast<double>(active);
+        // two buckets worth of variance
+        const double marketZ = market / std::sqrt(2.0 * marketVariance);
+        if (std::abs(marketZ) > k && market * own >= 0.0)
+            return MoveScope::Systemic;
+    }
+
+    const float *c = cov.get();
+    std::size_t peers = 0;
+    std::size_t comoving = 0;
+    for (std::size_t j = 0; j < names.size(); ++j) {
+        if (j == i || correlationAt(i, j) < PEER_CORRELATION)
+            continue;
+        ++peers;
+        const double v = c[j * stride + j];
+        const double zj = v > EPS ? recent[j] / std::sqrt(2.0 * v) : 0.0;
+        if (zj * own > 0.0 && std::abs(zj) >= PEER_MOVE_Z)
+            ++comoving;
+    }
+    if (peers >= MIN_PEERS &&
+        static_cast<double>(comoving) >= PEER_COMOVE_SHARE * static_cast<double>(peers))
+        return MoveScope::Sector;
+
+    return MoveScope::Idiosyncratic;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "anomaly_detector.h"
+
+/*
+
+Cross-symbol view of the market.
+
+Every tracked symbol gets a slot. Prices land in the current time bucket (1s by default) and
+when the grid moves on, each symbol's log return over the bucket is written into a shared
+return vector. That vector drives:
+
+- an EWMA covariance matrix, C = lambda * C + (1 - lambda) * r * r^T, updated in cache-sized
+  column blocks with SIMD lanes. cost per bucket is n^2 / 2 multiply-adds no matter how many
+  messages arrived, so 2,000 symbols is ~2M flops once a second.
+- a market factor (equal-weight mean return) with its own EWMA variance. a big factor move is a
+  market-wide anomaly.
+- sector moves: a symbol that jumps together with most of its highly correlated peers.
+
+Per-symbol anomalies get tagged as idiosyncratic, sector or systemic so one market drop doesn't
+look like 500 unrelated price alerts.
+
+*/
+
+class CorrelationEngine {
+  public:
+    explicit CorrelationEngine(std::size_t maxSymbols = 2048,
+                               std::int64_t gridNs = 1'000'000'000LL,
+                               double halfLifeBuckets = 300.0, double k = 2.0);
+    ~CorrelationEngine();
+
+    CorrelationEngine(const CorrelationEngine &) = delete;
+    CorrelationEngine &operator=(const CorrelationEngine &) = delete;
+
+    // latest price for a symbol at event time tsNs, closes grid buckets as time moves on
+    void observe(const std::string &symbol, std::int64_t tsNs, double price);
+
+    // market and sector anomalies produced since the last call, oldest first
+    std::vector<Anomaly> takeAnomalies();
+
+    // z a market or sector move has to clear to be reported, set to the loosest detection
+    // profile so each profile can filter at its own k; the systemic tagging keeps k
+    void setEmitThreshold(double next) { emitK = next; }
+
+    // idiosyncratic / sector / systemic tag for a per-symbol anomaly
+    MoveScope classify(const Anomaly &anomaly) const;
+
+    std::optional<double> correlation(const std::string &a, const std::string &b) const;
+
+    // frees a symbol's slot, the last slot moves into the hole so rows stay dense
+    void remove(const std::string &symbol);
+
+    std::size_t symbolCount() const { return names.size(); }
+    std::size_t capacity() const { return maxSymbols; }
+    std::uint64_t bucketsClosed() const { return closedBuckets; }
+
+  private:
+    std::optional<std::size_t> slotOf(const std::string &symbol) const;
+    std::size_t recentReturns(std::vector<float> &out) const;
+
+    void closeBucket();
+    void detectMarketMove(std::size_t active);
+    void detectSectorMoves();
+    void updateMatrix();
+
+    double correlationAt(std::size_t i, std::size_t j) const;
+
+    std::size_t maxSymbols;
+    std::size_t stride; // row length of the matrix, padded to the SIMD width
+    std::int64_t gridNs;
+    float lambda;
+    double k;
+    double emitK;
+
+    std::unordered_map<std::string, std::size_t> slots;
+    std::vector<std::string> names;
+
+    // structure of arrays, indexed by slot
+    std::vector<double> lastPrice;
+    std::vector<double> bucketOpen;     // price when the current bucket started
+    std::vector<double> prevBucketOpen; // price when the last closed bucket started
+    std::vector<std::uint8_t> touched;  // updated during the current bucket
+    std::vector<float> returns;         // last closed bucket, padded to stride
+
+    struct AlignedFree {
+        void operator()(float *p) const;
+    };
+    std::unique_ptr<float[], AlignedFree> cov; // maxSymbols x stride, upper triangle is live
+
+    std::int64_t bucketStart = 0;
+    std::uint64_t closedBuckets = 0;
+
+    double marketVariance = 0.0;
+    double lastMarketZ = 0.0;
+    std::uint64_t lastMarketAnomalyBucket = 0;
+    bool marketAnomalySeen = false;
+
+    std::vector<Anomaly> pending;
+    mutable std::vector<float> scratch; // reused by classify so tagging doesn't allocate
+};
@@ -1,4 +1,8 @@
 #include "data_parser.h"
+#include "seasonality.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
 #include <iostream>
 
 // keep only last N points so memory stays bounded
@@ -13,59 +17,307 @@ static void push_bounded(std::deque<std::int64_t> &dq, std::int64_t x, std::size
         dq.pop_front();
 }
 
+// short horizon for realized volatility, the long horizon reuses windowN
+static constexpr std::size_t VOLATILITY_SHORT_WINDOW = 20;
+static constexpr std::size_t TRADE_FLOW_WINDOW = 50;
+
+// the session VWAP a print at tsNs belongs in, starting over at the first print of a later
+// session; nullptr outside regular hours and for a late print from an earlier session
+static SessionVwap *session_vwap(SymbolState &state, std::int64_t tsNs) {
+    if (state.vwap.session.contains(tsNs))
+        return &state.vwap;
+    if (tsNs < state.vwap.session.startNs)
+        return nullptr;
+    const SessionSpan span = sessionSpan(tsNs);
+    if (!span.contains(tsNs))
+        return nullptr;
+    state.vwap = SessionVwap{span};
+    return &state.vwap;
+}
+
+static TimeWindowConfig timeWindows;
+
+void configureTimeWindows(const TimeWindowConfig &config) { timeWindows = config; }
+
+const TimeWindowConfig &timeWindowConfig() { return timeWindows; }
+
 // updates the map using parsed events
 void updateState(std::unordered_map<std::string, SymbolState> &bySymbol,
                  const std::vector<MarketEvent> &events, std::size_t windowN) {
+    const bool timed = timeWindows.horizonNs > 0;
+    const std::int64_t horizon = timeWindows.horizonNs;
+    const std::size_t cap = timeWindows.maxPoints;
+
     for (const auto &ev : events) {
-        auto &state = bySymbol[ev.symbol];
+        // symbols are at most 15 chars, so this key never touches the heap
+        auto &state = bySymbol[std::string(ev.symbolName())];
+        state.lastEventNs = std::max(state.lastEventNs, ev.ts_ns);
 
         if (ev.type == MarketEventType::Quote) {
-            const Quote &q = std::get<Quote>(ev.data);
+            const Quote &q = ev.quote;
             state.lastQuote = q;
-            state.lastQuoteTs = ev.timestamp;
+            state.lastQuoteNs = ev.ts_ns;
 
             double mid = q.mid_price();
-            double spr = q.spread();
-            if (mid > 0.0)
+            double spr = ev.spreadSample > 0.0 ? ev.spreadSample : q.spread();
+            if (mid > 0.0) {
                 push_bounded(state.prices, mid, windowN);
-            if (spr > 0.0)
+                if (timed)
+                    state.timedPrices.push(ev.ts_ns, mid, horizon, cap);
+            }
+            if (spr > 0.0) {
                 push_bounded(state.spreads, spr, windowN);
+                if (timed)
+                    state.timedSpreads.push(ev.ts_ns, spr, horizon, cap);
+                state.spreadQuantiles.add(spr);
+                state.series.addQuote(ev.ts_ns, spr);
+            }
+            if (q.bid_size > 0 && q.ask_size > 0) {
+                const double depth = static_cast<double>(q.bid_size + q.ask_size);
+                state.quoteDepths.push(depth, windowN);
+                if (timed)
+                    state.timedDepths.push(ev.ts_ns, depth, horizon, cap);
+            }
         } else if (ev.type == MarketEventType::Trade) {
-            const Trade &tr = std::get<Trade>(ev.data);
+            const Trade &tr = ev.trade;
             state.lastTrade = tr;
-            state.lastTradeTs = ev.timestamp;
+            state.lastTradeNs = ev.ts_ns;
 
-            if (tr.price > 0.0)
+            if (tr.price > 0.0) {
                 push_bounded(state.prices, tr.price, windowN);
-            if (tr.size > 0)
+                if (timed)
+                    state.timedPrices.push(ev.ts_ns, tr.price, horizon, cap);
+                state.tradeVolatility.push(tr.price, VOLATILITY_SHORT_WINDOW, windowN);
+            }
+            // signed against the quote standing before this trade, then the trade becomes the
+            // reference for the next tick test
+            state.tradeFlow.push(tr.price, tr.size, state.lastQuote, TRADE_FLOW_WINDOW, windowN);
+            if (auto *vwap = session_vwap(state, ev.ts_ns))
+                vwap->addTrade(tr.price, tr.size);
+            if (tr.size > 0) {
                 push_bounded(state.tradeSizes, tr.size, windowN);
+                state.tradeSizeQuantiles.add(static_cast<double>(tr.size));
+            }
+            if (tr.price > 0.0)
+                state.series.addTrade(ev.ts_ns, tr.price, tr.size);
 
         } else if (ev.type == MarketEventType::Bar) {
-            const Bar &b = std::get<Bar>(ev.data);
+            const Bar &b = ev.bar;
+            // an updated bar for the same minute replaces lastBar but is not counted into the
+            // bar windows a second time; they keep the minute's first version
+            const bool newBar = ev.ts_ns != state.lastBarNs;
+
+            // gap needs the previous close, so look before lastBar is replaced; on an update
+            // lastBar is this minute, not the one before
+            if (newBar) {
+                state.lastGap = std::nullopt;
+                if (state.lastBar.has_value() && state.lastBar->close > 0.0 && b.open > 0.0) {
+                    state.lastGap = b.open - state.lastBar->close;
+                    state.barGaps.push(*state.lastGap, windowN);
+                }
+                if (b.high > 0.0 && b.low > 0.0 && b.high >= b.low)
+                    state.barRanges.push(b.range(), windowN);
+            }
+
+            // score against the profile before this bar is learned into it
+            const int minute = sessionMinute(ev.ts_ns);
+            if (minute >= 0) {
+                if (!state.volumeProfile)
+                    state.volumeProfile = volumeProfileFor(ev.symbolName());
+                state.lastBarExpected = state.volumeProfile->expected(minute);
+                if (newBar && b.volume > 0)
+                    state.volumeProfile->observe(minute, static_cast<double>(b.volume));
+            } else {
+                state.lastBarExpected = SeasonalExpectation{};
+            }
+
+            if (auto *vwap = session_vwap(state, ev.ts_ns))
+                vwap->addBar(b, !newBar);
+
             state.lastBar = b;
-            state.lastBarTs = ev.timestamp;
+            state.lastBarNs = ev.ts_ns;
 
-            if (b.close > 0.0)
+            if (b.close > 0.0) {
                 push_bounded(state.prices, b.close, windowN);
-            if (b.volume > 0)
+                if (timed)
+                    state.timedPrices.push(ev.ts_ns, b.close, horizon, cap);
+                if (newBar)
+                    state.barVolatility.push(b.close, VOLATILITY_SHORT_WINDOW, windowN);
+            }
+            if (newBar && b.volume > 0)
                 push_bounded(state.barVolumes, b.volume, windowN);
         }
     }
 }
 
-std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
+// days since 1970-01-01 for a proleptic gregorian date (Howard Hinnant's days_from_civil)
+std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
 
-    std::vector<MarketEvent> results;
+std::int64_t parseTimestampNs(std::string_view ts) {
+    // fixed part: YYYY-MM-DDTHH:MM:SS
+    if (ts.size() < 19 || ts[4] != '-' || ts[7] != '-' || (ts[10] != 'T' && ts[10] != ' ') ||
+        ts[13] != ':' || ts[16] != ':')
+        return 0;
+
+    auto digits = [&](std::size_t pos, std::size_t len, int &out) {
+        out = 0;
+        for (std::size_t i = pos; i < pos + len; ++i) {
+            if (ts[i] < '0' || ts[i] > '9')
+                return false;
+            out = out * 10 + (ts[i] - '0');
+        }
+        return true;
+    };
+
+    int year, month, day, hour, minute, second;
+    if (!digits(0, 4, year) || !digits(5, 2, month) || !digits(8, 2, day) ||
+        !digits(11, 2, hour) || !digits(14, 2, minute) || !digits(17, 2, second))
+        return 0;
+    if (month < 1 || month > 12 || day < 1 || day > 31)
+        return 0;
+
+    std::size_t pos = 19;
+    std::int64_t fracNs = 0;
+    if (pos < ts.size() && ts[pos] == '.') {
+        ++pos;
+        int scale = 0;
+        while (pos < ts.size() && ts[pos] >= '0' && ts[pos] <= '9') {
+            if (scale < 9) {
+                fracNs = fracNs * 10 + (ts[pos] - '0');
+                ++scale;
+            }
+            ++pos;
+        }
+        for (; scale < 9; ++scale)
+            fracNs *= 10;
+    }
 
+    std::int64_t offsetSec = 0;
+    if (pos < ts.size() && (ts[pos] == '+' || ts[pos] == '-')) {
+        int oh, om;
+        if (ts.size() < pos + 6 || ts[pos + 3] != ':' || !digits(pos + 1, 2, oh) ||
+            !digits(pos + 4, 2, om))
+            return 0;
+        offsetSec = (oh * 3600 + om * 60) * (ts[pos] == '+' ? 1 : -1);
+    }
+
+    const std::int64_t days = daysFromCivil(year, static_cast<unsigned>(month),
+                                              static_cast<unsigned>(day));
+    const std::int64_t secs = days * 86400 + hour * 3600 + minute * 60 + second - offsetSec;
+    return secs * 1'000'000'000LL + fracNs;
+}
+
+// inverse of daysFromCivil
+void civilFromDays(std::int64_t z, int &y, unsigned &m, unsigned &d) {
+    z += 719468;
+    const std::int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int>(static_cast<std::int64_t>(yoe) + era * 400 + (m <= 2));
+}
+
+std::string formatTimestampNs(std::int64_t tsNs) {
+    std::int64_t secs = tsNs / 1'000'000'000LL;
+    std::int64_t fracNs = tsNs % 1'000'000'000LL;
+    if (fracNs < 0) {
+        fracNs += 1'000'000'000LL;
+        --secs;
+    }
+    std::int64_t days = secs / 86400;
+    std::int64_t sod = secs % 86400;
+    if (sod < 0) {
+        sod += 86400;
+        --days;
+    }
+
+    int y;
+    unsigned m, d;
+    civilFromDays(days, y, m, d);
+
+    char buf[64]; // room for any field value, not just a valid date
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02uT%02d:%02d:%02d.%09lldZ", y, m, d,
+                  static_cast<int>(sod / 3600), static_cast<int>(sod / 60 % 60),
+                  static_cast<int>(sod % 60), static_cast<long long>(fracNs));
+    return buf;
+}
+
+std::uint64_t conditionBit(std::string_view code) {
+    // one-character codes map straight to their slot, anything else is unknown
+    static constexpr auto table = [] {
+        std::array<std::uint8_t, 128> slots{};
+        slots.fill(0xff);
+        for (std::size_t i = 0; i < std::size(CONDITION_CODES); ++i)
+            slots[static_cast<unsigned char>(CONDITION_CODES[i][0])] = static_cast<std::uint8_t>(i);
+        return slots;
+    }();
+
+    if (code.size() != 1 || static_cast<unsigned char>(code[0]) >= table.size())
+        return UNKNOWN_CONDITION;
+    const std::uint8_t slot = table[static_cast<unsigned char>(code[0])];
+    return slot == 0xff ? UNKNOWN_CONDITION : std::uint64_t{1} << slot;
+}
+
+std::vector<std::string_view> conditionCodes(std::uint64_t mask) {
+    std::vector<std::string_view> out;
+    for (std::size_t i = 0; i < std::size(CONDITION_CODES); ++i) {
+        if (mask & (std::uint64_t{1} << i))
+            out.push_back(CONDITION_CODES[i]);
+    }
+    if (mask & UNKNOWN_CONDITION)
+        out.push_back("?");
+    return out;
+}
+
+// first character of a string field, 0 when it is missing
+static char code_field(const json &msg, const char *key) {
+    auto it = msg.find(key);
+    if (it == msg.end() || !it->is_string())
+        return 0;
+    const auto &value = it->get_ref<const std::string &>();
+    return value.empty() ? 0 : value[0];
+}
+
+static std::uint64_t condition_field(const json &msg) {
+    auto it = msg.find("c");
+    if (it == msg.end() || !it->is_array())
+        return 0;
+
+    std::uint64_t mask = 0;
+    for (const auto &c : *it) {
+        if (c.is_string())
+            mask |= conditionBit(c.get_ref<const std::string &>());
+    }
+    return mask;
+}
+
+static std::string_view string_field(const json &msg, const char *key) {
+    auto it = msg.find(key);
+    if (it == msg.end() || !it->is_string())
+        return {};
+    return it->get_ref<const std::string &>();
+}
+
+void parseMessage(const std::string &jsonText, std::vector<MarketEvent> &results) {
     json parsedOutput = json::parse(jsonText, nullptr, false);
     if (parsedOutput.is_discarded())
-        return results;
+        return;
 
     auto handle_datatype = [&](const json &msg) {
         if (!msg.is_object())
             return;
 
-        const std::string T = msg.value("T", "");
+        const std::string_view T = string_field(msg, "T");
         if (T.empty())
             return;
 
@@ -73,10 +325,9 @@ std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
             return;
 
         MarketEvent ev;
-        ev.symbol = msg.value("S", "");
-        ev.timestamp = msg.value("t", "");
-        ev.ts_ns = 0;
-        if (ev.symbol.empty())
+        ev.symbol = internSymbol(string_field(msg, "S"));
+        ev.ts_ns = parseTimestampNs(string_field(msg, "t"));
+        if (ev.symbol == INVALID_SYMBOL)
             return;
 
         // build quote
@@ -84,19 +335,19 @@ std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
 
             Quote q;
 
-            q.bid_exchange = msg.value("bx", "");
+            q.bid_exchange = code_field(msg, "bx");
             q.bid_price = msg.value("bp", 0.0);
             q.bid_size = msg.value("bs", (std::int64_t)0);
-            q.ask_exchange = msg.value("ax", "");
+            q.ask_exchange = code_field(msg, "ax");
             q.ask_price = msg.value("ap", 0.0);
             q.ask_size = msg.value("as", (std::int64_t)0);
-            q.conditions = msg.value("c", std::vector<std::string>{});
-            q.tape = msg.value("z", "");
+            q.conditions = condition_field(msg);
+            q.tape = code_field(msg, "z");
 
             ev.type = MarketEventType::Quote;
-            ev.data = std::move(q);
+            ev.quote = q;
 
-            results.push_back(std::move(ev));
+            results.push_back(ev);
             return;
         }
 
@@ -107,14 +358,14 @@ std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
 
             tr.price = msg.value("p", 0.0);
             tr.size = msg.value("s", (std::int64_t)0);
-            tr.exchange = msg.value("x", "");
-            tr.conditions = msg.value("c", std::vector<std::string>{});
-            tr.tape = msg.value("z", "");
+            tr.exchange = code_field(msg, "x");
+            tr.conditions = condition_field(msg);
+            tr.tape = code_field(msg, "z");
 
             ev.type = MarketEventType::Trade;
-            ev.data = std::move(tr);
+            ev.trade = tr;
 
-            results.push_back(std::move(ev));
+            results.push_back(ev);
             return;
         }
 
@@ -136,8 +387,8 @@ std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
             }
 
             ev.type = MarketEventType::Bar;
-            ev.data = std::move(b);
-            results.push_back(std::move(ev));
+            ev.bar = b;
+            results.push_back(ev);
 
             return;
         }
@@ -150,6 +401,4 @@ std::vector<MarketEvent> parseMessage(const std::string &jsonText) {
     } else {
         handle_datatype(parsedOutput);
     }
-
-    return results;
 }
@@ -1,15 +1,24 @@
 #ifndef DATA_PARSER_H
 #define DATA_PARSER_H
 
+#include <cmath>
 #include <cstdint>
 #include <deque>
 #include <nlohmann/json.hpp>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
-#include <variant>
 #include <vector>
 
+#include "symbol_table.h"
+#include "util/quantile_sketch.h"
+#include "util/rolling_stats.h"
+#include "util/time_series.h"
+#include "util/time_window.h"
+
 using json = nlohmann::json;
 
 /*
@@ -29,17 +38,36 @@ Connected (press CTRL+C to quit)
 [{"T":"b","S":"FAKEPACA","o":132.65,"h":136,"l":132.12,"c":134.65,"v":205,"t":"2024-07-24T07:56:00Z","n":16,"vw":133.7}]
 */
 
-enum class MarketEventType { Quote, Trade, Bar };
+enum class MarketEventType : std::uint8_t { Quote, Trade, Bar };
+
+// Alpaca sends exchanges and tapes as one-letter codes; 0 means the field was missing
+inline std::string_view codeView(const char &code) { return {&code, code ? 1u : 0u}; }
+
+// CTA/UTP trade and quote condition codes, bit i of a condition mask is CONDITION_CODES[i]
+inline constexpr std::string_view CONDITION_CODES[] = {
+    " ", "@", "A", "B", "C", "D", "E", "F", "G", "H", "I", "J", "K", "L", "M", "N", "O", "P", "Q",
+    "R", "S", "T", "U", "V", "W", "X", "Y", "Z", "0", "1", "2", "3", "4", "5", "6", "7", "8", "9",
+};
+inline constexpr std::uint64_t UNKNOWN_CONDITION = std::uint64_t{1} << 63;
+
+std::uint64_t conditionBit(std::string_view code);
+
+// codes set in mask, UNKNOWN_CONDITION shows up as "?"
+std::vector<std::string_view> conditionCodes(std::uint64_t mask);
 
 struct Quote {
-    std::string bid_exchange;            // bx
-    double bid_price = 0.0;              // bp
-    std::int64_t bid_size = 0;           // bs
-    std::string ask_exchange;            // ax
-    double ask_price = 0.0;              // ap
-    std::int64_t ask_size = 0;           // as
-    std::vector<std::string> conditions; // c
-    std::string tape;                    // z
+    double bid_price = 0.0;       // bp
+    double ask_price = 0.0;       // ap
+    std::int64_t bid_size = 0;    // bs
+    std::int64_t ask_size = 0;    // as
+    std::uint64_t conditions = 0; // c, see CONDITION_CODES
+    char bid_exchange = 0;        // bx
+    char ask_exchange = 0;        // ax
+    char tape = 0;                // z
+
+    std::string_view bidExchange() const { return codeView(bid_exchange); }
+    std::string_view askExchange() const { return codeView(ask_exchange); }
+    std::string_view tapeCode() const { return codeView(tape); }
 
     double mid_price() const {
         if (bid_price > 0.0 && ask_price > 0.0)
@@ -55,11 +83,14 @@ struct Quote {
 };
 
 struct Trade {
-    double price = 0.0;                  // p
-    std::int64_t size = 0;               // s
-    std::string exchange;                // x
-    std::vector<std::string> conditions; // c
-    std::string tape;                    // z
+    double price = 0.0;           // p
+    std::int64_t size = 0;        // s
+    std::uint64_t conditions = 0; // c, see CONDITION_CODES
+    char exchange = 0;            // x
+    char tape = 0;                // z
+
+    std::string_view exchangeCode() const { return codeView(exchange); }
+    std::string_view tapeCode() const { return codeView(tape); }
 };
 
 struct Bar {
@@ -75,12 +106,166 @@ struct Bar {
     double body() const { return close - open; }
 };
 
+// trivially copyable, so batches live in a reused flat vector and copying one is a memcpy
 struct MarketEvent {
     MarketEventType type = MarketEventType::Quote;
-    std::string symbol;     // S
-    std::string timestamp;  // t (ISO-8601)
-    std::int64_t ts_ns = 0; // parsed epoch ns if available
-    std::variant<Quote, Trade, Bar> data;
+    SymbolId symbol = INVALID_SYMBOL; // S
+    std::int64_t ts_ns = 0;           // t, epoch ns
+
+    // set by quote conflation: time-weighted spread of every quote folded into this one
+    double spreadSample = 0.0;
+
+    union {
+        Quote quote;
+        Trade trade;
+        Bar bar;
+    };
+
+    MarketEvent() : quote{} {}
+
+    std::string_view symbolName() const { return ::symbolName(symbol); }
+};
+
+static_assert(std::is_trivially_copyable_v<MarketEvent>);
+static_assert(sizeof(MarketEvent) <= 128, "market events should stay within two cache lines");
+
+// realized variance of log returns over a short and a long horizon. the short
+// window is always the newest slice of the long one, so both stay O(1) per push
+struct ReturnVolatility {
+    double lastLogPrice = 0.0;
+    bool hasLast = false;
+
+    RollingStats shortReturns;
+    RollingStats longReturns;
+
+    void push(double price, std::size_t shortN, std::size_t longN) {
+        if (price <= 0.0)
+            return;
+
+        const double logPrice = std::log(price);
+        if (hasLast) {
+            const double r = logPrice - lastLogPrice;
+            shortReturns.push(r, shortN);
+            longReturns.push(r, longN);
+        }
+        lastLogPrice = logPrice;
+        hasLast = true;
+    }
+};
+
+// trade-flow imbalance. every trade is signed as buyer initiated (+size) or seller initiated
+// (-size): by the quote rule against the prevailing quote, above the mid is a buy and below a
+// sell, and by the tick rule at the mid or without a usable quote, an uptick is a buy, a
+// downtick a sell and a zero tick repeats the previous sign. the imbalance of the newest
+// flowN trades is signed over total volume, from -1 (all sells) to +1 (all buys), and every
+// value it takes is kept over the last longN trades as the baseline. O(1) per trade
+struct TradeFlow {
+    double lastPrice = 0.0;
+    int lastSign = 0; // of the previous trade, 0 until one could be classified
+
+    RollingStats signedSizes; // +size / -size of the newest flowN classified trades
+    RollingStats sizes;       // size of the same trades
+    RollingStats imbalances;  // imbalance after each of the last longN trades
+
+    double imbalance() const { return sizes.sum > 0.0 ? signedSizes.sum / sizes.sum : 0.0; }
+
+    // +1 buy, -1 sell, 0 unknown (no quote and no earlier price to tick against)
+    int classify(double price, const std::optional<Quote> &quote) const {
+        if (quote && quote->bid_price > 0.0 && quote->ask_price >= quote->bid_price) {
+            const double mid = quote->mid_price();
+            if (price > mid)
+                return 1;
+            if (price < mid)
+                return -1;
+        }
+        if (lastPrice > 0.0 && price != lastPrice)
+            return price > lastPrice ? 1 : -1;
+        return lastSign;
+    }
+
+    void push(double price, std::int64_t size, const std::optional<Quote> &quote,
+              std::size_t flowN, std::size_t longN) {
+        if (price <= 0.0 || size <= 0)
+            return;
+
+        const int sign = classify(price, quote);
+        lastPrice = price;
+        if (sign == 0)
+            return;
+        lastSign = sign;
+
+        const double volume = static_cast<double>(size);
+        signedSizes.push(sign * volume, flowN);
+        sizes.push(volume, flowN);
+        // the baseline only starts once the flow window is full, partial windows are noisier
+        if (sizes.size() >= flowN)
+            imbalances.push(imbalance(), longN);
+    }
+};
+
+// one regular trading session, 09:30 to 16:00 America/New_York; see sessionSpan in
+// seasonality.h. empty (never contains anything) when there is no session
+struct SessionSpan {
+    std::int64_t startNs = 0;
+    std::int64_t endNs = 0;
+
+    bool contains(std::int64_t tsNs) const { return tsNs >= startNs && tsNs < endNs; }
+};
+
+// session-anchored VWAP, kept as running sums of price x size and size since the open of the
+// current regular session, so each trade is O(1). pre-market and after-hours prints are left
+// out, the sums start over at the first print of the next session. minute bars fold their own vw x volume into a
+// second pair of sums: the two agree when the trade channel saw every print and drift apart
+// when it did not, which is what makes the bar figure a cross-check
+struct SessionVwap {
+    SessionSpan session; // the first print of a later session starts over
+
+    double priceVolume = 0.0; // sum of price x size over the session's trades
+    double volume = 0.0;
+    std::uint64_t trades = 0;
+
+    double barPriceVolume = 0.0; // sum of vw x volume over the session's bars
+    double barVolume = 0.0;
+    double lastBarPriceVolume = 0.0; // the newest bar's share, taken back out if it is updated
+    double lastBarVolume = 0.0;
+
+    double value() const { return volume > 0.0 ? priceVolume / volume : 0.0; }
+    double barValue() const { return barVolume > 0.0 ? barPriceVolume / barVolume : 0.0; }
+
+    void addTrade(double price, std::int64_t size) {
+        if (price <= 0.0 || size <= 0)
+            return;
+        const double shares = static_cast<double>(size);
+        priceVolume += price * shares;
+        volume += shares;
+        ++trades;
+    }
+
+    // an updated bar for the minute already added replaces it rather than adding to it
+    void addBar(const Bar &bar, bool replacesLast) {
+        if (replacesLast) {
+            barPriceVolume -= lastBarPriceVolume;
+            barVolume -= lastBarVolume;
+        }
+        lastBarPriceVolume = 0.0;
+        lastBarVolume = 0.0;
+        if (!bar.vwap || *bar.vwap <= 0.0 || bar.volume <= 0)
+            return;
+        lastBarVolume = static_cast<double>(bar.volume);
+        lastBarPriceVolume = *bar.vwap * lastBarVolume;
+        barPriceVolume += lastBarPriceVolume;
+        barVolume += lastBarVolume;
+    }
+};
+
+class VolumeProfile; // seasonality.h
+
+// what the time-of-day volume profile expected for one session minute
+struct SeasonalExpectation {
+    int minute = -1;           // 0-389 into the regular session, -1 outside it
+    std::uint32_t sessions = 0; // sessions the bucket has learned from
+    double mean = 0.0;
+    double stdev = 0.0;
 };
 
 struct SymbolState {
@@ -88,19 +273,71 @@ struct SymbolState {
     std::optional<Trade> lastTrade;
     std::optional<Bar> lastBar;
 
-    std::string lastQuoteTs;
-    std::string lastTradeTs;
-    std::string lastBarTs;
+    std::int64_t lastQuoteNs = 0;
+    std::int64_t lastTradeNs = 0;
+    std::int64_t lastBarNs = 0;
 
     std::deque<double> prices;
     std::deque<std::int64_t> barVolumes;
     std::deque<std::int64_t> tradeSizes;
     std::deque<double> spreads;
+
+    ReturnVolatility tradeVolatility;
+    ReturnVolatility barVolatility;
+    TradeFlow tradeFlow;
+    SessionVwap vwap;
+
+    RollingStats barRanges;   // high - low per bar
+    RollingStats barGaps;     // open - previous bar close
+    RollingStats quoteDepths; // bid_size + ask_size at the top of book
+    std::optional<double> lastGap;
+
+    // time-based twins of prices / spreads / quoteDepths, only filled when some detector
+    // runs in WindowMode::Time (see configureTimeWindows)
+    TimeWindow timedPrices;
+    TimeWindow timedSpreads;
+    TimeWindow timedDepths;
+
+    SeriesStore series; // 1s / 1m / 5m chart buckets
+
+    // shared with the seasonality store; lastBarExpected is read before lastBar is learned
+    std::shared_ptr<VolumeProfile> volumeProfile;
+    SeasonalExpectation lastBarExpected;
+
+    // long-horizon distributions, carried across restarts by snapshots
+    QuantileSketch tradeSizeQuantiles;
+    QuantileSketch spreadQuantiles;
+
+    std::int64_t lastEventNs = 0; // newest event time, drives LRU eviction
 };
 
-std::vector<MarketEvent> parseMessage(const std::string &jsonText);
+// appends the events in one feed message to out, which callers clear and reuse between reads
+void parseMessage(const std::string &jsonText, std::vector<MarketEvent> &out);
+
+// parses an RFC 3339 timestamp like 2024-07-24T07:56:53.639713735Z into epoch ns, 0 on failure
+std::int64_t parseTimestampNs(std::string_view timestamp);
+
+// inverse of parseTimestampNs, always prints nanoseconds and a Z suffix
+std::string formatTimestampNs(std::int64_t tsNs);
+
+// days since 1970-01-01 for a proleptic gregorian date, and back
+std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d);
+void civilFromDays(std::int64_t days, int &y, unsigned &m, unsigned &d);
+
+// horizon 0 leaves the time windows empty
+struct TimeWindowConfig {
+    std::int64_t horizonNs = 0;
+    std::size_t maxPoints = 4096; // per window per symbol
+};
+
+// set once at startup, before the feed starts
+void configureTimeWindows(const TimeWindowConfig &config);
+const TimeWindowConfig &timeWindowConfig();
+
+// points kept per count window
+inline constexpr std::size_t DEFAULT_WINDOW = 200;
 
 void updateState(std::unordered_map<std::string, SymbolState> &bySymbol,
-                 const std::vector<MarketEvent> &events, std::size_t windowN = 200);
+                 const std::vector<MarketEvent> &events, std::size_t windowN = DEFAULT_WINDOW);
 
 #endif
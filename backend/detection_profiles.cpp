@@ -0,0 +1,236 @@
+#include "detection_profiles.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include "snapshot.h"
+
+namespace {
+
+constexpr double MAX_K = 100.0;
+constexpr std::size_t MIN_POINTS = 2; // a stdev needs two points
+constexpr std::size_t MAX_POINTS = 100000;
+
+void sort_profiles(std::vector<DetectionProfile> &profiles) {
+    std::sort(profiles.begin(), profiles.end(), [](const auto &a, const auto &b) {
+        if ((a.name == DEFAULT_PROFILE) != (b.name == DEFAULT_PROFILE))
+            return a.name == DEFAULT_PROFILE;
+        return a.name < b.name;
+    });
+}
+
+std::filesystem::file_time_type modified(const std::filesystem::path &path) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? std::filesystem::file_time_type{} : time;
+}
+
+constexpr AnomalyType CORRELATION_DETECTORS[] = {AnomalyType::Market, AnomalyType::Sector};
+
+// the per-symbol detector names plus "market" and "sector"
+std::optional<AnomalyType> parse_profile_detector(std::string_view name) {
+    if (auto type = parseDetector(name))
+        return type;
+    for (auto type : CORRELATION_DETECTORS) {
+        if (detectorName(type) == name)
+            return type;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> profile_detector_names(std::uint32_t detectors) {
+    std::vector<std::string> out = detectorNames(detectors);
+    for (auto type : CORRELATION_DETECTORS) {
+        if (detectors & detectorBit(type))
+            out.emplace_back(detectorName(type));
+    }
+    return out;
+}
+
+} // namespace
+
+bool isValidProfileName(std::string_view name) {
+    if (name.empty() || name.size() > MAX_PROFILE_NAME)
+        return false;
+    return std::all_of(name.begin(), name.end(), [](unsigned char ch) {
+        return (ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9') || ch == '-' || ch == '_';
+    });
+}
+
+std::optional<std::string> parseProfile(const nlohmann::json &item, DetectionProfile &profile) {
+    if (!item.is_object())
+        return "profiles must be objects";
+
+    if (auto it = item.find("name"); it != item.end()) {
+        if (!it->is_string() || !isValidProfileName(it->get<std::string>()))
+            return "profile names are 1-8 characters of a-z, 0-9, - and _";
+        profile.name = it->get<std::string>();
+    }
+
+    if (auto it = item.find("k"); it != item.end()) {
+        if (!it->is_number() || !std::isfinite(it->get<double>()) || it->get<double>() <= 0.0 ||
+            it->get<double>() > MAX_K)
+            return "k must be a number above 0 and at most 100";
+        profile.k = it->get<double>();
+    }
+
+    if (auto it = item.find("minPoints"); it != item.end()) {
+        if (!it->is_number_unsigned() || it->get<std::size_t>() < MIN_POINTS ||
+            it->get<std::size_t>() > MAX_POINTS)
+            return "minPoints must be an integer from 2 to 100000";
+        profile.minPoints = it->get<std::size_t>();
+    }
+
+    if (auto it = item.find("detectors"); it != item.end()) {
+        if (!it->is_array())
+            return "detectors must be an array";
+        profile.detectors = 0;
+        for (const auto &name : *it) {
+            const auto type =
+                name.is_string() ? parse_profile_detector(name.get<std::string>()) : std::nullopt;
+            if (!type)
+                return "unknown detector";
+            profile.detectors |= detectorBit(*type);
+        }
+    }
+    return std::nullopt;
+}
+
+nlohmann::json profileJson(const DetectionProfile &profile) {
+    return {{"name", profile.name},
+            {"k", profile.k},
+            {"minPoints", profile.minPoints},
+            {"detectors", profile_detector_names(profile.detectors)}};
+}
+
+DetectionProfiles::DetectionProfiles() : profiles{DetectionProfile{}} {}
+
+void DetectionProfiles::open(const std::filesystem::path &file) {
+    std::lock_guard<std::mutex> lock(mutex);
+    path = file;
+    if (std::filesystem::exists(path))
+        load();
+}
+
+std::vector<DetectionProfile> DetectionProfiles::list() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return profiles;
+}
+
+std::optional<DetectionProfile> DetectionProfiles::find(std::string_view name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &profile : profiles) {
+        if (profile.name == name)
+            return profile;
+    }
+    return std::nullopt;
+}
+
+std::uint64_t DetectionProfiles::generation() const {
+    return changes.load(std::memory_order_acquire);
+}
+
+std::optional<std::string> DetectionProfiles::put(const DetectionProfile &profile) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = std::find_if(profiles.begin(), profiles.end(),
+                           [&](const auto &p) { return p.name == profile.name; });
+    if (it != profiles.end())
+        *it = profile;
+    else
+        profiles.push_back(profile);
+    sort_profiles(profiles);
+    changes.fetch_add(1, std::memory_order_release);
+
+    try {
+        save();
+    } catch (const std::exception &e) {
+        return std::string("profile applied but not saved: ") + e.what();
+    }
+    return std::nullopt;
+}
+
+bool DetectionProfiles::remove(std::string_view name) {
+    if (name == DEFAULT_PROFILE)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto erased = std::erase_if(profiles, [&](const auto &p) { return p.name == name; });
+    if (erased == 0)
+        return false;
+    changes.fetch_add(1, std::memory_order_release);
+
+    try {
+        save();
+    } catch (const std::exception &e) {
+        std::cerr << "Saving detection profiles failed: " << e.what() << "\n";
+    }
+    return true;
+}
+
+bool DetectionProfiles::reloadIfChanged() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (path.empty() || !std::filesystem::exists(path) || modified(path) == loadedTime)
+        return false;
+
+    try {
+        load();
+    } catch (const std::exception &e) {
+        // remember the broken version so it is reported once, not every few seconds
+        loadedTime = modified(path);
+        std::cerr << "Keeping the current detection profiles: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+void DetectionProfiles::load() {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("cannot read " + path.string());
+    std::stringstream text;
+    text << in.rdbuf();
+
+    const nlohmann::json items = nlohmann::json::parse(text.str(), nullptr, false);
+    if (!items.is_array())
+        throw std::runtime_error(path.string() + " must hold a JSON array of profiles");
+
+    std::vector<DetectionProfile> next;
+    for (const auto &item : items) {
+        DetectionProfile profile;
+        if (!item.contains("name"))
+            throw std::runtime_error(path.string() + ": every profile needs a name");
+        if (auto error = parseProfile(item, profile))
+            throw std::runtime_error(path.string() + ": " + *error);
+        if (std::any_of(next.begin(), next.end(),
+                        [&](const auto &p) { return p.name == profile.name; }))
+            throw std::runtime_error(path.string() + ": duplicate profile " + profile.name);
+        next.push_back(std::move(profile));
+    }
+
+    // the file may leave out the default, it then keeps its built-in settings
+    if (std::none_of(next.begin(), next.end(),
+                     [](const auto &p) { return p.name == DEFAULT_PROFILE; }))
+        next.emplace_back();
+    sort_profiles(next);
+
+    loadedTime = modified(path);
+    if (next != profiles) {
+        profiles = std::move(next);
+        changes.fetch_add(1, std::memory_order_release);
+    }
+}
+
+void DetectionProfiles::save() {
+    if (path.empty())
+        return;
+    nlohmann::json out = nlohmann::json::array();
+    for (const auto &profile : profiles)
+        out.push_back(profileJson(profile));
+    writeSnapshotFile(path, out.dump(2) + "\n");
+    loadedTime = modified(path);
+}
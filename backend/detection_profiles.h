@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "subscription.h"
+
+/*
+
+Detection profiles.
+
+A profile is a named set of detection settings: the k a reading has to clear, the fewest
+baseline points a detector may score against, and which detectors run. Every profile is
+evaluated against the same symbol state in the same pass: each detector computes its baseline
+once, at the loosest threshold any profile needs, and every profile then keeps the reading
+only if it clears its own threshold and point count. Profiles track their own episodes, and
+every anomaly carries the name of the profile that raised it. Besides the per-symbol
+detectors a profile can list "market" and "sector", the correlation engine's moves.
+
+There is always a "default" profile (k 2, 20 points, every detector), which may be edited but
+not removed. Names are 1-8 characters of a-z, 0-9, '-' and '_', short enough to fit the
+anomaly store's fixed records.
+
+Profiles are managed with /api/profiles and saved to SAR_PROFILES_PATH (data/profiles.json),
+a JSON array of profile objects:
+
+    [{"name": "default", "k": 2.0, "minPoints": 20, "detectors": ["price", "market"]},
+     {"name": "strict", "k": 3.5, "minPoints": 100}]
+
+Edits made to that file while the backend runs are picked up within a few seconds; a file
+that does not parse is reported and the running profiles are kept.
+
+*/
+
+constexpr std::string_view DEFAULT_PROFILE = "default";
+constexpr std::size_t MAX_PROFILE_NAME = 8;
+
+// a profile may also turn the correlation engine's market and sector moves on and off
+constexpr std::uint32_t PROFILE_DETECTORS =
+    ALL_DETECTORS | detectorBit(AnomalyType::Market) | detectorBit(AnomalyType::Sector);
+
+struct DetectionProfile {
+    std::string name{DEFAULT_PROFILE};
+    double k = 2.0;
+    std::size_t minPoints = 20;
+    std::uint32_t detectors = PROFILE_DETECTORS;
+
+    bool runs(AnomalyType type) const { return (detectors & detectorBit(type)) != 0; }
+
+    bool operator==(const DetectionProfile &) const = default;
+};
+
+bool isValidProfileName(std::string_view name);
+
+// fills profile from {"name", "k", "minPoints", "detectors"}, fields left out keep the
+// defaults; returns an error message when the object is not a valid profile
+std::optional<std::string> parseProfile(const nlohmann::json &item, DetectionProfile &profile);
+nlohmann::json profileJson(const DetectionProfile &profile);
+
+class DetectionProfiles {
+  public:
+    DetectionProfiles();
+
+    // where profiles are saved and reloaded from; loads the file if it exists and throws
+    // std::runtime_error if it does not parse
+    void open(const std::filesystem::path &path);
+
+    // sorted by name, "default" first
+    std::vector<DetectionProfile> list() const;
+    std::optional<DetectionProfile> find(std::string_view name) const;
+
+    // bumped on every change so the feed can skip copying an unchanged set
+    std::uint64_t generation() const;
+
+    // adds or replaces a profile and saves; error message if it could not be saved
+    std::optional<std::string> put(const DetectionProfile &profile);
+
+    // false if there was no such profile; "default" cannot be removed
+    bool remove(std::string_view name);
+
+    // rereads the file if it changed since the last load or save, returns whether it did;
+    // a file that fails to parse is reported on stderr and the current set is kept
+    bool reloadIfChanged();
+
+  private:
+    // callers hold mutex
+    void load();
+    void save();
+
+    mutable std::mutex mutex;
+    std::vector<DetectionProfile> profiles;
+    std::atomic<std::uint64_t> changes{0};
+    std::filesystem::path path;
+    std::filesystem::file_time_type loadedTime{};
+};
@@ -0,0 +1,132 @@
+#include "episode_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include "data_parser.h"
+
+EpisodeTracker::EpisodeTracker(double exitRatio, std::size_t quietLimit,
+                               std::int64_t idleTimeoutNs)
+    : exitRatio(exitRatio), quietLimit(quietLimit), idleTimeoutNs(idleTimeoutNs) {}
+
+double EpisodeTracker::threshold(const std::string &symbol, AnomalyType type, double k) const {
+    if (open.contains(Key{symbol, type, Direction::Up}) ||
+        open.contains(Key{symbol, type, Direction::Down}))
+        return k * exitRatio;
+    return k;
+}
+
+void EpisodeTracker::close(std::unordered_map<Key, Episode, KeyHash>::iterator it,
+                           std::vector<EpisodeTransition> &out) {
+    Anomaly &record = it->second.record;
+    record.active = false;
+    out.push_back({EpisodeTransition::Kind::Closed, std::move(record)});
+    open.erase(it);
+}
+
+bool EpisodeTracker::fresh(const std::string &symbol, AnomalyType type,
+                           std::int64_t sourceNs) const {
+    if (sourceNs <= 0)
+        return false;
+    auto it = scored.find(SourceKey{symbol, type});
+    if (it == scored.end())
+        return sourceNs >= forgottenBeforeNs;
+    return sourceNs > it->second;
+}
+
+void EpisodeTracker::observe(const std::string &symbol, AnomalyType type, double k,
+                             std::optional<Anomaly> reading, std::int64_t sourceNs,
+                             std::vector<EpisodeTransition> &out) {
+    // a re-evaluation of an observation already scored says nothing new
+    if (!fresh(symbol, type, sourceNs))
+        return;
+    scored[SourceKey{symbol, type}] = sourceNs;
+
+    if (reading && reading->ts_ns == 0)
+        reading->ts_ns = parseTimestampNs(reading->timestamp);
+
+    // a reading only opens an episode when it clears the full k, not the exit band
+    const bool breaks = reading && std::abs(reading->zscore) > k;
+
+    for (Direction direction : {Direction::Up, Direction::Down}) {
+        auto it = open.find(Key{symbol, type, direction});
+        if (it == open.end())
+            continue;
+
+        Episode &episode = it->second;
+        if (reading && reading->direction == direction) {
+            Anomaly &record = episode.record;
+            episode.quiet = 0;
+            episode.lastNs = std::max(episode.lastNs, reading->ts_ns);
+
+            ++record.eventCount;
+            record.endTimestamp = reading->timestamp;
+            record.durationMs = (episode.lastNs - episode.startNs) / 1'000'000;
+            if (std::abs(reading->zscore) > std::abs(record.peakZscore))
+                record.peakZscore = reading->zscore;
+
+            out.push_back({EpisodeTransition::Kind::Extended, record});
+        } else if (breaks) {
+            // broke out the other way, the old episode is over
+            close(it, out);
+        } else if (++episode.quiet >= quietLimit) {
+            close(it, out);
+        }
+    }
+
+    if (!breaks || open.contains(Key{symbol, type, reading->direction}))
+        return;
+
+    Episode episode;
+    episode.startNs = reading->ts_ns;
+    episode.lastNs = reading->ts_ns;
+
+    Anomaly &record = episode.record;
+    record = std::move(*reading);
+
+    // the reading may have come from an exit-band evaluation of the other direction
+    record.k = k;
+    record.lower = record.mean - (k * record.stdev);
+    record.upper = record.mean + (k * record.stdev);
+
+    record.episodeId = nextId++;
+    record.active = true;
+    record.endTimestamp = record.timestamp;
+    record.durationMs = 0;
+    record.eventCount = 1;
+    record.peakZscore = record.zscore;
+
+    out.push_back({EpisodeTransition::Kind::Opened, record});
+    open.emplace(Key{symbol, type, record.direction}, std::move(episode));
+}
+
+void EpisodeTracker::expire(std::int64_t nowNs, std::vector<EpisodeTransition> &out) {
+    if (nowNs <= 0)
+        return;
+
+    const std::int64_t silentNs = SILENT_TIMEOUTS * idleTimeoutNs;
+    for (auto it = open.begin(); it != open.end();) {
+        auto next = std::next(it);
+        const std::int64_t lastNs = it->second.lastNs;
+        auto source = scored.find(SourceKey{it->first.symbol, it->first.type});
+        const std::int64_t sourceNs = source != scored.end() ? source->second : lastNs;
+        if (sourceNs - lastNs > idleTimeoutNs || nowNs - lastNs > silentNs)
+            close(it, out);
+        it = next;
+    }
+
+    // an entry older than the silence cutoff has no open episode left (lastNs <= its time),
+    // so it can go; fresh() still rejects anything from before the cutoff. pruned once per
+    // idle timeout rather than on every sweep
+    const std::int64_t cutoff = nowNs - silentNs;
+    if (cutoff - forgottenBeforeNs < idleTimeoutNs)
+        return;
+    std::erase_if(scored, [&](const auto &entry) { return entry.second < cutoff; });
+    forgottenBeforeNs = cutoff;
+}
+
+void EpisodeTracker::closeAll(std::vector<EpisodeTransition> &out) {
+    while (!open.empty())
+        close(open.begin(), out);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "anomaly_detector.h"
+
+/*
+
+Once a symbol breaks its band, every following event usually breaks it too. Instead of one
+anomaly per message, each (symbol, type, direction) gets an episode:
+
+open    reading beyond k with nothing open for that key
+extend  reading still beyond the exit band (k * exitRatio) in the same direction
+close   reading back inside the exit band for quietLimit evaluations in a row, a reversal to
+        the other side, or no extension for idleTimeoutNs of the detector's own source clock
+
+The lower exit band is the hysteresis: a price hovering right at k doesn't open and close a
+new episode on every tick. Each episode is a single Anomaly record whose eventCount,
+peakZscore, endTimestamp and durationMs keep updating until it closes.
+
+Every event for a symbol re-runs its detectors, but a bar detector only has something new
+once a minute and a trade detector on a thin name may not have a new trade for a while. Each
+(symbol, type) remembers the source time it last scored (detectorSourceNs: the last trade,
+quote or bar); an evaluation without a newer one is ignored, so a quote does not extend,
+quiet or reopen an episode on a bar that was already scored. Bar readings carry the minute
+start and arrive about a minute later, so idle time is measured on the source clock too.
+A source that goes silent altogether closes its episodes after SILENT_TIMEOUTS idle
+timeouts of feed time.
+
+*/
+
+struct EpisodeTransition {
+    enum class Kind { Opened, Extended, Closed };
+
+    Kind kind = Kind::Opened;
+    Anomaly record; // full episode record as of this transition
+};
+
+class EpisodeTracker {
+  public:
+    explicit EpisodeTracker(double exitRatio = 0.5, std::size_t quietLimit = 3,
+                            std::int64_t idleTimeoutNs = 60'000'000'000LL);
+
+    // k to evaluate a detector at, lowered to the exit band while an episode is open
+    double threshold(const std::string &symbol, AnomalyType type, double k) const;
+
+    // true when sourceNs is newer than anything this tracker scored for (symbol, type)
+    bool fresh(const std::string &symbol, AnomalyType type, std::int64_t sourceNs) const;
+
+    // feeds one detector evaluation of the source observed at sourceNs; reading is nullopt
+    // when the value was inside the band. a sourceNs that is not fresh is ignored
+    void observe(const std::string &symbol, AnomalyType type, double k,
+                 std::optional<Anomaly> reading, std::int64_t sourceNs,
+                 std::vector<EpisodeTransition> &out);
+
+    // closes episodes idle on their source clock, or whose source went silent at feed time
+    // nowNs, and forgets source times nothing can be compared with any more
+    void expire(std::int64_t nowNs, std::vector<EpisodeTransition> &out);
+
+    // closes everything, used on shutdown so open episodes still get a final record
+    void closeAll(std::vector<EpisodeTransition> &out);
+
+    std::size_t openCount() const { return open.size(); }
+
+    // ids handed out from here on are at least next, so a restart doesn't reuse stored ones
+    static void seedIds(std::uint64_t next) { nextId = std::max(nextId, next); }
+
+  private:
+    struct Key {
+        std::string symbol;
+        AnomalyType type;
+        Direction direction;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const {
+            const std::size_t h = std::hash<std::string>{}(key.symbol);
+            return h ^ (static_cast<std::size_t>(key.type) * 31u +
+                        static_cast<std::size_t>(key.direction) + 0x9e3779b9u + (h << 6) +
+                        (h >> 2));
+        }
+    };
+
+    struct SourceKey {
+        std::string symbol;
+        AnomalyType type;
+
+        bool operator==(const SourceKey &) const = default;
+    };
+
+    struct SourceKeyHash {
+        std::size_t operator()(const SourceKey &key) const {
+            const std::size_t h = std::hash<std::string>{}(key.symbol);
+            return h ^ (static_cast<std::size_t>(key.type) * 31u + 0x9e3779b9u + (h << 6) +
+                        (h >> 2));
+        }
+    };
+
+    struct Episode {
+        Anomaly record;
+        std::int64_t startNs = 0;
+        std::int64_t lastNs = 0;
+        std::size_t quiet = 0;
+    };
+
+    void close(std::unordered_map<Key, Episode, KeyHash>::iterator it,
+               std::vector<EpisodeTransition> &out);
+
+    static constexpr std::int64_t SILENT_TIMEOUTS = 5;
+
+    double exitRatio;
+    std::size_t quietLimit;
+    std::int64_t idleTimeoutNs;
+
+    // shared by every tracker, so episode ids stay unique across detection profiles
+    inline static std::uint64_t nextId = 1;
+    std::unordered_map<Key, Episode, KeyHash> open;
+
+    // newest source time scored per (symbol, type); anything older than forgottenBeforeNs was
+    // scored and then pruned by expire
+    std::unordered_map<SourceKey, std::int64_t, SourceKeyHash> scored;
+    std::int64_t forgottenBeforeNs = 0;
+};
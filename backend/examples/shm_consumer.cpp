@@ -0,0 +1,107 @@
+// Follows the backend through its shared memory region instead of polling the HTTP API.
+//
+// Prints every anomaly transition as it is published and, once a second, the live stats of
+// the symbols named on the command line. Start it before or after the backend; when the
+// backend restarts it reopens the new region.
+//
+//   ./shm_consumer [name=/stock-anomaly-radar] [SYMBOL ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shm_reader.h"
+
+namespace {
+
+const char *event_name(std::uint8_t event) {
+    switch (static_cast<LogEvent>(event)) {
+    case LogEvent::Opened:
+        return "opened";
+    case LogEvent::Extended:
+        return "extended";
+    case LogEvent::Closed:
+        return "closed";
+    case LogEvent::Dropped:
+        break;
+    }
+    return "?";
+}
+
+void print_entry(const AnomalyLogEntry &entry) {
+    const AnomalyRecord &r = entry.record;
+    std::printf("%-8s %-8.16s %-8.8s type %2u dir %u episode %llu z %+7.2f peak %+7.2f events %u\n",
+                event_name(entry.event), r.symbol, r.profile[0] ? r.profile : "default",
+                r.type, r.direction, static_cast<unsigned long long>(r.episode_id), r.zscore,
+                r.peak_zscore, r.event_count);
+}
+
+void print_stats(const SymbolStats &s) {
+    std::printf("  %-8.16s last %.4f  bid %.4f ask %.4f  vwap %.4f  price mean %.4f sd %.4f "
+                "(%u pts)  updates %llu\n",
+                s.symbol, s.trade_price, s.bid_price, s.ask_price, s.vwap, s.price_mean,
+                s.price_stdev, s.price_points, static_cast<unsigned long long>(s.updates));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    const std::string name = argc > 1 ? argv[1] : "/stock-anomaly-radar";
+    const std::vector<std::string> symbols(argv + std::min(argc, 2), argv + argc);
+
+    for (;;) {
+        std::unique_ptr<ShmReader> reader;
+        try {
+            reader = std::make_unique<ShmReader>(name);
+        } catch (const std::exception &e) {
+            std::fprintf(stderr, "%s, retrying\n", e.what());
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+        // the region of a backend that has stopped stays behind until the next one starts
+        if (!reader->live()) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            continue;
+        }
+
+        const ShmHeader &header = reader->header();
+        std::printf("attached to %s: pid %lld, %u symbol slots, %u ring slots\n", name.c_str(),
+                    static_cast<long long>(header.publisherPid), header.symbolCapacity,
+                    header.ringCapacity);
+
+        // anything still in the ring is shown first, then the stream as it happens
+        ShmReader::Cursor cursor = reader->oldest();
+        auto nextStats = std::chrono::steady_clock::now();
+        AnomalyLogEntry entry;
+
+        while (reader->live()) {
+            bool idle = true;
+            while (reader->poll(cursor, entry)) {
+                print_entry(entry);
+                idle = false;
+            }
+            if (cursor.missed > 0) {
+                std::printf("missed %llu entries, reading too slowly\n",
+                            static_cast<unsigned long long>(cursor.missed));
+                cursor.missed = 0;
+            }
+
+            if (!symbols.empty() && std::chrono::steady_clock::now() >= nextStats) {
+                for (const auto &symbol : symbols) {
+                    if (auto stats = reader->findStats(symbol))
+                        print_stats(*stats);
+                }
+                nextStats += std::chrono::seconds(1);
+            }
+            if (idle)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::printf("publisher stopped, waiting for the next one\n");
+    }
+}
@@ -0,0 +1,187 @@
+#include "feed_lag.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+FeedLagConfig config;
+
+constexpr double TIME_CONSTANT_NS = 250'000'000.0;
+constexpr double SYMBOL_ALPHA = 0.1; // per event, a symbol's own prints arrive unevenly
+
+struct SymbolLagSlot {
+    std::atomic<double> lagMs{0.0};
+    std::atomic<double> lastLagMs{0.0};
+    std::atomic<std::int64_t> updatedNs{0};
+};
+
+// 1.5 MB of bss, only the pages of symbols that print are touched
+SymbolLagSlot symbolLags[MAX_SYMBOLS];
+
+void record_symbol(SymbolId id, double lagMs, std::int64_t receivedNs) {
+    if (id >= MAX_SYMBOLS)
+        return;
+    SymbolLagSlot &slot = symbolLags[id];
+    const bool first = slot.updatedNs.load(std::memory_order_relaxed) == 0;
+    const double previous = slot.lagMs.load(std::memory_order_relaxed);
+    slot.lagMs.store(first ? lagMs : previous + SYMBOL_ALPHA * (lagMs - previous),
+                     std::memory_order_relaxed);
+    slot.lastLagMs.store(lagMs, std::memory_order_relaxed);
+    slot.updatedNs.store(receivedNs, std::memory_order_relaxed);
+}
+
+std::int64_t threshold_ns(ShedLevel level) {
+    switch (level) {
+    case ShedLevel::Conflate:
+        return std::chrono::nanoseconds(config.conflate).count();
+    case ShedLevel::SkipDetectors:
+        return std::chrono::nanoseconds(config.skipDetectors).count();
+    case ShedLevel::DropQuotes:
+        return std::chrono::nanoseconds(config.dropQuotes).count();
+    case ShedLevel::None:
+        break;
+    }
+    return 0;
+}
+
+} // namespace
+
+std::string_view shedLevelName(ShedLevel level) {
+    switch (level) {
+    case ShedLevel::None:
+        return "none";
+    case ShedLevel::Conflate:
+        return "conflate";
+    case ShedLevel::SkipDetectors:
+        return "skipDetectors";
+    case ShedLevel::DropQuotes:
+        return "dropQuotes";
+    }
+    return "";
+}
+
+void configureFeedLag(FeedLagConfig next) { config = next; }
+
+const FeedLagConfig &feedLagConfig() { return config; }
+
+std::optional<SymbolLag> symbolLag(SymbolId id) {
+    if (id >= MAX_SYMBOLS)
+        return std::nullopt;
+    const SymbolLagSlot &slot = symbolLags[id];
+    SymbolLag out;
+    out.updatedNs = slot.updatedNs.load(std::memory_order_relaxed);
+    if (out.updatedNs == 0)
+        return std::nullopt;
+    out.lagMs = slot.lagMs.load(std::memory_order_relaxed);
+    out.lastLagMs = slot.lastLagMs.load(std::memory_order_relaxed);
+    return out;
+}
+
+std::vector<std::pair<SymbolId, SymbolLag>> worstSymbolLags(std::size_t n) {
+    std::vector<std::pair<SymbolId, SymbolLag>> out;
+    const std::size_t count = std::min(symbolCount(), MAX_SYMBOLS);
+    for (std::size_t id = 0; id < count; ++id) {
+        if (auto lag = symbolLag(static_cast<SymbolId>(id)))
+            out.emplace_back(static_cast<SymbolId>(id), *lag);
+    }
+
+    auto worse = [](const auto &a, const auto &b) { return a.second.lagMs > b.second.lagMs; };
+    if (out.size() > n) {
+        std::partial_sort(out.begin(), out.begin() + static_cast<std::ptrdiff_t>(n), out.end(),
+                          worse);
+        out.resize(n);
+    } else {
+        std::sort(out.begin(), out.end(), worse);
+    }
+    return out;
+}
+
+ShedLevel FeedLagMonitor::target(double lag) const {
+    const double lagNs = lag * 1e6;
+    for (auto level : {ShedLevel::DropQuotes, ShedLevel::SkipDetectors, ShedLevel::Conflate}) {
+        const std::int64_t threshold = threshold_ns(level);
+        if (threshold > 0 && lagNs >= static_cast<double>(threshold))
+            return level;
+    }
+    return ShedLevel::None;
+}
+
+ShedLevel FeedLagMonitor::observe(const std::vector<MarketEvent> &events,
+                                  std::int64_t receivedNs) {
+    std::int64_t worstNs = -1;
+    for (const auto &ev : events) {
+        if (ev.type == MarketEventType::Bar || ev.ts_ns <= 0)
+            continue;
+        const std::int64_t lagNs = std::max<std::int64_t>(0, receivedNs - ev.ts_ns);
+        worstNs = std::max(worstNs, lagNs);
+        record_symbol(ev.symbol, static_cast<double>(lagNs) / 1e6, receivedNs);
+    }
+    // a batch of bars says nothing new about lag, but the recovery clock still runs
+    if (worstNs >= 0) {
+        const double batchMs = static_cast<double>(worstNs) / 1e6;
+        if (lastReceivedNs == 0) {
+            smoothedMs = batchMs;
+        } else {
+            const auto dt =
+                static_cast<double>(std::max<std::int64_t>(0, receivedNs - lastReceivedNs));
+            smoothedMs += (1.0 - std::exp(-dt / TIME_CONSTANT_NS)) * (batchMs - smoothedMs);
+        }
+        lastReceivedNs = receivedNs;
+
+        lagMs.store(smoothedMs, std::memory_order_relaxed);
+        lastLagMs.store(batchMs, std::memory_order_relaxed);
+        if (batchMs > peakLagMs.load(std::memory_order_relaxed))
+            peakLagMs.store(batchMs, std::memory_order_relaxed);
+    }
+
+    const ShedLevel level = current.load(std::memory_order_relaxed);
+    const ShedLevel wanted = target(smoothedMs);
+    if (wanted > level) {
+        current.store(wanted, std::memory_order_relaxed);
+        levelSinceNs.store(receivedNs, std::memory_order_relaxed);
+        escalations.fetch_add(1, std::memory_order_relaxed);
+        belowSinceNs = 0;
+        return wanted;
+    }
+
+    if (wanted < level) {
+        if (belowSinceNs == 0)
+            belowSinceNs = receivedNs;
+        if (receivedNs - belowSinceNs >= std::chrono::nanoseconds(config.recoverAfter).count()) {
+            const auto lower = static_cast<ShedLevel>(static_cast<std::uint8_t>(level) - 1);
+            current.store(lower, std::memory_order_relaxed);
+            levelSinceNs.store(receivedNs, std::memory_order_relaxed);
+            // the next step down waits out its own recoverAfter
+            belowSinceNs = wanted < lower ? receivedNs : 0;
+            return lower;
+        }
+    } else {
+        belowSinceNs = 0;
+    }
+    return level;
+}
+
+void FeedLagMonitor::reset() {
+    smoothedMs = 0.0;
+    lastReceivedNs = 0;
+    belowSinceNs = 0;
+    current.store(ShedLevel::None, std::memory_order_relaxed);
+    lagMs.store(0.0, std::memory_order_relaxed);
+    lastLagMs.store(0.0, std::memory_order_relaxed);
+    peakLagMs.store(0.0, std::memory_order_relaxed);
+    levelSinceNs.store(0, std::memory_order_relaxed);
+}
+
+FeedLagStats FeedLagMonitor::stats() const {
+    FeedLagStats out;
+    out.lagMs = lagMs.load(std::memory_order_relaxed);
+    out.lastLagMs = lastLagMs.load(std::memory_order_relaxed);
+    out.peakLagMs = peakLagMs.load(std::memory_order_relaxed);
+    out.level = current.load(std::memory_order_relaxed);
+    out.levelSinceNs = levelSinceNs.load(std::memory_order_relaxed);
+    out.escalations = escalations.load(std::memory_order_relaxed);
+    out.quotesDropped = quotesDropped.load(std::memory_order_relaxed);
+    out.detectorsSkipped = detectorsSkipped.load(std::memory_order_relaxed);
+    return out;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "data_parser.h"
+#include "symbol_table.h"
+
+/*
+
+Feed lag and load shedding.
+
+Lag is the local wall clock when a message was read minus the event's own t, so it includes
+the exchange-to-us network path plus however long the message sat in our socket. Trades and
+quotes count; bars are stamped with the start of their minute and would read as a minute
+behind. A skewed local clock shows up as a constant offset, so keep NTP running.
+
+Each feed connection smooths the worst lag of every batch with a time-based EWMA (250 ms time
+constant) and sheds load in steps once it crosses the configured thresholds:
+
+    conflate       quotes are conflated per symbol even if SAR_QUOTE_CONFLATION is off
+    skipDetectors  low-priority symbols still update their state but skip every detector
+    dropQuotes     quotes are dropped before updateState, except for high-priority symbols
+
+Escalation is immediate. Stepping down goes one level at a time, once the smoothed lag has
+stayed under the current level's threshold for recoverAfter, so a connection hovering at a
+threshold does not flap.
+
+Per-symbol lag is an EWMA over that symbol's own trades and quotes, kept in a flat array
+indexed by SymbolId. The reader that owns the symbol writes it and anyone may read it.
+
+*/
+
+// receive timestamps, same epoch as the feed's t
+inline std::int64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+enum class ShedLevel : std::uint8_t { None, Conflate, SkipDetectors, DropQuotes };
+
+std::string_view shedLevelName(ShedLevel level);
+
+struct FeedLagConfig {
+    // smoothed lag that enters each level, 0 disables that level
+    std::chrono::milliseconds conflate{250};
+    std::chrono::milliseconds skipDetectors{1000};
+    std::chrono::milliseconds dropQuotes{3000};
+    std::chrono::milliseconds recoverAfter{5000};
+};
+
+void configureFeedLag(FeedLagConfig config);
+const FeedLagConfig &feedLagConfig();
+
+struct SymbolLag {
+    double lagMs = 0.0;     // smoothed
+    double lastLagMs = 0.0; // newest trade or quote
+    std::int64_t updatedNs = 0;
+};
+
+// lag of the symbol's trades and quotes, nullopt before the first one
+std::optional<SymbolLag> symbolLag(SymbolId id);
+
+// the n symbols with the largest smoothed lag, worst first
+std::vector<std::pair<SymbolId, SymbolLag>> worstSymbolLags(std::size_t n);
+
+struct FeedLagStats {
+    double lagMs = 0.0;     // smoothed, what the shedding decisions use
+    double lastLagMs = 0.0; // worst event of the newest batch
+    double peakLagMs = 0.0; // since the connection came up
+    ShedLevel level = ShedLevel::None;
+    std::int64_t levelSinceNs = 0;
+    std::uint64_t escalations = 0;
+    std::uint64_t quotesDropped = 0;
+    std::uint64_t detectorsSkipped = 0; // symbol evaluations skipped
+};
+
+// one per feed connection, observe() runs on its reader thread and stats() anywhere
+class FeedLagMonitor {
+  public:
+    // records the batch's lags and returns the shedding level to apply to it
+    ShedLevel observe(const std::vector<MarketEvent> &events, std::int64_t receivedNs);
+
+    ShedLevel level() const { return current.load(std::memory_order_relaxed); }
+
+    void countDroppedQuotes(std::uint64_t n) {
+        quotesDropped.fetch_add(n, std::memory_order_relaxed);
+    }
+    void countSkippedDetectors(std::uint64_t n) {
+        detectorsSkipped.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // a new session starts from a clean slate
+    void reset();
+
+    FeedLagStats stats() const;
+
+  private:
+    ShedLevel target(double lagMs) const;
+
+    // reader thread only
+    double smoothedMs = 0.0;
+    std::int64_t lastReceivedNs = 0;
+    std::int64_t belowSinceNs = 0;
+
+    std::atomic<ShedLevel> current{ShedLevel::None};
+    std::atomic<double> lagMs{0.0};
+    std::atomic<double> lastLagMs{0.0};
+    std::atomic<double> peakLagMs{0.0};
+    std::atomic<std::int64_t> levelSinceNs{0};
+    std::atomic<std::uint64_t> escalations{0};
+    std::atomic<std::uint64_t> quotesDropped{0};
+    std::atomic<std::uint64_t> detectorsSkipped{0};
+};
@@ -0,0 +1,99 @@
+#include "feed_partition.h"
+
+#include <algorithm>
+
+FeedPartitioner::FeedPartitioner(std::size_t connections)
+    : loads(std::max<std::size_t>(1, connections), 0) {}
+
+std::size_t FeedPartitioner::weight(const Subscription &subscription) {
+    std::size_t w = 0;
+    if (subscription.has(CHANNEL_QUOTES))
+        w += 4;
+    if (subscription.has(CHANNEL_TRADES))
+        w += 2;
+    if (subscription.has(CHANNEL_BARS))
+        w += 1;
+    return w;
+}
+
+std::size_t FeedPartitioner::rebalance(const SubscriptionMap &tracked) {
+    std::fill(loads.begin(), loads.end(), 0);
+
+    // drop untracked symbols, keep everyone else where they are
+    for (auto it = owner.begin(); it != owner.end();) {
+        auto sub = tracked.find(it->first);
+        if (sub == tracked.end()) {
+            it = owner.erase(it);
+        } else {
+            loads[it->second] += weight(sub->second);
+            ++it;
+        }
+    }
+
+    auto lightest = [&] {
+        return static_cast<std::size_t>(std::min_element(loads.begin(), loads.end()) -
+                                        loads.begin());
+    };
+    auto heaviest = [&] {
+        return static_cast<std::size_t>(std::max_element(loads.begin(), loads.end()) -
+                                        loads.begin());
+    };
+
+    // sorted so the same watchlist always lands the same way
+    std::vector<std::string> added;
+    for (const auto &[symbol, subscription] : tracked) {
+        if (!owner.contains(symbol))
+            added.push_back(symbol);
+    }
+    std::sort(added.begin(), added.end());
+    for (const auto &symbol : added) {
+        const std::size_t target = lightest();
+        owner[symbol] = target;
+        loads[target] += weight(tracked.at(symbol));
+    }
+
+    // move the cheapest symbols off the heaviest connection while that narrows the gap
+    std::size_t moved = 0;
+    for (;;) {
+        const std::size_t from = heaviest();
+        const std::size_t to = lightest();
+
+        std::string pick;
+        std::size_t pickWeight = 0;
+        for (const auto &[symbol, connection] : owner) {
+            if (connection != from)
+                continue;
+            const std::size_t w = weight(tracked.at(symbol));
+            if (w < loads[from] - loads[to] &&
+                (pick.empty() || w < pickWeight || (w == pickWeight && symbol < pick))) {
+                pick = symbol;
+                pickWeight = w;
+            }
+        }
+        if (pick.empty())
+            break;
+
+        owner[pick] = to;
+        loads[from] -= pickWeight;
+        loads[to] += pickWeight;
+        ++moved;
+    }
+    return moved;
+}
+
+SubscriptionMap FeedPartitioner::share(std::size_t connection,
+                                       const SubscriptionMap &tracked) const {
+    SubscriptionMap out;
+    for (const auto &[symbol, subscription] : tracked) {
+        auto it = owner.find(symbol);
+        if (it != owner.end() && it->second == connection)
+            out.emplace(symbol, subscription);
+    }
+    return out;
+}
+
+std::size_t FeedPartitioner::symbolsOn(std::size_t connection) const {
+    return static_cast<std::size_t>(
+        std::count_if(owner.begin(), owner.end(),
+                      [connection](const auto &entry) { return entry.second == connection; }));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "subscription.h"
+
+/*
+
+Splits the tracked symbols across N feed connections.
+
+Assignments are sticky: a symbol stays on its connection for as long as it is tracked, so a
+watchlist change only sends subscribe/unsubscribe for the symbols that actually moved. New
+symbols go to the least loaded connection, and after removals the cheapest symbols are moved
+from the heaviest to the lightest connection for as long as that narrows the gap.
+
+Load is symbol count weighted by channels, quotes being the heaviest stream by far.
+
+Not thread safe, the feed keeps it under subscriptionMutex.
+
+*/
+
+class FeedPartitioner {
+  public:
+    explicit FeedPartitioner(std::size_t connections);
+
+    // brings ownership in line with tracked, returns how many existing symbols moved
+    std::size_t rebalance(const SubscriptionMap &tracked);
+
+    // the part of tracked that connection should be subscribed to
+    SubscriptionMap share(std::size_t connection, const SubscriptionMap &tracked) const;
+
+    std::size_t connections() const { return loads.size(); }
+    std::size_t symbolsOn(std::size_t connection) const;
+
+  private:
+    static std::size_t weight(const Subscription &subscription);
+
+    std::unordered_map<std::string, std::size_t> owner;
+    std::vector<std::size_t> loads;
+};
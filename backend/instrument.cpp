@@ -0,0 +1,219 @@
+#include "instrument.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+std::string_view allocStageName(AllocStage stage) {
+    switch (stage) {
+    case AllocStage::Other:
+        return "other";
+    case AllocStage::Read:
+        return "read";
+    case AllocStage::Parse:
+        return "parse";
+    case AllocStage::Shed:
+        return "shed";
+    case AllocStage::Update:
+        return "update";
+    case AllocStage::Detect:
+        return "detect";
+    case AllocStage::Publish:
+        return "publish";
+    case AllocStage::Api:
+        return "api";
+    case AllocStage::Snapshot:
+        return "snapshot";
+    case AllocStage::Lifecycle:
+        return "lifecycle";
+    case AllocStage::Count:
+        break;
+    }
+    return "";
+}
+
+std::string_view lockName(LockId lock) {
+    switch (lock) {
+    case LockId::State:
+        return "stateMutex";
+    case LockId::Subscription:
+        return "subscriptionMutex";
+    case LockId::Write:
+        return "writeMutex";
+    case LockId::Count:
+        break;
+    }
+    return "";
+}
+
+#ifdef SAR_INSTRUMENT
+
+namespace instrument {
+
+StageSlot stageSlots[ALLOC_STAGES];
+LockSlot lockSlots[LOCK_IDS];
+constinit thread_local AllocStage currentStage = AllocStage::Other;
+
+} // namespace instrument
+
+InstrumentReport instrumentReport() {
+    InstrumentReport report;
+    report.enabled = true;
+    for (std::size_t i = 0; i < ALLOC_STAGES; ++i) {
+        const auto &slot = instrument::stageSlots[i];
+        report.stages[i] = {slot.entries.load(std::memory_order_relaxed),
+                            slot.allocations.load(std::memory_order_relaxed),
+                            slot.bytes.load(std::memory_order_relaxed),
+                            slot.frees.load(std::memory_order_relaxed)};
+    }
+    for (std::size_t i = 0; i < LOCK_IDS; ++i) {
+        const auto &slot = instrument::lockSlots[i];
+        report.locks[i] = {slot.acquisitions.load(std::memory_order_relaxed),
+                           slot.contended.load(std::memory_order_relaxed),
+                           slot.waitNs.load(std::memory_order_relaxed),
+                           slot.maxWaitNs.load(std::memory_order_relaxed),
+                           slot.holdNs.load(std::memory_order_relaxed),
+                           slot.maxHoldNs.load(std::memory_order_relaxed)};
+    }
+    return report;
+}
+
+void printInstrumentReport(std::ostream &out) {
+    const InstrumentReport report = instrumentReport();
+    char line[192];
+
+    out << "Allocations by stage:\n";
+    for (std::size_t i = 0; i < ALLOC_STAGES; ++i) {
+        const AllocCounters &s = report.stages[i];
+        std::snprintf(line, sizeof(line),
+                      "  %-10.*s entries %12llu  allocations %12llu  bytes %14llu  frees %12llu\n",
+                      static_cast<int>(allocStageName(static_cast<AllocStage>(i)).size()),
+                      allocStageName(static_cast<AllocStage>(i)).data(),
+                      static_cast<unsigned long long>(s.entries),
+                      static_cast<unsigned long long>(s.allocations),
+                      static_cast<unsigned long long>(s.bytes),
+                      static_cast<unsigned long long>(s.frees));
+        out << line;
+    }
+
+    out << "Locks:\n";
+    for (std::size_t i = 0; i < LOCK_IDS; ++i) {
+        const LockCounters &l = report.locks[i];
+        const double n = l.acquisitions > 0 ? static_cast<double>(l.acquisitions) : 1.0;
+        std::snprintf(line, sizeof(line),
+                      "  %-17.*s acquired %10llu  contended %9llu  wait avg %9.0f ns max %11llu "
+                      "ns  hold avg %9.0f ns max %11llu ns\n",
+                      static_cast<int>(lockName(static_cast<LockId>(i)).size()),
+                      lockName(static_cast<LockId>(i)).data(),
+                      static_cast<unsigned long long>(l.acquisitions),
+                      static_cast<unsigned long long>(l.contended),
+                      static_cast<double>(l.waitNs) / n,
+                      static_cast<unsigned long long>(l.maxWaitNs),
+                      static_cast<double>(l.holdNs) / n,
+                      static_cast<unsigned long long>(l.maxHoldNs));
+        out << line;
+    }
+}
+
+// global allocation hook. only atomics and malloc in here: anything that allocates would
+// recurse, and this runs before main for static initializers
+namespace {
+
+void count_allocation(std::size_t bytes) {
+    auto &slot = instrument::stageSlots[static_cast<std::size_t>(instrument::currentStage)];
+    slot.allocations.fetch_add(1, std::memory_order_relaxed);
+    slot.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void count_free(void *p) {
+    if (!p)
+        return;
+    auto &slot = instrument::stageSlots[static_cast<std::size_t>(instrument::currentStage)];
+    slot.frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+void *allocate(std::size_t bytes) noexcept {
+    count_allocation(bytes);
+    return std::malloc(bytes ? bytes : 1);
+}
+
+void *allocate_aligned(std::size_t bytes, std::align_val_t align) noexcept {
+    count_allocation(bytes);
+    const auto alignment = static_cast<std::size_t>(align);
+    // aligned_alloc wants a multiple of the alignment
+    const std::size_t rounded = (std::max<std::size_t>(bytes, 1) + alignment - 1) / alignment *
+                                alignment;
+    return std::aligned_alloc(alignment, rounded);
+}
+
+void *allocate_or_throw(std::size_t bytes) {
+    for (;;) {
+        if (void *p = allocate(bytes))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void *allocate_aligned_or_throw(std::size_t bytes, std::align_val_t align) {
+    for (;;) {
+        if (void *p = allocate_aligned(bytes, align))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void release(void *p) noexcept {
+    count_free(p);
+    std::free(p);
+}
+
+} // namespace
+
+void *operator new(std::size_t bytes) { return allocate_or_throw(bytes); }
+void *operator new[](std::size_t bytes) { return allocate_or_throw(bytes); }
+void *operator new(std::size_t bytes, const std::nothrow_t &) noexcept { return allocate(bytes); }
+void *operator new[](std::size_t bytes, const std::nothrow_t &) noexcept {
+    return allocate(bytes);
+}
+void *operator new(std::size_t bytes, std::align_val_t align) {
+    return allocate_aligned_or_throw(bytes, align);
+}
+void *operator new[](std::size_t bytes, std::align_val_t align) {
+    return allocate_aligned_or_throw(bytes, align);
+}
+void *operator new(std::size_t bytes, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return allocate_aligned(bytes, align);
+}
+void *operator new[](std::size_t bytes, std::align_val_t align, const std::nothrow_t &) noexcept {
+    return allocate_aligned(bytes, align);
+}
+
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, std::size_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    release(p);
+}
+
+#else
+
+InstrumentReport instrumentReport() { return {}; }
+
+void printInstrumentReport(std::ostream &) {}
+
+#endif
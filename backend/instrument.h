@@ -0,0 +1,214 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+
+/*
+
+Allocation and lock instrumentation (opt-in at build time, cmake -DSAR_INSTRUMENT=ON).
+
+Allocations: the instrumented build replaces the global operator new and delete. Every
+allocation and free is counted, with its bytes, against the pipeline stage the calling thread
+is in. Threads name their stage with an AllocScope; enter() moves an existing scope on to the
+next stage, so the feed loop keeps one scope per message and marks where each stage starts.
+Anything outside a scope counts as "other". Frees are counted against the stage that frees,
+which is not always the one that allocated. A stage that really is allocation-free shows
+allocations == 0 while its entries keep climbing.
+
+Locks: stateMutex, subscriptionMutex and each feed connection's writeMutex are TrackedMutex.
+In the instrumented build they time how long every lock() waited when the mutex was taken,
+and how long it was held until unlock(). A condition variable wait on a tracked mutex counts
+as an unlock followed by a fresh acquisition, so the time spent asleep is neither.
+
+Both are reported by GET /api/instrumentation and printed at shutdown. Counters run from
+process start; diff two reports to look at a window.
+
+Without SAR_INSTRUMENT, TrackedMutex is std::mutex, AllocScope is empty and new and delete
+are the standard ones, so the default build pays nothing.
+
+*/
+
+enum class AllocStage : std::uint8_t {
+    Other,
+    Read,      // websocket read and copying the message out
+    Parse,     // json to MarketEvents
+    Shed,      // lag monitor, conflation, subscription refresh, quote dropping
+    Update,    // updateState and the correlation grid
+    Detect,    // profiles, detectors, episodes
+    Publish,   // stat blocks, anomaly store, log and shared memory
+    Api,       // http request handling
+    Snapshot,  // snapshot and seasonality files
+    Lifecycle, // reclaim, eviction, profile reload
+    Count
+};
+
+inline constexpr std::size_t ALLOC_STAGES = static_cast<std::size_t>(AllocStage::Count);
+
+enum class LockId : std::uint8_t { State, Subscription, Write, Count };
+
+inline constexpr std::size_t LOCK_IDS = static_cast<std::size_t>(LockId::Count);
+
+std::string_view allocStageName(AllocStage stage);
+std::string_view lockName(LockId lock);
+
+struct AllocCounters {
+    std::uint64_t entries = 0; // times a thread entered the stage
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t frees = 0;
+};
+
+struct LockCounters {
+    std::uint64_t acquisitions = 0;
+    std::uint64_t contended = 0; // acquisitions that found the mutex taken
+    std::uint64_t waitNs = 0;
+    std::uint64_t maxWaitNs = 0;
+    std::uint64_t holdNs = 0;
+    std::uint64_t maxHoldNs = 0;
+};
+
+struct InstrumentReport {
+    bool enabled = false;
+    std::array<AllocCounters, ALLOC_STAGES> stages{};
+    std::array<LockCounters, LOCK_IDS> locks{};
+};
+
+// all zero with enabled == false in the default build
+InstrumentReport instrumentReport();
+
+// one line per stage and lock, nothing in the default build
+void printInstrumentReport(std::ostream &out);
+
+#ifdef SAR_INSTRUMENT
+
+namespace instrument {
+
+struct alignas(64) StageSlot {
+    std::atomic<std::uint64_t> entries{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> bytes{0};
+    std::atomic<std::uint64_t> frees{0};
+};
+
+struct alignas(64) LockSlot {
+    std::atomic<std::uint64_t> acquisitions{0};
+    std::atomic<std::uint64_t> contended{0};
+    std::atomic<std::uint64_t> waitNs{0};
+    std::atomic<std::uint64_t> maxWaitNs{0};
+    std::atomic<std::uint64_t> holdNs{0};
+    std::atomic<std::uint64_t> maxHoldNs{0};
+};
+
+extern StageSlot stageSlots[ALLOC_STAGES];
+extern LockSlot lockSlots[LOCK_IDS];
+extern constinit thread_local AllocStage currentStage;
+
+inline std::uint64_t nowNs() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+inline void storeMax(std::atomic<std::uint64_t> &max, std::uint64_t value) {
+    std::uint64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed))
+        ;
+}
+
+inline void recordAcquire(LockId id, bool contended, std::uint64_t waitNs) {
+    LockSlot &slot = lockSlots[static_cast<std::size_t>(id)];
+    slot.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (!contended)
+        return;
+    slot.contended.fetch_add(1, std::memory_order_relaxed);
+    slot.waitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    storeMax(slot.maxWaitNs, waitNs);
+}
+
+inline void recordHold(LockId id, std::uint64_t holdNs) {
+    LockSlot &slot = lockSlots[static_cast<std::size_t>(id)];
+    slot.holdNs.fetch_add(holdNs, std::memory_order_relaxed);
+    storeMax(slot.maxHoldNs, holdNs);
+}
+
+} // namespace instrument
+
+class AllocScope {
+  public:
+    explicit AllocScope(AllocStage stage) : previous(instrument::currentStage) { enter(stage); }
+    ~AllocScope() { instrument::currentStage = previous; }
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+    void enter(AllocStage stage) {
+        instrument::currentStage = stage;
+        instrument::stageSlots[static_cast<std::size_t>(stage)].entries.fetch_add(
+            1, std::memory_order_relaxed);
+    }
+
+  private:
+    AllocStage previous;
+};
+
+// a std::mutex that reports to lockSlots[Id]; only the holder touches acquiredNs
+template <LockId Id> class TimedMutex {
+  public:
+    void lock() {
+        if (mutex.try_lock()) {
+            acquiredNs = instrument::nowNs();
+            instrument::recordAcquire(Id, false, 0);
+            return;
+        }
+        const std::uint64_t start = instrument::nowNs();
+        mutex.lock();
+        acquiredNs = instrument::nowNs();
+        instrument::recordAcquire(Id, true, acquiredNs - start);
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock())
+            return false;
+        acquiredNs = instrument::nowNs();
+        instrument::recordAcquire(Id, false, 0);
+        return true;
+    }
+
+    // the counters are updated after the release so they do not lengthen the hold
+    void unlock() {
+        const std::uint64_t held = instrument::nowNs() - acquiredNs;
+        mutex.unlock();
+        instrument::recordHold(Id, held);
+    }
+
+  private:
+    std::mutex mutex;
+    std::uint64_t acquiredNs = 0;
+};
+
+template <LockId Id> using TrackedMutex = TimedMutex<Id>;
+using TrackedConditionVariable = std::condition_variable_any;
+
+#else
+
+class AllocScope {
+  public:
+    explicit AllocScope(AllocStage) {}
+
+    AllocScope(const AllocScope &) = delete;
+    AllocScope &operator=(const AllocScope &) = delete;
+
+    void enter(AllocStage) {}
+};
+
+template <LockId> using TrackedMutex = std::mutex;
+using TrackedConditionVariable = std::condition_variable;
+
+#endif
@@ -1,10 +1,15 @@
 #include <deque>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
+#include <csignal>
 #include <condition_variable>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <limits>
 #include <mutex>
 #include <string>
 #include <string_view>
@@ -14,16 +19,39 @@
 #include <vector>
 
 #include "anomaly_detector.h"
+#include "anomaly_log.h"
+#include "anomaly_store.h"
 #include "api.h"
+#include "conflation.h"
+#include "correlation.h"
 #include "data_parser.h"
+#include "detection_profiles.h"
+#include "episode_tracker.h"
+#include "feed_lag.h"
+#include "seasonality.h"
+#include "runtime_mode.h"
+#include "shm_publisher.h"
+#include "snapshot.h"
 #include "socket.h"
+#include "stats_board.h"
+#include "subscription.h"
+#include "symbol_lifecycle.h"
 
 std::unordered_map<std::string, SymbolState> bySymbol;
 std::deque<Anomaly> recentAnomalies;
-std::mutex stateMutex;
-std::unordered_set<std::string> trackedSymbols;
-std::mutex subscriptionMutex;
-std::condition_variable subscriptionCv;
+TrackedMutex<LockId::State> stateMutex;
+CorrelationEngine correlationEngine;
+AnomalyStore anomalyStore;
+AnomalyLog anomalyLog;
+DetectionProfiles detectionProfiles;
+SymbolLifecycle symbolLifecycle;
+StatsBoard statsBoard;
+ShmPublisher shmPublisher;
+QuoteConflator quoteConflator;
+SubscriptionMap trackedSymbols;
+std::atomic<std::uint64_t> subscriptionGeneration{0};
+TrackedMutex<LockId::Subscription> subscriptionMutex;
+TrackedConditionVariable subscriptionCv;
 
 static std::string trim(std::string value) {
     auto is_space = [](unsigned char ch) { return std::isspace(ch); };
@@ -90,13 +118,319 @@ static void load_backend_env(const char *executable_path) {
         load_env_file(candidate);
 }
 
+static long long env_number(const char *name, long long fallback) {
+    const char *v = std::getenv(name);
+    if (!v || !*v)
+        return fallback;
+    char *end = nullptr;
+    const long long n = std::strtoll(v, &end, 10);
+    return end && *end == '\0' ? n : fallback;
+}
+
+static double env_real(const char *name, double fallback) {
+    const char *v = std::getenv(name);
+    if (!v || !*v)
+        return fallback;
+    char *end = nullptr;
+    const double x = std::strtod(v, &end);
+    return end && *end == '\0' ? x : fallback;
+}
+
+// "a,b , c" -> {"a", "b", "c"}
+static std::vector<std::string> split_list(const char *value) {
+    std::vector<std::string> out;
+    std::string item;
+    for (const char *p = value ? value : ""; ; ++p) {
+        if (*p == ',' || *p == '\0') {
+            item = trim(item);
+            if (!item.empty())
+                out.push_back(item);
+            item.clear();
+            if (*p == '\0')
+                break;
+        } else {
+            item += *p;
+        }
+    }
+    return out;
+}
+
+static std::filesystem::path snapshot_path() {
+    const char *v = std::getenv("SAR_SNAPSHOT_PATH");
+    return v && *v ? v : "data/state.snap";
+}
+
+static std::filesystem::path seasonality_path() {
+    const char *v = std::getenv("SAR_SEASONALITY_PATH");
+    return v && *v ? v : "data/seasonality.bin";
+}
+
+// encodes under the lock, the file write happens after it is released
+static void save_snapshot() {
+    AllocScope stage(AllocStage::Snapshot);
+    std::string encoded;
+    std::string seasonality;
+    {
+        std::lock_guard lock(stateMutex);
+        encoded = encodeSnapshot(bySymbol);
+        seasonality = encodeSeasonality();
+    }
+    try {
+        writeSnapshotFile(snapshot_path(), encoded);
+        writeSnapshotFile(seasonality_path(), seasonality);
+    } catch (const std::exception &e) {
+        std::cerr << "Snapshot failed: " << e.what() << "\n";
+    }
+}
+
+static void load_snapshot() {
+    const std::int64_t maxAgeNs =
+        env_number("SAR_SNAPSHOT_MAX_AGE_SEC", 8 * 3600) * 1'000'000'000LL;
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t loaded = loadSnapshotFile(snapshot_path(), bySymbol, maxAgeNs, DEFAULT_WINDOW);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+
+    // restored baselines are readable before the first event arrives
+    for (const auto &[symbol, state] : bySymbol) {
+        const SymbolStats stats = summarizeState(symbol, state);
+        statsBoard.publish(internSymbol(symbol), stats);
+        shmPublisher.publishStats(internSymbol(symbol), stats);
+    }
+
+    if (loaded > 0)
+        std::cout << "Warm start: loaded " << loaded << " symbols from " << snapshot_path()
+                  << " in " << elapsed.count() << " ms\n";
+
+    // volume profiles have no maximum age, they are per time of day rather than per session
+    if (const std::size_t profiles = loadSeasonalityFile(seasonality_path()); profiles > 0)
+        std::cout << "Loaded intraday volume profiles for " << profiles << " symbols from "
+                  << seasonality_path() << "\n";
+}
+
+// "2,3" -> {2, 3}, entries that are not CPU numbers are skipped with a warning
+static std::vector<int> cpu_list(const char *name) {
+    std::vector<int> cpus;
+    for (const auto &item : split_list(std::getenv(name))) {
+        char *end = nullptr;
+        const long cpu = std::strtol(item.c_str(), &end, 10);
+        if (end && *end == '\0' && cpu >= 0)
+            cpus.push_back(static_cast<int>(cpu));
+        else
+            std::cerr << "Ignoring \"" << item << "\" in " << name << ", not a CPU number\n";
+    }
+    return cpus;
+}
+
+// SIGINT / SIGTERM: close episodes so they reach the store, snapshot, then exit without
+// unwinding the threads that are still blocked in reads
+static void wait_for_shutdown(sigset_t signals) {
+    int sig = 0;
+    sigwait(&signals, &sig);
+    std::cout << "Shutting down on signal " << sig << "\n";
+
+    {
+        std::lock_guard lock(stateMutex);
+        close_open_episodes();
+        shmPublisher.close();
+    }
+    anomalyStore.sync();
+    anomalyLog.stop();
+    save_snapshot();
+    printInstrumentReport(std::cout);
+    std::cout.flush();
+    std::_Exit(0);
+}
+
 int main(int argc, char *argv[]) {
     load_backend_env(argc > 0 ? argv[0] : nullptr);
 
-    std::thread apiThread([] { run_http_server(8080); });
+    // every thread inherits the mask, so only the shutdown thread ever sees these
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    // closed anomaly episodes are kept on disk, history is optional if the directory is unusable
+    const char *storeDir = std::getenv("SAR_ANOMALY_STORE_DIR");
+    try {
+        anomalyStore.open(storeDir && *storeDir ? storeDir : "data/anomalies");
+        EpisodeTracker::seedIds(anomalyStore.maxEpisodeId() + 1);
+    } catch (const std::exception &e) {
+        std::cerr << "Anomaly history disabled: " << e.what() << "\n";
+    }
+
+    // opened and closed episodes as JSON lines on stdout unless told otherwise, written by a
+    // background thread so a slow reader of the log never holds up the feed
+    AnomalyLogConfig log;
+    if (const char *path = std::getenv("SAR_ANOMALY_LOG"))
+        log.path = path;
+    if (const char *format = std::getenv("SAR_ANOMALY_LOG_FORMAT");
+        format && std::string_view(format) == "binary")
+        log.format = LogFormat::Binary;
+    if (const char *level = std::getenv("SAR_ANOMALY_LOG_LEVEL"); level && *level) {
+        if (const auto parsed = parseLogLevel(level))
+            log.level = *parsed;
+        else
+            std::cerr << "Unknown SAR_ANOMALY_LOG_LEVEL \"" << level << "\", using info\n";
+    }
+    log.queueCapacity =
+        static_cast<std::size_t>(std::max(2LL, env_number("SAR_ANOMALY_LOG_QUEUE", 8192)));
+    try {
+        anomalyLog.start(log);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << ", logging anomalies to stdout\n";
+        log.path.clear();
+        anomalyLog.start(log);
+    }
+
+    // e.g. SAR_LOW_LATENCY=1 SAR_READER_CPUS=2,3 SAR_WORKER_CPUS=1 SAR_API_CPUS=0, see
+    // runtime_mode.h
+    RuntimeConfig runtime;
+    runtime.lowLatency = env_number("SAR_LOW_LATENCY", 0) != 0;
+    runtime.readerCpus = cpu_list("SAR_READER_CPUS");
+    runtime.workerCpus = cpu_list("SAR_WORKER_CPUS");
+    runtime.apiCpus = cpu_list("SAR_API_CPUS");
+    runtime.busyPoll = env_number("SAR_BUSY_POLL", 1) != 0;
+    runtime.fifoPriority = static_cast<int>(env_number("SAR_FIFO_PRIORITY", 10));
+    runtime.lockMemory = env_number("SAR_LOCK_MEMORY", 1) != 0;
+    runtime.preallocSymbols =
+        static_cast<std::size_t>(std::max(0LL, env_number("SAR_PREALLOC_SYMBOLS", 4096)));
+    configureRuntime(runtime);
+
+    // anomalies and stat blocks for local readers, see shm_layout.h; SAR_SHM_NAME=off disables
+    ShmConfig shm;
+    if (const char *name = std::getenv("SAR_SHM_NAME"); name && *name)
+        shm.name = name;
+    shm.symbolCapacity =
+        static_cast<std::size_t>(std::max(1LL, env_number("SAR_SHM_SYMBOLS", 16384)));
+    shm.ringCapacity =
+        static_cast<std::size_t>(std::max(2LL, env_number("SAR_SHM_RING", 16384)));
+    if (shm.name != "off") {
+        try {
+            shmPublisher.open(shm);
+        } catch (const std::exception &e) {
+            std::cerr << "Shared memory publishing disabled: " << e.what() << "\n";
+        }
+    }
+
+    // windows are back before the feed connects, so detectors work from the first event
+    load_snapshot();
+
+    // sized before memory is locked, so the feed never grows them on a hot path
+    if (runtime.lowLatency) {
+        bySymbol.reserve(runtime.preallocSymbols);
+        statsBoard.reserve(runtime.preallocSymbols);
+    }
+    prepareRuntimeMemory();
+
+    LifecycleConfig lifecycle;
+    lifecycle.reclaimGrace = std::chrono::seconds(env_number("SAR_RECLAIM_GRACE_SEC", 300));
+    lifecycle.memoryBudgetBytes =
+        static_cast<std::size_t>(env_number("SAR_MEMORY_BUDGET_MB", 0)) * 1024 * 1024;
+    const char *coldDir = std::getenv("SAR_COLD_STATE_DIR");
+    lifecycle.coldDir = coldDir ? coldDir : "data/cold";
+    lifecycle.coldMaxAge = std::chrono::seconds(env_number("SAR_SNAPSHOT_MAX_AGE_SEC", 8 * 3600));
+    symbolLifecycle.configure(lifecycle);
+
+    ConflationConfig conflation;
+    conflation.enabled = env_number("SAR_QUOTE_CONFLATION", 0) != 0;
+    conflation.maxHold = std::chrono::microseconds(env_number("SAR_CONFLATION_MAX_HOLD_US", 1000));
+    conflation.minBacklogBytes =
+        static_cast<std::size_t>(env_number("SAR_CONFLATION_MIN_BACKLOG_BYTES", 16 * 1024));
+    quoteConflator.configure(conflation);
+
+    // smoothed feed lag that starts each load shedding stage, 0 turns a stage off
+    FeedLagConfig lag;
+    lag.conflate = std::chrono::milliseconds(env_number("SAR_LAG_CONFLATE_MS", 250));
+    lag.skipDetectors = std::chrono::milliseconds(env_number("SAR_LAG_SKIP_DETECTORS_MS", 1000));
+    lag.dropQuotes = std::chrono::milliseconds(env_number("SAR_LAG_DROP_QUOTES_MS", 3000));
+    lag.recoverAfter = std::chrono::milliseconds(env_number("SAR_LAG_RECOVER_MS", 5000));
+    configureFeedLag(lag);
+
+    // e.g. SAR_TIME_WINDOW_DETECTORS=price,spread scores those against the last
+    // SAR_TIME_WINDOW_SEC of events instead of the last 200 points
+    TimeWindowConfig timeWindows;
+    const long long windowSec = env_number("SAR_TIME_WINDOW_SEC", 60);
+    const bool windowUsable =
+        windowSec > 0 && windowSec <= std::numeric_limits<std::int64_t>::max() / 1'000'000'000LL;
+    for (const auto &name : split_list(std::getenv("SAR_TIME_WINDOW_DETECTORS"))) {
+        const auto type = parseDetector(name);
+        if (type == AnomalyType::Price || type == AnomalyType::Spread ||
+            type == AnomalyType::Liquidity) {
+            // an empty or negative window would leave the detector with nothing to score
+            if (!windowUsable) {
+                std::cerr << "SAR_TIME_WINDOW_SEC must be a positive number of seconds, keeping "
+                             "count mode for detector \"" << name << "\"\n";
+                continue;
+            }
+            setWindowMode(*type, WindowMode::Time);
+            timeWindows.horizonNs = windowSec * 1'000'000'000LL;
+        } else {
+            std::cerr << "No time window for detector \"" << name << "\", keeping count mode\n";
+        }
+    }
+    timeWindows.maxPoints =
+        static_cast<std::size_t>(std::max(1LL, env_number("SAR_TIME_WINDOW_MAX_POINTS", 4096)));
+    configureTimeWindows(timeWindows);
+
+    // named k / minPoints / detector sets, edited through /api/profiles or the file itself
+    const char *profilesPath = std::getenv("SAR_PROFILES_PATH");
+    try {
+        detectionProfiles.open(profilesPath && *profilesPath ? profilesPath : "data/profiles.json");
+    } catch (const std::exception &e) {
+        std::cerr << "Using the default detection profile only: " << e.what() << "\n";
+    }
+
+    // 0.999 flags the largest 0.1% of prints as block trades
+    setTradeSizePercentile(env_real("SAR_BLOCK_TRADE_PERCENTILE", 0.999));
+
+    std::thread apiThread([] {
+        enterThreadRole(ThreadRole::Api);
+        run_http_server(8080);
+    });
     apiThread.detach();
 
-    run_socket();
+    std::thread shutdownThread(wait_for_shutdown, signals);
+    shutdownThread.detach();
+
+    const auto snapshotInterval =
+        std::chrono::seconds(env_number("SAR_SNAPSHOT_INTERVAL_SEC", 60));
+    std::thread snapshotThread([snapshotInterval] {
+        enterThreadRole(ThreadRole::Worker);
+        for (;;) {
+            std::this_thread::sleep_for(snapshotInterval);
+            save_snapshot();
+        }
+    });
+    snapshotThread.detach();
 
-    return 0;
+    std::thread lifecycleThread([] {
+        enterThreadRole(ThreadRole::Worker, 1);
+        for (;;) {
+            std::this_thread::sleep_for(std::chrono::seconds(5));
+            AllocScope stage(AllocStage::Lifecycle);
+            symbolLifecycle.tick();
+            detectionProfiles.reloadIfChanged();
+            try {
+                anomalyStore.maintain();
+            } catch (const std::exception &e) {
+                std::cerr << "Anomaly store maintenance failed: " << e.what() << "\n";
+            }
+        }
+    });
+    lifecycleThread.detach();
+
+    const int status = run_socket();
+
+    {
+        std::lock_guard lock(stateMutex);
+        shmPublisher.close();
+    }
+    anomalyLog.stop();
+    save_snapshot();
+    printInstrumentReport(std::cout);
+    return status;
 }
@@ -0,0 +1,171 @@
+#include "runtime_mode.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+RuntimeConfig config;
+
+std::atomic<bool> memoryLocked{false};
+std::atomic<bool> futureMemoryLocked{false};
+std::atomic<std::uint32_t> pinnedThreads{0};
+std::atomic<std::uint32_t> fifoThreads{0};
+
+std::mutex warningsMutex;
+std::vector<std::string> warnings;
+
+// each distinct problem is printed once, however many threads hit it
+void warn_once(const std::string &message) {
+    std::lock_guard<std::mutex> lock(warningsMutex);
+    for (const auto &w : warnings) {
+        if (w == message)
+            return;
+    }
+    warnings.push_back(message);
+    std::cerr << "Low-latency mode: " << message << "\n";
+}
+
+const std::vector<int> &cpus_for(ThreadRole role) {
+    switch (role) {
+    case ThreadRole::Reader:
+        return config.readerCpus;
+    case ThreadRole::Worker:
+        return config.workerCpus;
+    case ThreadRole::Api:
+        return config.apiCpus;
+    }
+    return config.workerCpus;
+}
+
+const char *role_name(ThreadRole role) {
+    switch (role) {
+    case ThreadRole::Reader:
+        return "reader";
+    case ThreadRole::Worker:
+        return "worker";
+    case ThreadRole::Api:
+        return "api";
+    }
+    return "thread";
+}
+
+bool pin_to(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+// touches the pages below the caller's frame so the first deep call does not fault; the
+// byte read back keeps the array used
+constexpr std::size_t STACK_PREFAULT_BYTES = 256 * 1024;
+constexpr std::size_t PAGE_BYTES = 4096;
+
+[[gnu::noinline]] char prefault_stack() {
+    volatile char stack[STACK_PREFAULT_BYTES];
+    for (std::size_t i = 0; i < STACK_PREFAULT_BYTES; i += PAGE_BYTES)
+        stack[i] = 0;
+    return stack[0];
+}
+
+} // namespace
+
+void configureRuntime(RuntimeConfig next) { config = std::move(next); }
+
+const RuntimeConfig &runtimeConfig() { return config; }
+
+void prepareRuntimeMemory() {
+    if (!config.lowLatency)
+        return;
+
+#ifdef __GLIBC__
+    // freed memory stays in the heap, so a later allocation does not fault fresh pages
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+
+    if (!config.lockMemory)
+        return;
+
+    // MCL_FUTURE under a finite limit turns later growth into allocation failures, so it is
+    // only used when the limit cannot be hit
+    rlimit limit{};
+    const bool unlimited = getrlimit(RLIMIT_MEMLOCK, &limit) == 0 &&
+                           (limit.rlim_cur == RLIM_INFINITY || geteuid() == 0);
+    const int flags = unlimited ? MCL_CURRENT | MCL_FUTURE : MCL_CURRENT;
+    if (mlockall(flags) != 0) {
+        warn_once(std::string("mlockall failed (") + std::strerror(errno) +
+                  "), memory stays pageable; raise the memlock limit or grant CAP_IPC_LOCK");
+        return;
+    }
+    memoryLocked.store(true);
+    futureMemoryLocked.store(unlimited);
+    if (!unlimited)
+        warn_once("memlock limit is finite, only memory mapped at startup is locked");
+}
+
+void enterThreadRole(ThreadRole role, std::size_t index) {
+    if (!config.lowLatency)
+        return;
+
+    const auto &cpus = cpus_for(role);
+    bool pinned = false;
+    if (!cpus.empty()) {
+        const int cpu = cpus[index % cpus.size()];
+        pinned = pin_to(cpu);
+        if (pinned)
+            pinnedThreads.fetch_add(1, std::memory_order_relaxed);
+        else
+            warn_once(std::string("cannot pin ") + role_name(role) + " thread to CPU " +
+                      std::to_string(cpu));
+    }
+
+    if (role == ThreadRole::Reader && config.fifoPriority > 0) {
+        if (!pinned) {
+            warn_once("SCHED_FIFO is only used for pinned readers, check SAR_READER_CPUS");
+        } else {
+            sched_param param{};
+            param.sched_priority =
+                std::clamp(config.fifoPriority, sched_get_priority_min(SCHED_FIFO),
+                           sched_get_priority_max(SCHED_FIFO));
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+                fifoThreads.fetch_add(1, std::memory_order_relaxed);
+            else
+                warn_once("SCHED_FIFO not permitted, readers stay on SCHED_OTHER");
+        }
+    }
+
+    prefault_stack();
+}
+
+RuntimeStatus runtimeStatus() {
+    RuntimeStatus out;
+    out.lowLatency = config.lowLatency;
+    out.busyPoll = config.lowLatency && config.busyPoll;
+    out.memoryLocked = memoryLocked.load();
+    out.futureMemoryLocked = futureMemoryLocked.load();
+    out.pinnedThreads = pinnedThreads.load(std::memory_order_relaxed);
+    out.fifoThreads = fifoThreads.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(warningsMutex);
+        out.warnings = warnings;
+    }
+    return out;
+}
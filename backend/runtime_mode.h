@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+
+Low-latency runtime mode (opt-in, SAR_LOW_LATENCY=1).
+
+By default every thread is an ordinary SCHED_OTHER thread that the kernel can put anywhere,
+and the feed reader sleeps in a blocking read, so each message pays a wakeup and sometimes a
+migration. With the mode on:
+
+  - threads are pinned by role: feed readers to SAR_READER_CPUS (one CPU per connection,
+    round robin), the subscription, snapshot and lifecycle threads to SAR_WORKER_CPUS and
+    the HTTP server to SAR_API_CPUS. An empty list leaves that role unpinned.
+  - readers spin on a non-blocking socket instead of sleeping in recv (SAR_BUSY_POLL, on by
+    default in this mode). That burns the reader's core, so give each one a core of its own.
+  - pinned readers move to SCHED_FIFO at SAR_FIFO_PRIORITY (default 10, 0 to skip) when the
+    process is allowed to (CAP_SYS_NICE or an rtprio limit). Only pinned readers: an unpinned
+    spinning FIFO thread can starve whatever the kernel puts next to it.
+  - at startup the symbol map and stat blocks are sized for SAR_PREALLOC_SYMBOLS symbols,
+    memory is locked with mlockall (SAR_LOCK_MEMORY, default on) which also faults in every
+    mapped page, each thread pre-faults its stack, and glibc is told to keep freed memory
+    instead of returning it to the kernel.
+
+Every step that is not permitted is skipped with one warning; the mode never stops startup.
+What was actually applied is reported under "runtime" in GET /api/feed.
+
+*/
+
+struct RuntimeConfig {
+    bool lowLatency = false;
+    std::vector<int> readerCpus;
+    std::vector<int> workerCpus;
+    std::vector<int> apiCpus;
+    bool busyPoll = false;
+    int fifoPriority = 0; // 0 keeps readers on SCHED_OTHER
+    bool lockMemory = false;
+    std::size_t preallocSymbols = 0;
+};
+
+enum class ThreadRole { Reader, Worker, Api };
+
+struct RuntimeStatus {
+    bool lowLatency = false;
+    bool busyPoll = false;
+    bool memoryLocked = false;
+    bool futureMemoryLocked = false; // MCL_FUTURE, only with an unlimited memlock limit
+    std::uint32_t pinnedThreads = 0;
+    std::uint32_t fifoThreads = 0;
+    std::vector<std::string> warnings;
+};
+
+// call once from main before any thread is started
+void configureRuntime(RuntimeConfig config);
+const RuntimeConfig &runtimeConfig();
+
+// mlockall and heap settings, after the startup allocations so they are faulted in too
+void prepareRuntimeMemory();
+
+// pins the calling thread for its role (index picks the CPU round robin), raises pinned readers
+// to SCHED_FIFO and pre-faults the stack; does nothing unless the mode is on
+void enterThreadRole(ThreadRole role, std::size_t index = 0);
+
+RuntimeStatus runtimeStatus();
+
+// spin-wait hint, keeps a busy loop from starving the sibling hyperthread
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
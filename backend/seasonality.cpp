@@ -0,0 +1,226 @@
+#include "seasonality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+constexpr char SEASONALITY_MAGIC[8] = {'S', 'A', 'R', 'S', 'E', 'A', 'S', '1'};
+constexpr std::uint32_t SEASONALITY_VERSION = 1;
+
+struct SeasonalityHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t buckets;
+    std::uint64_t symbolCount;
+};
+
+static_assert(sizeof(MinuteBucket) == 12);
+
+struct StringViewHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+std::mutex profilesMutex;
+std::unordered_map<std::string, std::shared_ptr<VolumeProfile>, StringViewHash, std::equal_to<>>
+    profiles;
+
+constexpr std::int64_t DAY_SEC = 86400;
+
+// day number of the first Sunday on or after the given date
+std::int64_t first_sunday(std::int64_t y, unsigned m, unsigned d) {
+    const std::int64_t days = daysFromCivil(y, m, d);
+    const std::int64_t weekday = ((days + 4) % 7 + 7) % 7; // 1970-01-01 was a Thursday
+    return days + (7 - weekday) % 7;
+}
+
+// US daylight saving since 2007: second Sunday of March 02:00 EST to first Sunday of
+// November 02:00 EDT, i.e. 07:00 and 06:00 UTC
+bool new_york_dst(std::int64_t utcSec) {
+    int y;
+    unsigned m, d;
+    const std::int64_t days = utcSec / DAY_SEC - (utcSec % DAY_SEC < 0);
+    civilFromDays(days, y, m, d);
+
+    const std::int64_t start = (first_sunday(y, 3, 1) + 7) * DAY_SEC + 7 * 3600;
+    const std::int64_t end = first_sunday(y, 11, 1) * DAY_SEC + 6 * 3600;
+    return utcSec >= start && utcSec < end;
+}
+
+std::int64_t new_york_offset(std::int64_t utcSec) {
+    return (new_york_dst(utcSec) ? -4 : -5) * 3600;
+}
+
+constexpr std::int64_t OPEN_SEC = 9 * 3600 + 30 * 60;
+constexpr std::int64_t CLOSE_SEC = OPEN_SEC + static_cast<std::int64_t>(SESSION_MINUTES) * 60;
+
+// utc seconds of a New York wall-clock time on a local day. daylight saving switches at 02:00
+// local, hours away from the open and close, so the offset at the rough utc time
+// localSec + 5h is the right one
+std::int64_t local_to_utc(std::int64_t localDay, std::int64_t secOfDay) {
+    const std::int64_t localSec = localDay * DAY_SEC + secOfDay;
+    return localSec - new_york_offset(localSec + 5 * 3600);
+}
+
+} // namespace
+
+SessionSpan sessionSpan(std::int64_t tsNs) {
+    if (tsNs <= 0)
+        return {};
+
+    const std::int64_t utcSec = tsNs / 1'000'000'000LL;
+    const std::int64_t localSec = utcSec + new_york_offset(utcSec);
+    const std::int64_t day = localSec / DAY_SEC;
+    const std::int64_t weekday = (day + 4) % 7;
+    if (weekday == 0 || weekday == 6)
+        return {};
+
+    return {local_to_utc(day, OPEN_SEC) * 1'000'000'000LL,
+            local_to_utc(day, CLOSE_SEC) * 1'000'000'000LL};
+}
+
+int sessionMinute(std::int64_t tsNs) {
+    if (tsNs <= 0)
+        return -1;
+
+    const std::int64_t utcSec = tsNs / 1'000'000'000LL;
+    const std::int64_t localSec = utcSec + (new_york_dst(utcSec) ? -4 : -5) * 3600;
+    const std::int64_t days = localSec / DAY_SEC;
+    const std::int64_t weekday = (days + 4) % 7;
+    if (weekday == 0 || weekday == 6)
+        return -1;
+
+    const std::int64_t minute = (localSec % DAY_SEC - (9 * 3600 + 30 * 60)) / 60;
+    if (localSec % DAY_SEC < 9 * 3600 + 30 * 60 ||
+        minute >= static_cast<std::int64_t>(SESSION_MINUTES))
+        return -1;
+    return static_cast<int>(minute);
+}
+
+void VolumeProfile::observe(int minute, double volume) {
+    if (minute < 0 || minute >= static_cast<int>(SESSION_MINUTES) || volume < 0.0)
+        return;
+
+    MinuteBucket &b = minutes[static_cast<std::size_t>(minute)];
+    const double delta = volume - b.mean;
+    double mean, m2;
+    if (b.count < MAX_SESSIONS) {
+        ++b.count;
+        mean = b.mean + delta / b.count;
+        m2 = b.m2 + delta * (volume - mean);
+    } else {
+        // exponential from here on: var' = (1 - a)(var + a delta^2) with a = 1 / MAX_SESSIONS
+        const double a = 1.0 / MAX_SESSIONS;
+        mean = b.mean + a * delta;
+        m2 = (1.0 - a) * (b.m2 + delta * delta);
+    }
+    b.mean = static_cast<float>(mean);
+    b.m2 = static_cast<float>(std::max(0.0, m2));
+}
+
+SeasonalExpectation VolumeProfile::expected(int minute) const {
+    SeasonalExpectation out;
+    if (minute < 0 || minute >= static_cast<int>(SESSION_MINUTES))
+        return out;
+
+    const MinuteBucket &b = minutes[static_cast<std::size_t>(minute)];
+    out.minute = minute;
+    out.sessions = b.count;
+    out.mean = b.mean;
+    out.stdev = b.count > 1 ? std::sqrt(b.m2 / static_cast<double>(b.count)) : 0.0;
+    return out;
+}
+
+std::shared_ptr<VolumeProfile> volumeProfileFor(std::string_view symbol) {
+    std::lock_guard<std::mutex> lock(profilesMutex);
+    if (auto it = profiles.find(symbol); it != profiles.end())
+        return it->second;
+    auto profile = std::make_shared<VolumeProfile>();
+    profiles.emplace(std::string(symbol), profile);
+    return profile;
+}
+
+std::shared_ptr<const VolumeProfile> findVolumeProfile(std::string_view symbol) {
+    std::lock_guard<std::mutex> lock(profilesMutex);
+    auto it = profiles.find(symbol);
+    return it == profiles.end() ? nullptr : it->second;
+}
+
+template <typename T> static void put(std::string &out, const T &value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void pad8(std::string &out) { out.append((8 - out.size() % 8) % 8, '\0'); }
+
+std::string encodeSeasonality() {
+    std::lock_guard<std::mutex> lock(profilesMutex);
+
+    std::string out;
+    SeasonalityHeader header{};
+    std::memcpy(header.magic, SEASONALITY_MAGIC, sizeof(header.magic));
+    header.version = SEASONALITY_VERSION;
+    header.buckets = SESSION_MINUTES;
+    header.symbolCount = profiles.size();
+    out.reserve(sizeof(header) + profiles.size() * (SESSION_MINUTES * sizeof(MinuteBucket) + 32));
+    put(out, header);
+
+    for (const auto &[symbol, profile] : profiles) {
+        const auto len = static_cast<std::uint16_t>(
+            std::min<std::size_t>(symbol.size(), std::numeric_limits<std::uint16_t>::max()));
+        put(out, len);
+        out.append(symbol.data(), len);
+        pad8(out);
+        out.append(reinterpret_cast<const char *>(profile->buckets().data()),
+                   SESSION_MINUTES * sizeof(MinuteBucket));
+        pad8(out);
+    }
+    return out;
+}
+
+std::size_t loadSeasonalityFile(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return 0;
+    const std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    SeasonalityHeader header{};
+    if (data.size() < sizeof(header))
+        return 0;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, SEASONALITY_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != SEASONALITY_VERSION || header.buckets != SESSION_MINUTES)
+        return 0;
+
+    auto aligned = [](std::size_t pos) { return (pos + 7) / 8 * 8; };
+    constexpr std::size_t PROFILE_BYTES = SESSION_MINUTES * sizeof(MinuteBucket);
+
+    std::size_t pos = sizeof(header);
+    std::size_t loaded = 0;
+    for (std::uint64_t i = 0; i < header.symbolCount; ++i) {
+        std::uint16_t len = 0;
+        if (pos + sizeof(len) > data.size())
+            break;
+        std::memcpy(&len, data.data() + pos, sizeof(len));
+        pos += sizeof(len);
+
+        if (pos + len > data.size())
+            break;
+        const std::string_view symbol(data.data() + pos, len);
+        pos = aligned(pos + len);
+
+        if (pos + PROFILE_BYTES > data.size())
+            break;
+        auto profile = volumeProfileFor(symbol);
+        std::memcpy(profile->buckets().data(), data.data() + pos, PROFILE_BYTES);
+        pos = aligned(pos + PROFILE_BYTES);
+        ++loaded;
+    }
+    return loaded;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "data_parser.h"
+
+/*
+
+Intraday seasonality for bar volume.
+
+Minute-bar volume follows the clock: the open and the close trade several times the
+lunchtime volume every day, so a 200-bar window calls the first minutes of every session an
+anomaly. Each symbol instead gets a VolumeProfile of 390 one-minute buckets covering the
+regular session (09:30-16:00 America/New_York), each with a running mean and variance of
+that minute's volume across sessions. Scoring a bar is one array lookup.
+
+Buckets learn with Welford's update until MAX_SESSIONS sessions have been seen and then keep
+that weight, i.e. an exponential average with alpha = 1 / MAX_SESSIONS, so the profile
+follows a name whose volume regime changes. A profile is 390 x 12 bytes, about 4.6 KB.
+
+Profiles live in a process-wide store keyed by symbol and shared with SymbolState, so they
+outlast reclaim, and the store is written to its own file on the snapshot schedule. Unlike
+the snapshot it has no maximum age: last week's profile is still the best guess for today.
+
+    header   magic "SARSEAS1", u32 version, u32 buckets (390), u64 symbolCount
+    symbol   u16 name length, name, padding to 8 bytes, then buckets x {f32 mean, f32 m2,
+             u32 count}, padded to 8 bytes
+
+*/
+
+constexpr std::size_t SESSION_MINUTES = 390;
+
+// 0-389 for a timestamp inside a weekday regular session, -1 otherwise (holidays included)
+int sessionMinute(std::int64_t tsNs);
+
+// the regular session (09:30-16:00 America/New_York) on the weekday a timestamp falls on,
+// whether or not the timestamp is inside it; empty on weekends, holidays are not known
+SessionSpan sessionSpan(std::int64_t tsNs);
+
+struct MinuteBucket {
+    float mean = 0.0f;
+    float m2 = 0.0f; // sum of squared deviations, Welford style
+    std::uint32_t count = 0;
+};
+
+class VolumeProfile {
+  public:
+    static constexpr std::uint32_t MAX_SESSIONS = 20;
+
+    void observe(int minute, double volume);
+    SeasonalExpectation expected(int minute) const;
+
+    const std::array<MinuteBucket, SESSION_MINUTES> &buckets() const { return minutes; }
+    std::array<MinuteBucket, SESSION_MINUTES> &buckets() { return minutes; }
+
+  private:
+    std::array<MinuteBucket, SESSION_MINUTES> minutes{};
+};
+
+// profile for symbol, created empty the first time; thread safe
+std::shared_ptr<VolumeProfile> volumeProfileFor(std::string_view symbol);
+
+// null when the symbol has never been seen
+std::shared_ptr<const VolumeProfile> findVolumeProfile(std::string_view symbol);
+
+// every profile in the store; callers hold stateMutex so updateState is not mid-write
+std::string encodeSeasonality();
+
+// merges profiles from path into the store, returns how many were loaded; call it before
+// the feed starts, loaded buckets are copied in without stateMutex
+std::size_t loadSeasonalityFile(const std::filesystem::path &path);
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -7,11 +8,31 @@
 #include <unordered_set>
 
 #include "anomaly_detector.h"
+#include "anomaly_log.h"
+#include "anomaly_store.h"
+#include "conflation.h"
+#include "correlation.h"
 #include "data_parser.h"
+#include "detection_profiles.h"
+#include "instrument.h"
+#include "shm_publisher.h"
+#include "stats_board.h"
+#include "subscription.h"
+#include "symbol_lifecycle.h"
 
 extern std::unordered_map<std::string, SymbolState> bySymbol;
 extern std::deque<Anomaly> recentAnomalies;
-extern std::mutex stateMutex;
-extern std::unordered_set<std::string> trackedSymbols;
-extern std::mutex subscriptionMutex;
-extern std::condition_variable subscriptionCv;
+extern TrackedMutex<LockId::State> stateMutex;
+extern CorrelationEngine correlationEngine;
+extern AnomalyStore anomalyStore;
+extern AnomalyLog anomalyLog; // lock free, safe to call under stateMutex
+extern DetectionProfiles detectionProfiles; // own mutex, the feed syncs under stateMutex
+extern SymbolLifecycle symbolLifecycle;
+extern StatsBoard statsBoard; // published under stateMutex, read from anywhere
+extern ShmPublisher shmPublisher; // same as statsBoard, read by other processes
+extern QuoteConflator quoteConflator; // reader thread only, stats() is safe anywhere
+extern SubscriptionMap trackedSymbols;
+// bumped on every trackedSymbols change so readers can skip copying an unchanged map
+extern std::atomic<std::uint64_t> subscriptionGeneration;
+extern TrackedMutex<LockId::Subscription> subscriptionMutex;
+extern TrackedConditionVariable subscriptionCv;
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "anomaly_log.h"
+#include "stats_board.h"
+
+/*
+
+Shared memory layout, version 2.
+
+The backend publishes its anomaly transitions and per-symbol stats into a POSIX shared memory
+object (shm_open, SAR_SHM_NAME, "/stock-anomaly-radar" by default) so local consumers can read
+them without going through HTTP and JSON. The object is created fresh on every start: the old
+one is unlinked first, so a reader that still has it mapped sees live == 0 and should reopen.
+
+Native endianness, all offsets from the start of the region, every section 64-byte aligned:
+
+    ShmHeader                       one, at offset 0
+    StatBlock[symbolCapacity]       at statsOffset, indexed by SymbolId
+    ShmRingSlot[ringCapacity]       at ringOffset
+
+Header: magic "SARSHM01", written last once the rest is initialized, then the version and the
+sizes of the structures below so a reader built against another layout can refuse it.
+
+Stat blocks are the StatBlock of stats_board.h: a u64 sequence followed by the words of a
+SymbolStats. The sequence is 0 until the symbol is first published and odd while a write is
+in progress; a reader copies the words and keeps the copy only if the sequence was even and
+unchanged around it. symbolCount is one past the highest id published so far, ids at or past
+symbolCapacity are not published.
+
+The anomaly ring has a single producer and any number of readers, none of which write to the
+region. Entry n (counting from 0 since the region was created) lives in slot n % ringCapacity,
+whose sequence is 2n + 1 while the entry is written and 2n + 2 once it is readable. writePos
+is the number of entries published. A reader keeps its own cursor: when writePos - cursor
+exceeds ringCapacity the oldest entries are gone, and a slot whose sequence is not 2n + 2
+after the copy was overwritten underneath it. Entries are the AnomalyLogEntry of
+anomaly_log.h: wall clock, level, event (0 opened, 1 extended, 2 closed) and the 128-byte
+AnomalyRecord of anomaly_store.h.
+
+shm_reader.h implements all of this for C++ readers.
+
+*/
+
+constexpr char SHM_MAGIC[8] = {'S', 'A', 'R', 'S', 'H', 'M', '0', '1'};
+constexpr std::uint32_t SHM_VERSION = 2;
+
+struct ShmHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize; // sizeof(ShmHeader)
+    std::uint32_t statsSize;  // sizeof(SymbolStats)
+    std::uint32_t entrySize;  // sizeof(AnomalyLogEntry)
+    std::uint32_t symbolCapacity;
+    std::uint32_t ringCapacity; // a power of two
+    std::uint64_t statsOffset;
+    std::uint64_t ringOffset;
+    std::uint64_t totalSize;
+    std::int64_t createdNs;
+    std::int64_t publisherPid;
+
+    alignas(64) std::atomic<std::uint64_t> symbolCount;
+    std::atomic<std::uint32_t> live; // 1 while the publisher runs, 0 after a clean shutdown
+
+    alignas(64) std::atomic<std::uint64_t> writePos; // written by the producer only
+};
+
+struct alignas(64) ShmRingSlot {
+    static constexpr std::size_t WORDS = sizeof(AnomalyLogEntry) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint64_t> words[WORDS];
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared memory readers in other processes rely on lock-free atomics");
+static_assert(sizeof(AnomalyLogEntry) % sizeof(std::uint64_t) == 0);
+static_assert(sizeof(ShmHeader) % 64 == 0 && sizeof(StatBlock) % 64 == 0 &&
+              sizeof(ShmRingSlot) % 64 == 0);
+
+struct ShmSections {
+    std::uint64_t statsOffset;
+    std::uint64_t ringOffset;
+    std::uint64_t totalSize;
+};
+
+inline ShmSections shmSections(std::uint32_t symbolCapacity, std::uint32_t ringCapacity) {
+    ShmSections out;
+    out.statsOffset = sizeof(ShmHeader);
+    out.ringOffset = out.statsOffset + std::uint64_t{symbolCapacity} * sizeof(StatBlock);
+    out.totalSize = out.ringOffset + std::uint64_t{ringCapacity} * sizeof(ShmRingSlot);
+    return out;
+}
@@ -0,0 +1,135 @@
+#include "shm_publisher.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+std::int64_t wall_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+ShmPublisher::~ShmPublisher() { close(); }
+
+void ShmPublisher::open(const ShmConfig &next) {
+    close();
+    config = next;
+
+    const auto symbols =
+        static_cast<std::uint32_t>(std::clamp<std::size_t>(config.symbolCapacity, 1, MAX_SYMBOLS));
+    std::uint32_t slots = 2;
+    while (slots < config.ringCapacity && slots < (1u << 30))
+        slots *= 2;
+    const ShmSections sections = shmSections(symbols, slots);
+
+    // readers of a previous run keep their mapping of the old object, which says live == 0
+    ::shm_unlink(config.name.c_str());
+    const int fd = ::shm_open(config.name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        throw std::runtime_error("cannot create shared memory " + config.name + ": " +
+                                 std::strerror(errno));
+    if (::ftruncate(fd, static_cast<off_t>(sections.totalSize)) != 0) {
+        const int error = errno;
+        ::close(fd);
+        ::shm_unlink(config.name.c_str());
+        throw std::runtime_error("cannot size shared memory " + config.name + ": " +
+                                 std::strerror(error));
+    }
+    void *mapped =
+        ::mmap(nullptr, sections.totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        ::shm_unlink(config.name.c_str());
+        throw std::runtime_error("cannot map shared memory " + config.name + ": " +
+                                 std::strerror(errno));
+    }
+
+    // the object starts zeroed, which is already what every block and slot holds before its
+    // first write; constructing them in place also faults the pages in before the feed runs
+    auto *bytes = static_cast<unsigned char *>(mapped);
+    header = new (bytes) ShmHeader{};
+    header->version = SHM_VERSION;
+    header->headerSize = sizeof(ShmHeader);
+    header->statsSize = sizeof(SymbolStats);
+    header->entrySize = sizeof(AnomalyLogEntry);
+    header->symbolCapacity = symbols;
+    header->ringCapacity = slots;
+    header->statsOffset = sections.statsOffset;
+    header->ringOffset = sections.ringOffset;
+    header->totalSize = sections.totalSize;
+    header->createdNs = wall_ns();
+    header->publisherPid = ::getpid();
+    header->live.store(1, std::memory_order_relaxed);
+
+    blocks = reinterpret_cast<StatBlock *>(bytes + sections.statsOffset);
+    for (std::uint32_t i = 0; i < symbols; ++i)
+        new (&blocks[i]) StatBlock;
+    ring = reinterpret_cast<ShmRingSlot *>(bytes + sections.ringOffset);
+    for (std::uint32_t i = 0; i < slots; ++i)
+        new (&ring[i]) ShmRingSlot{};
+    mask = slots - 1;
+    base = mapped;
+    size = sections.totalSize;
+
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+}
+
+void ShmPublisher::close() {
+    if (!header)
+        return;
+    header->live.store(0, std::memory_order_release);
+    ::munmap(base, size);
+    base = nullptr;
+    header = nullptr;
+    blocks = nullptr;
+    ring = nullptr;
+}
+
+void ShmPublisher::publishStats(SymbolId id, const SymbolStats &stats) {
+    if (!header || id >= header->symbolCapacity)
+        return;
+    blocks[id].publish(stats);
+    if (id >= header->symbolCount.load(std::memory_order_relaxed))
+        header->symbolCount.store(std::uint64_t{id} + 1, std::memory_order_release);
+}
+
+void ShmPublisher::publishAnomaly(LogEvent event, const Anomaly &anomaly) {
+    if (!header)
+        return;
+
+    AnomalyLogEntry entry{};
+    entry.logged_ns = wall_ns();
+    entry.level = static_cast<std::uint8_t>(anomalyLogLevel(event, anomaly));
+    entry.event = static_cast<std::uint8_t>(event);
+    entry.record = toAnomalyRecord(anomaly);
+
+    std::uint64_t raw[ShmRingSlot::WORDS];
+    std::memcpy(raw, &entry, sizeof(raw));
+
+    // same seqlock as a stat block, except the sequence also names the entry it holds
+    const std::uint64_t n = header->writePos.load(std::memory_order_relaxed);
+    ShmRingSlot &slot = ring[n & mask];
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < ShmRingSlot::WORDS; ++i)
+        slot.words[i].store(raw[i], std::memory_order_relaxed);
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+    header->writePos.store(n + 1, std::memory_order_release);
+}
+
+std::uint64_t ShmPublisher::anomaliesPublished() const {
+    return header ? header->writePos.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "anomaly_log.h"
+#include "shm_layout.h"
+#include "stats_board.h"
+#include "symbol_table.h"
+
+/*
+
+Writer side of the shared memory region described in shm_layout.h.
+
+The feed calls publishStats next to statsBoard.publish and publishAnomaly next to the anomaly
+log, both under stateMutex, which makes it the single producer the layout assumes. Either
+call is a copy into the mapping plus a few atomic stores; neither allocates or makes a system
+call. Before open() and after close() both do nothing.
+
+*/
+
+struct ShmConfig {
+    std::string name = "/stock-anomaly-radar"; // shm_open name, must start with '/'
+    std::size_t symbolCapacity = 16384;        // capped at MAX_SYMBOLS
+    std::size_t ringCapacity = 16384;          // rounded up to a power of two
+};
+
+class ShmPublisher {
+  public:
+    ShmPublisher() = default;
+    ~ShmPublisher();
+
+    ShmPublisher(const ShmPublisher &) = delete;
+    ShmPublisher &operator=(const ShmPublisher &) = delete;
+
+    // replaces any region left under the same name, throws std::runtime_error on failure
+    void open(const ShmConfig &config);
+
+    // marks the region stopped for readers and unmaps it, the name stays until the next open;
+    // caller holds stateMutex so nothing is publishing
+    void close();
+
+    bool isOpen() const { return header != nullptr; }
+    const std::string &name() const { return config.name; }
+
+    // caller holds stateMutex
+    void publishStats(SymbolId id, const SymbolStats &stats);
+    void publishAnomaly(LogEvent event, const Anomaly &anomaly);
+
+    std::uint64_t anomaliesPublished() const;
+
+  private:
+    ShmConfig config;
+    void *base = nullptr;
+    std::size_t size = 0;
+    ShmHeader *header = nullptr;
+    StatBlock *blocks = nullptr;
+    ShmRingSlot *ring = nullptr;
+    std::uint64_t mask = 0;
+};
@@ -0,0 +1,122 @@
+#include "shm_reader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ShmReader::ShmReader(const std::string &name) {
+    const int fd = ::shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        throw std::runtime_error("cannot open shared memory " + name + ": " +
+                                 std::strerror(errno));
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ShmHeader)) {
+        ::close(fd);
+        throw std::runtime_error("shared memory " + name + " is not initialized yet");
+    }
+    size = static_cast<std::size_t>(st.st_size);
+    base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        base = nullptr;
+        throw std::runtime_error("cannot map shared memory " + name + ": " +
+                                 std::strerror(errno));
+    }
+
+    head = static_cast<const ShmHeader *>(base);
+    auto fail = [&](const std::string &why) {
+        ::munmap(base, size);
+        base = nullptr;
+        throw std::runtime_error("shared memory " + name + " " + why);
+    };
+
+    // the magic is written last, everything else is settled once it is there
+    if (std::memcmp(head->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0)
+        fail("is not initialized yet");
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (head->version != SHM_VERSION || head->headerSize != sizeof(ShmHeader) ||
+        head->statsSize != sizeof(SymbolStats) || head->entrySize != sizeof(AnomalyLogEntry))
+        fail("has layout version " + std::to_string(head->version) + ", this reader expects " +
+             std::to_string(SHM_VERSION));
+
+    const ShmSections sections = shmSections(head->symbolCapacity, head->ringCapacity);
+    if (head->ringCapacity == 0 || (head->ringCapacity & (head->ringCapacity - 1)) != 0 ||
+        head->statsOffset != sections.statsOffset || head->ringOffset != sections.ringOffset ||
+        head->totalSize != sections.totalSize || sections.totalSize > size)
+        fail("has an inconsistent header");
+
+    const auto *bytes = static_cast<const unsigned char *>(base);
+    blocks = reinterpret_cast<const StatBlock *>(bytes + head->statsOffset);
+    ring = reinterpret_cast<const ShmRingSlot *>(bytes + head->ringOffset);
+}
+
+ShmReader::~ShmReader() {
+    if (base)
+        ::munmap(base, size);
+}
+
+bool ShmReader::live() const { return head->live.load(std::memory_order_acquire) != 0; }
+
+std::size_t ShmReader::symbolCount() const {
+    return static_cast<std::size_t>(head->symbolCount.load(std::memory_order_acquire));
+}
+
+bool ShmReader::readStats(std::uint32_t id, SymbolStats &out) const {
+    if (id >= head->symbolCapacity)
+        return false;
+    return blocks[id].read(out);
+}
+
+std::optional<SymbolStats> ShmReader::findStats(std::string_view symbol) const {
+    SymbolStats stats;
+    const std::size_t count = symbolCount();
+    for (std::uint32_t id = 0; id < count; ++id) {
+        if (readStats(id, stats) &&
+            std::string_view(stats.symbol, strnlen(stats.symbol, sizeof(stats.symbol))) == symbol)
+            return stats;
+    }
+    return std::nullopt;
+}
+
+ShmReader::Cursor ShmReader::oldest() const {
+    const std::uint64_t written = head->writePos.load(std::memory_order_acquire);
+    return {written > head->ringCapacity ? written - head->ringCapacity : 0, 0};
+}
+
+ShmReader::Cursor ShmReader::newest() const {
+    return {head->writePos.load(std::memory_order_acquire), 0};
+}
+
+bool ShmReader::poll(Cursor &cursor, AnomalyLogEntry &out) const {
+    std::uint64_t raw[ShmRingSlot::WORDS];
+    for (;;) {
+        const std::uint64_t written = head->writePos.load(std::memory_order_acquire);
+        if (cursor.next >= written)
+            return false;
+        if (written - cursor.next > head->ringCapacity) {
+            cursor.missed += written - head->ringCapacity - cursor.next;
+            cursor.next = written - head->ringCapacity;
+        }
+
+        const ShmRingSlot &slot = ring[cursor.next & (head->ringCapacity - 1)];
+        const std::uint64_t ready = 2 * cursor.next + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != ready)
+            continue; // the producer lapped us between the two loads, skip ahead
+
+        for (std::size_t i = 0; i < ShmRingSlot::WORDS; ++i)
+            raw[i] = slot.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != ready)
+            continue;
+
+        std::memcpy(&out, raw, sizeof(out));
+        ++cursor.next;
+        return true;
+    }
+}
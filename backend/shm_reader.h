@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "shm_layout.h"
+
+/*
+
+Reader side of the shared memory region described in shm_layout.h, for local consumers that
+want the backend's detections and stats without HTTP. It maps the region read-only and never
+writes to it, so any number of readers cost the backend nothing. Link against sar_shm_reader;
+examples/shm_consumer.cpp shows the intended use.
+
+Stats reads copy one SymbolStats out of its seqlocked block. Anomalies are read through a
+Cursor each reader owns: poll() hands back the next entry, or false once the cursor has
+caught up. A reader that falls more than ringCapacity entries behind loses the oldest ones,
+counted in Cursor::missed.
+
+*/
+
+class ShmReader {
+  public:
+    struct Cursor {
+        std::uint64_t next = 0;   // entry number to read next
+        std::uint64_t missed = 0; // entries overwritten before this cursor reached them
+    };
+
+    // maps the region, throws std::runtime_error if it does not exist, is still being set up,
+    // or was written with a different layout version
+    explicit ShmReader(const std::string &name = "/stock-anomaly-radar");
+    ~ShmReader();
+
+    ShmReader(const ShmReader &) = delete;
+    ShmReader &operator=(const ShmReader &) = delete;
+
+    const ShmHeader &header() const { return *head; }
+
+    // false once the publisher has shut down; a restarted backend creates a new region, so
+    // open a new reader to follow it
+    bool live() const;
+
+    // one past the highest symbol id published so far
+    std::size_t symbolCount() const;
+
+    // false if nothing was published for id yet
+    bool readStats(std::uint32_t id, SymbolStats &out) const;
+
+    // scans the published blocks for a symbol name
+    std::optional<SymbolStats> findStats(std::string_view symbol) const;
+
+    // a cursor at the oldest entry still in the ring, or one that only sees new entries
+    Cursor oldest() const;
+    Cursor newest() const;
+
+    // copies the next entry into out and advances the cursor, false if there is none yet
+    bool poll(Cursor &cursor, AnomalyLogEntry &out) const;
+
+  private:
+    void *base = nullptr;
+    std::size_t size = 0;
+    const ShmHeader *head = nullptr;
+    const StatBlock *blocks = nullptr;
+    const ShmRingSlot *ring = nullptr;
+};
@@ -0,0 +1,363 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'A', 'R', 'S', 'N', 'A', 'P', '1'};
+
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::int64_t createdNs;
+    std::uint64_t symbolCount;
+};
+
+// no symbol entry is shorter than its padded name, last bar time and one array header, so the
+// header's count can't ask for more entries than the file has room for
+constexpr std::size_t MIN_ENTRY_BYTES = 24;
+
+template <typename T> void put(std::string &out, T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void pad8(std::string &out) { out.append((8 - out.size() % 8) % 8, '\0'); }
+
+void put_string(std::string &out, const std::string &value) {
+    const auto len = static_cast<std::uint16_t>(
+        std::min<std::size_t>(value.size(), std::numeric_limits<std::uint16_t>::max()));
+    put(out, len);
+    out.append(value.data(), len);
+    pad8(out);
+}
+
+template <typename Range> void put_array(std::string &out, const Range &values) {
+    put(out, static_cast<std::uint32_t>(values.size()));
+    put(out, std::uint32_t{0});
+    for (auto v : values)
+        put(out, v);
+}
+
+struct Reader {
+    std::string_view data;
+    std::size_t &pos;
+
+    template <typename T> bool get(T &value) {
+        if (pos + sizeof(T) > data.size())
+            return false;
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+
+    bool skip_pad() {
+        pos += (8 - pos % 8) % 8;
+        return pos <= data.size();
+    }
+
+    bool get_string(std::string &value) {
+        std::uint16_t len = 0;
+        if (!get(len) || pos + len > data.size())
+            return false;
+        value.assign(data.data() + pos, len);
+        pos += len;
+        return skip_pad();
+    }
+
+    // calls push(value) for every element
+    template <typename T, typename Push> bool get_array(Push push) {
+        std::uint32_t count = 0, reserved = 0;
+        if (!get(count) || !get(reserved) ||
+            pos + static_cast<std::size_t>(count) * sizeof(T) > data.size())
+            return false;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            T v;
+            std::memcpy(&v, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            push(v);
+        }
+        return true;
+    }
+};
+
+void put_volatility(std::string &out, const ReturnVolatility &vol) {
+    put_array(out, vol.shortReturns.values);
+    put_array(out, vol.longReturns.values);
+    put_array(out, vol.hasLast ? std::vector<double>{vol.lastLogPrice} : std::vector<double>{});
+}
+
+void put_trade_flow(std::string &out, const TradeFlow &flow) {
+    put_array(out, std::vector<double>{flow.lastPrice, static_cast<double>(flow.lastSign)});
+    put_array(out, flow.signedSizes.values);
+    put_array(out, flow.sizes.values);
+    put_array(out, flow.imbalances.values);
+}
+
+// the flow window was bounded when it was written, only the imbalance baseline follows windowN
+bool get_trade_flow(Reader &in, TradeFlow &flow, std::size_t windowN) {
+    const auto none = std::numeric_limits<std::size_t>::max();
+    std::vector<double> last;
+    const bool ok = in.get_array<double>([&](double v) { last.push_back(v); }) &&
+                    in.get_array<double>([&](double v) { flow.signedSizes.push(v, none); }) &&
+                    in.get_array<double>([&](double v) { flow.sizes.push(v, none); }) &&
+                    in.get_array<double>([&](double v) { flow.imbalances.push(v, windowN); });
+    if (ok && last.size() == 2) {
+        flow.lastPrice = last[0];
+        flow.lastSign = static_cast<int>(last[1]);
+    }
+    return ok;
+}
+
+bool get_volatility(Reader &in, ReturnVolatility &vol, std::size_t windowN) {
+    const auto none = std::numeric_limits<std::size_t>::max();
+    return in.get_array<double>([&](double v) { vol.shortReturns.push(v, none); }) &&
+           in.get_array<double>([&](double v) { vol.longReturns.push(v, windowN); }) &&
+           in.get_array<double>([&](double v) {
+               vol.lastLogPrice = v;
+               vol.hasLast = true;
+           });
+}
+
+// observed min and max, then (mean, weight) per centroid
+void put_sketch(std::string &out, const QuantileSketch &sketch) {
+    std::vector<double> values;
+    if (!sketch.empty()) {
+        values = {sketch.min(), sketch.max()};
+        sketch.forEachCentroid([&](const QuantileSketch::Centroid &c) {
+            values.push_back(c.mean);
+            values.push_back(c.weight);
+        });
+    }
+    put_array(out, values);
+}
+
+bool get_sketch(Reader &in, QuantileSketch &sketch) {
+    std::vector<double> values;
+    if (!in.get_array<double>([&](double v) { values.push_back(v); }))
+        return false;
+    if (values.size() < 2 || values.size() % 2 != 0)
+        return values.empty();
+    for (std::size_t i = 2; i < values.size(); i += 2)
+        sketch.add(values[i], values[i + 1]);
+    sketch.setRange(values[0], values[1]);
+    return true;
+}
+
+std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+} // namespace
+
+void encodeSymbolState(std::string &out, const std::string &symbol, const SymbolState &state) {
+    put_string(out, symbol);
+    put(out, state.lastBarNs);
+
+    // last bar is kept so the first bar after a restart still has a previous close for gaps
+    std::vector<double> bar;
+    if (state.lastBar) {
+        const Bar &b = *state.lastBar;
+        bar = {b.open,
+               b.high,
+               b.low,
+               b.close,
+               static_cast<double>(b.volume),
+               static_cast<double>(b.trade_count),
+               b.vwap.value_or(std::numeric_limits<double>::quiet_NaN())};
+    }
+    put_array(out, bar);
+
+    put_array(out, state.prices);
+    put_array(out, state.barVolumes);
+    put_array(out, state.tradeSizes);
+    put_array(out, state.spreads);
+
+    put_volatility(out, state.tradeVolatility);
+    put_volatility(out, state.barVolatility);
+
+    put_array(out, state.barRanges.values);
+    put_array(out, state.barGaps.values);
+    put_array(out, state.quoteDepths.values);
+    put_array(out, state.lastGap ? std::vector<double>{*state.lastGap} : std::vector<double>{});
+
+    put_sketch(out, state.tradeSizeQuantiles);
+    put_sketch(out, state.spreadQuantiles);
+
+    put_trade_flow(out, state.tradeFlow);
+
+    // a restart inside the session picks the VWAP up again, a later one rolls it over anyway
+    const SessionVwap &vwap = state.vwap;
+    put(out, vwap.session.startNs);
+    put(out, vwap.session.endNs);
+    put_array(out, std::vector<double>{vwap.priceVolume, vwap.volume,
+                                       static_cast<double>(vwap.trades), vwap.barPriceVolume,
+                                       vwap.barVolume, vwap.lastBarPriceVolume,
+                                       vwap.lastBarVolume});
+}
+
+bool decodeSymbolState(std::string_view data, std::size_t &pos, std::string &symbol,
+                       SymbolState &state, std::size_t windowN) {
+    Reader in{data, pos};
+    state = SymbolState{};
+
+    if (!in.get_string(symbol) || !in.get(state.lastBarNs))
+        return false;
+
+    std::vector<double> bar;
+    if (!in.get_array<double>([&](double v) { bar.push_back(v); }))
+        return false;
+    if (bar.size() == 7) {
+        Bar b;
+        b.open = bar[0];
+        b.high = bar[1];
+        b.low = bar[2];
+        b.close = bar[3];
+        b.volume = static_cast<std::int64_t>(bar[4]);
+        b.trade_count = static_cast<std::int64_t>(bar[5]);
+        if (!std::isnan(bar[6]))
+            b.vwap = bar[6];
+        state.lastBar = b;
+    }
+
+    auto bounded = [windowN](auto &dq) {
+        return [&dq, windowN](auto v) {
+            dq.push_back(v);
+            if (dq.size() > windowN)
+                dq.pop_front();
+        };
+    };
+    auto rolling = [windowN](RollingStats &stats) {
+        return [&stats, windowN](double v) { stats.push(v, windowN); };
+    };
+
+    std::vector<double> vwap;
+    const bool ok = in.get_array<double>(bounded(state.prices)) &&
+                    in.get_array<std::int64_t>(bounded(state.barVolumes)) &&
+                    in.get_array<std::int64_t>(bounded(state.tradeSizes)) &&
+                    in.get_array<double>(bounded(state.spreads)) &&
+                    get_volatility(in, state.tradeVolatility, windowN) &&
+                    get_volatility(in, state.barVolatility, windowN) &&
+                    in.get_array<double>(rolling(state.barRanges)) &&
+                    in.get_array<double>(rolling(state.barGaps)) &&
+                    in.get_array<double>(rolling(state.quoteDepths)) &&
+                    in.get_array<double>([&](double v) { state.lastGap = v; }) &&
+                    get_sketch(in, state.tradeSizeQuantiles) &&
+                    get_sketch(in, state.spreadQuantiles) &&
+                    get_trade_flow(in, state.tradeFlow, windowN) &&
+                    in.get(state.vwap.session.startNs) && in.get(state.vwap.session.endNs) &&
+                    in.get_array<double>([&](double v) { vwap.push_back(v); });
+    if (!ok)
+        return false;
+    if (vwap.size() == 7) {
+        state.vwap.priceVolume = vwap[0];
+        state.vwap.volume = vwap[1];
+        state.vwap.trades = static_cast<std::uint64_t>(vwap[2]);
+        state.vwap.barPriceVolume = vwap[3];
+        state.vwap.barVolume = vwap[4];
+        state.vwap.lastBarPriceVolume = vwap[5];
+        state.vwap.lastBarVolume = vwap[6];
+    }
+    return true;
+}
+
+std::string encodeSnapshot(const std::unordered_map<std::string, SymbolState> &bySymbol) {
+    std::string out;
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.createdNs = now_ns();
+    header.symbolCount = bySymbol.size();
+    put(out, header);
+
+    for (const auto &[symbol, state] : bySymbol)
+        encodeSymbolState(out, symbol, state);
+    return out;
+}
+
+void writeSnapshotFile(const std::filesystem::path &path, const std::string &encoded) {
+    if (path.has_parent_path())
+        std::filesystem::create_directories(path.parent_path());
+
+    const std::filesystem::path tmp = path.string() + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("cannot write snapshot " + tmp.string() + ": " +
+                                 std::strerror(errno));
+
+    std::size_t written = 0;
+    while (written < encoded.size()) {
+        const ssize_t n = ::write(fd, encoded.data() + written, encoded.size() - written);
+        if (n <= 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot write snapshot " + tmp.string() + ": " +
+                                     std::strerror(errno));
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    ::fsync(fd);
+    ::close(fd);
+
+    std::filesystem::rename(tmp, path);
+}
+
+std::size_t loadSnapshotFile(const std::filesystem::path &path,
+                             std::unordered_map<std::string, SymbolState> &bySymbol,
+                             std::int64_t maxAgeNs, std::size_t windowN) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        ::close(fd);
+        return 0;
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void *mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        return 0;
+    ::madvise(mapping, size, MADV_SEQUENTIAL);
+
+    const std::string_view data(static_cast<const char *>(mapping), size);
+    std::size_t loaded = 0;
+
+    SnapshotHeader header{};
+    std::memcpy(&header, data.data(), sizeof(header));
+    const bool usable = std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) == 0 &&
+                        header.version == SNAPSHOT_VERSION &&
+                        now_ns() - header.createdNs <= maxAgeNs;
+
+    if (usable) {
+        const std::uint64_t fits = (size - sizeof(header)) / MIN_ENTRY_BYTES;
+        bySymbol.reserve(bySymbol.size() + std::min(header.symbolCount, fits));
+        std::size_t pos = sizeof(header);
+        std::string symbol;
+        for (std::uint64_t i = 0; i < header.symbolCount; ++i) {
+            SymbolState state;
+            if (!decodeSymbolState(data, pos, symbol, state, windowN))
+                break;
+            bySymbol[symbol] = std::move(state);
+            ++loaded;
+        }
+    }
+
+    ::munmap(mapping, size);
+    return loaded;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "data_parser.h"
+
+/*
+
+Warm-start snapshots of SymbolState.
+
+Detectors stay silent until their windows fill, which for minute bars is 20+ minutes. The
+snapshot keeps every window and baseline in one compact binary file so a restart can pick
+up where it left off:
+
+    header   magic "SARSNAP1", u32 version, u32 reserved, i64 createdNs, u64 symbolCount
+    symbol   u16 name length, name, padding to 8 bytes, i64 last bar time, then each window
+             as u32 count, u32 reserved, count x 8-byte values; quantile sketches are stored
+             the same way as min, max and then (mean, weight) per centroid; the trade flow as
+             its last price and sign, then its three windows; last the session VWAP as i64
+             session start, i64 session end and an array of its running sums
+
+All values are native little-endian. Files are written to a temp name and renamed, so a
+crash mid-write leaves the previous snapshot intact. Loading maps the file read-only and
+walks it once; a version mismatch or a snapshot older than maxAgeNs is ignored.
+
+*/
+
+constexpr std::uint32_t SNAPSHOT_VERSION = 5;
+
+// appends one symbol's windows to out, the same encoding used inside snapshot files
+void encodeSymbolState(std::string &out, const std::string &symbol, const SymbolState &state);
+
+// reads one symbol back, advancing pos; returns false on a truncated or corrupt entry
+bool decodeSymbolState(std::string_view data, std::size_t &pos, std::string &symbol,
+                       SymbolState &state, std::size_t windowN = DEFAULT_WINDOW);
+
+// full snapshot in memory, cheap enough to build under stateMutex and write afterwards
+std::string encodeSnapshot(const std::unordered_map<std::string, SymbolState> &bySymbol);
+
+// atomic replace of path with the encoded snapshot, throws std::runtime_error on failure
+void writeSnapshotFile(const std::filesystem::path &path, const std::string &encoded);
+
+// loads symbols into bySymbol (existing entries are replaced), returns how many were loaded;
+// windows are trimmed to windowN, which should match what updateState is called with
+std::size_t loadSnapshotFile(const std::filesystem::path &path,
+                             std::unordered_map<std::string, SymbolState> &bySymbol,
+                             std::int64_t maxAgeNs, std::size_t windowN = DEFAULT_WINDOW);
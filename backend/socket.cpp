@@ -1,24 +1,113 @@
 #include "socket.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cmath>
+#include <limits>
+#include <optional>
 #include <thread>
 #include <vector>
 
+#include <sys/socket.h>
+
+#include "feed_lag.h"
+#include "feed_partition.h"
+#include "runtime_mode.h"
+
 namespace beast = boost::beast;
 namespace websocket = beast::websocket;
 namespace net = boost::asio;
 namespace ssl = net::ssl;
 using tcp = net::ip::tcp;
 
-static void record_anomaly(const Anomaly &anomaly) {
+// every detection profile keeps its own episodes, one open per (symbol, type, direction);
+// only touched under stateMutex
+struct ProfileEpisodes {
+    DetectionProfile profile;
+    EpisodeTracker episodes;
+};
+static std::vector<ProfileEpisodes> profileEpisodes;
+static std::uint64_t profilesGeneration = ~std::uint64_t{0};
+
+static void record_anomalies(std::vector<EpisodeTransition> &transitions) {
     constexpr std::size_t MAX_RECENT_ANOMALIES = 100;
 
-    std::cout << anomaly.note << "\n";
-    recentAnomalies.push_back(anomaly);
-    if (recentAnomalies.size() > MAX_RECENT_ANOMALIES) {
-        recentAnomalies.pop_front();
+    for (auto &transition : transitions) {
+        Anomaly &anomaly = transition.record;
+
+        if (transition.kind == EpisodeTransition::Kind::Opened) {
+            if (anomaly.scope == MoveScope::Unclassified)
+                anomaly.scope = correlationEngine.classify(anomaly);
+
+            anomalyLog.log(LogEvent::Opened, anomaly);
+            shmPublisher.publishAnomaly(LogEvent::Opened, anomaly);
+            recentAnomalies.push_back(std::move(anomaly));
+            if (recentAnomalies.size() > MAX_RECENT_ANOMALIES) {
+                recentAnomalies.pop_front();
+            }
+            continue;
+        }
+
+        // extends and closes rewrite the episode's existing slot instead of adding one
+        auto it = std::find_if(recentAnomalies.rbegin(), recentAnomalies.rend(),
+                               [&](const Anomaly &a) { return a.episodeId == anomaly.episodeId; });
+        if (it != recentAnomalies.rend()) {
+            anomaly.scope = it->scope;
+            *it = anomaly;
+        }
+
+        if (transition.kind == EpisodeTransition::Kind::Closed) {
+            anomalyStore.append(anomaly);
+            anomalyLog.log(LogEvent::Closed, anomaly);
+            shmPublisher.publishAnomaly(LogEvent::Closed, anomaly);
+        } else {
+            anomalyLog.log(LogEvent::Extended, anomaly);
+            shmPublisher.publishAnomaly(LogEvent::Extended, anomaly);
+        }
+    }
+    transitions.clear();
+}
+
+void close_open_episodes() {
+    std::vector<EpisodeTransition> transitions;
+    for (auto &tracked : profileEpisodes)
+        tracked.episodes.closeAll(transitions);
+    record_anomalies(transitions);
+}
+
+// picks up profile edits under stateMutex; surviving profiles keep their open episodes and a
+// removed profile closes its own
+static void sync_profiles(std::vector<EpisodeTransition> &transitions) {
+    const std::uint64_t generation = detectionProfiles.generation();
+    if (generation == profilesGeneration)
+        return;
+    profilesGeneration = generation;
+
+    std::vector<ProfileEpisodes> next;
+    std::size_t minPoints = std::numeric_limits<std::size_t>::max();
+    double loosestK = std::numeric_limits<double>::infinity();
+    for (auto &profile : detectionProfiles.list()) {
+        minPoints = std::min(minPoints, profile.minPoints);
+        if (profile.runs(AnomalyType::Market) || profile.runs(AnomalyType::Sector))
+            loosestK = std::min(loosestK, profile.k);
+        auto it = std::find_if(profileEpisodes.begin(), profileEpisodes.end(), [&](const auto &t) {
+            return t.profile.name == profile.name;
+        });
+        if (it != profileEpisodes.end()) {
+            next.push_back({std::move(profile), std::move(it->episodes)});
+            profileEpisodes.erase(it);
+        } else {
+            next.push_back({std::move(profile), EpisodeTracker{}});
+        }
     }
+    for (auto &removed : profileEpisodes)
+        removed.episodes.closeAll(transitions);
+
+    profileEpisodes = std::move(next);
+    setMinBaselinePoints(minPoints);
+    // no profile runs them: nothing is emitted and nothing would be kept
+    correlationEngine.setEmitThreshold(loosestK);
 }
 
 // helper method to handle env vars
@@ -40,192 +129,624 @@ symbols_difference(const std::unordered_set<std::string> &left,
     return result;
 }
 
+// symbols per stream, indexed like SUBSCRIPTION_CHANNELS
+using ChannelSymbols =
+    std::array<std::unordered_set<std::string>, std::size(SUBSCRIPTION_CHANNELS)>;
+
+static ChannelSymbols channel_symbols(const SubscriptionMap &subscriptions) {
+    ChannelSymbols out;
+    for (std::size_t i = 0; i < out.size(); ++i)
+        out[i] = symbolsOnChannel(subscriptions, SUBSCRIPTION_CHANNELS[i]);
+    return out;
+}
+
+// one message per action, only listing the streams that actually change
 template <typename WebSocket>
-static void write_subscription_message(WebSocket &ws, std::mutex &writeMutex,
+static void write_subscription_message(WebSocket &ws, TrackedMutex<LockId::Write> &writeMutex,
                                        const std::string &action,
-                                       const std::unordered_set<std::string> &symbols) {
-    if (symbols.empty())
+                                       const ChannelSymbols &symbols) {
+    json message{{"action", action}};
+    for (std::size_t i = 0; i < symbols.size(); ++i) {
+        if (symbols[i].empty())
+            continue;
+
+        std::vector<std::string> sorted(symbols[i].begin(), symbols[i].end());
+        std::sort(sorted.begin(), sorted.end());
+        message[std::string(channelName(SUBSCRIPTION_CHANNELS[i]))] = sorted;
+    }
+    if (message.size() == 1)
         return;
 
-    std::vector<std::string> sorted(symbols.begin(), symbols.end());
-    std::sort(sorted.begin(), sorted.end());
+    const std::string payload = message.dump();
+    std::lock_guard lock(writeMutex);
+    ws.write(net::buffer(payload));
+}
 
-    json symbolArray = json::array();
-    for (const auto &symbol : sorted)
-        symbolArray.push_back(symbol);
+namespace {
+
+struct FeedEndpoint {
+    bool tls = true;
+    std::string host;
+    std::string port;
+    std::string target;
+};
+
+struct FeedConnection {
+    std::atomic<bool> connected{false};
+    std::atomic<std::uint64_t> messages{0};
+    std::atomic<std::size_t> symbols{0};
+    FeedLagMonitor lag;
+
+    // native socket so a failing sibling can unblock our read, -1 when closed
+    std::mutex fdMutex;
+    int fd = -1;
+};
+
+constexpr std::size_t MAX_FEED_CONNECTIONS = 16;
+
+// tcp socket whose reads and writes spin on the non-blocking socket instead of sleeping in the
+// kernel (SAR_BUSY_POLL). beast and the TLS layer only ever see a blocking stream; it is still
+// the lowest layer, so available() and native_handle() keep working
+class BusyPollSocket : public tcp::socket {
+  public:
+    using tcp::socket::socket;
+
+    template <typename Buffers>
+    std::size_t read_some(const Buffers &buffers, beast::error_code &ec) {
+        for (;;) {
+            const std::size_t n = tcp::socket::read_some(buffers, ec);
+            if (ec != net::error::would_block && ec != net::error::try_again)
+                return n;
+            cpuRelax();
+        }
+    }
 
-    const std::string message = json{{"action", action},
-                                     {"trades", symbolArray},
-                                     {"quotes", symbolArray},
-                                     {"bars", symbolArray}}
-                                    .dump();
+    template <typename Buffers> std::size_t read_some(const Buffers &buffers) {
+        beast::error_code ec;
+        const std::size_t n = read_some(buffers, ec);
+        if (ec)
+            throw beast::system_error{ec};
+        return n;
+    }
 
-    std::lock_guard<std::mutex> lock(writeMutex);
-    ws.write(net::buffer(message));
-}
+    template <typename Buffers>
+    std::size_t write_some(const Buffers &buffers, beast::error_code &ec) {
+        for (;;) {
+            const std::size_t n = tcp::socket::write_some(buffers, ec);
+            if (ec != net::error::would_block && ec != net::error::try_again)
+                return n;
+            cpuRelax();
+        }
+    }
 
-int run_socket() {
-    try {
+    template <typename Buffers> std::size_t write_some(const Buffers &buffers) {
+        beast::error_code ec;
+        const std::size_t n = write_some(buffers, ec);
+        if (ec)
+            throw beast::system_error{ec};
+        return n;
+    }
+};
 
-        const std::string key = getenv_or_throw("APCA_API_KEY_ID");
-        const std::string secret = getenv_or_throw("APCA_API_SECRET_KEY");
+// found by beast through ADL, closes it like any tcp socket
+void teardown(beast::role_type role, BusyPollSocket &socket, beast::error_code &ec) {
+    websocket::teardown(role, static_cast<tcp::socket &>(socket), ec);
+}
 
-        // test stream
-        const std::string host = "stream.data.alpaca.markets"; // alpaca server we are connecting to
-        const std::string port = "443"; // the secure port used for encrypted connections
-        const std::string target = "/v2/iex";
+// switches a freshly connected socket to polling, a no-op for the plain blocking socket
+void start_polling(tcp::socket &) {}
+void start_polling(BusyPollSocket &socket) { socket.non_blocking(true); }
 
-        // object that runs all network work for this program
-        net::io_context ioc;
-        // object holds the rules for making a secure connection as a client
-        ssl::context ctx{ssl::context::tls_client};
+} // namespace
 
-        // This tells the program to trust the normal certificate list on the computer
-        ctx.set_default_verify_paths();
+static std::array<FeedConnection, MAX_FEED_CONNECTIONS> feedSlots;
+static std::atomic<std::size_t> feedSlotCount{0};
 
-        // This tells the program to check the server identity before sending secrets
-        ctx.set_verify_mode(ssl::verify_peer);
+// guarded by subscriptionMutex
+static std::optional<FeedPartitioner> partitioner;
+static std::uint64_t partitionedGeneration = ~std::uint64_t{0};
 
-        // create socket
-        websocket::stream<beast::ssl_stream<tcp::socket>> ws{ioc, ctx};
+static std::string getenv_or(const char *name, const std::string &fallback) {
+    const char *v = std::getenv(name);
+    return v && *v ? std::string(v) : fallback;
+}
 
-        // This object helps find the server address to connect to
-        tcp::resolver resolver{ioc};
-        auto const results =
-            resolver.resolve(host, port); // find the server address which matches the host and port
+// SAR_FEED_URL (ws:// or wss://) wins, handy for a local stand-in server; otherwise Alpaca's
+// stream for SAR_FEED, which is iex unless the account has sip
+static FeedEndpoint feed_endpoint() {
+    const std::string url = getenv_or(
+        "SAR_FEED_URL", "wss://stream.data.alpaca.markets/v2/" + getenv_or("SAR_FEED", "iex"));
+
+    FeedEndpoint endpoint;
+    std::string_view rest = url;
+    if (rest.starts_with("wss://")) {
+        rest.remove_prefix(6);
+    } else if (rest.starts_with("ws://")) {
+        endpoint.tls = false;
+        rest.remove_prefix(5);
+    } else {
+        throw std::runtime_error("feed url must start with ws:// or wss://: " + url);
+    }
 
-        // connect TCP first so the SSL handshake has a valid socket
-        net::connect(ws.next_layer().next_layer(), results.begin(), results.end());
+    const auto slash = rest.find('/');
+    const std::string_view authority = rest.substr(0, slash);
+    endpoint.target = slash == std::string_view::npos ? "/" : std::string(rest.substr(slash));
+
+    const auto colon = authority.rfind(':');
+    endpoint.host = std::string(authority.substr(0, colon));
+    endpoint.port = colon == std::string_view::npos ? (endpoint.tls ? "443" : "80")
+                                                    : std::string(authority.substr(colon + 1));
+    if (endpoint.host.empty())
+        throw std::runtime_error("feed url has no host: " + url);
+    return endpoint;
+}
 
-        // This sets the server name so the secure connection is made to the right site.
-        if (!SSL_set_tlsext_host_name(ws.next_layer().native_handle(), host.c_str())) {
-            // This builds an error code if setting the server name fails.
-            beast::error_code ec{static_cast<int>(::ERR_get_error()),
-                                 net::error::get_ssl_category()};
-            // This stops with a readable error.
-            throw beast::system_error{ec};
-        }
+// this connection's part of the watchlist, caller holds subscriptionMutex
+static SubscriptionMap partition_share(std::size_t index) {
+    const auto generation = subscriptionGeneration.load(std::memory_order_acquire);
+    if (generation != partitionedGeneration) {
+        const std::size_t moved = partitioner->rebalance(trackedSymbols);
+        partitionedGeneration = generation;
+        for (std::size_t i = 0; i < partitioner->connections(); ++i)
+            feedSlots[i].symbols.store(partitioner->symbolsOn(i), std::memory_order_relaxed);
+        if (moved > 0)
+            std::cout << "Feed rebalance moved " << moved << " symbols between connections\n";
+    }
+    return partitioner->share(index, trackedSymbols);
+}
 
-        // start TLS handshake with server
-        ws.next_layer().handshake(ssl::stream_base::client);
+// one connection going down takes the others with it, the same as the single-socket feed
+static void stop_all_connections() {
+    for (std::size_t i = 0; i < feedSlotCount.load(); ++i) {
+        std::lock_guard<std::mutex> lock(feedSlots[i].fdMutex);
+        if (feedSlots[i].fd >= 0)
+            ::shutdown(feedSlots[i].fd, SHUT_RDWR);
+    }
+}
 
-        // start the WebSocket session on top of the encrypted connection
-        ws.handshake(host, target);
+std::vector<FeedConnectionInfo> feedConnections() {
+    std::vector<FeedConnectionInfo> out;
+    for (std::size_t i = 0; i < feedSlotCount.load(); ++i) {
+        const FeedConnection &slot = feedSlots[i];
+        out.push_back({i, slot.connected.load(std::memory_order_relaxed),
+                       slot.symbols.load(std::memory_order_relaxed),
+                       slot.messages.load(std::memory_order_relaxed), slot.lag.stats()});
+    }
+    return out;
+}
 
-        // buffer holds incoming messages from the server
-        beast::flat_buffer buffer;
+// auth, subscriptions and the read loop for one connected websocket, returns only by throwing
+template <typename WebSocket>
+static void run_session(WebSocket &ws, std::size_t index, const std::string &key,
+                        const std::string &secret) {
+    FeedConnection &conn = feedSlots[index];
 
-        // reads the first server message that says we are connected
-        ws.read(buffer);
+    // buffer holds incoming messages from the server
+    beast::flat_buffer buffer;
 
-        // print to terminal
-        // std::cout << beast::make_printable(buffer.data()) << "\n";
+    // reads the first server message that says we are connected
+    ws.read(buffer);
 
-        // This clears the buffer so we can reuse it.
-        buffer.consume(buffer.size());
+    // print to terminal
+    // std::cout << beast::make_printable(buffer.data()) << "\n";
 
-        // logs in over the WebSocket using the key and secret
-        std::string auth_msg =
-            std::string(R"({"action":"auth","key":")") + key + R"(","secret":")" + secret + R"("})";
-        // sends the login message to Alpaca
-        ws.write(net::buffer(auth_msg));
+    // This clears the buffer so we can reuse it.
+    buffer.consume(buffer.size());
 
-        // reads Alpaca’s response to the login
-        ws.read(buffer);
+    // logs in over the WebSocket using the key and secret
+    std::string auth_msg =
+        std::string(R"({"action":"auth","key":")") + key + R"(","secret":")" + secret + R"("})";
+    // sends the login message to Alpaca
+    ws.write(net::buffer(auth_msg));
 
-        // std::cout << beast::make_printable(buffer.data()) << "\n";
+    // reads Alpaca’s response to the login
+    ws.read(buffer);
 
-        buffer.consume(buffer.size());
+    // std::cout << beast::make_printable(buffer.data()) << "\n";
 
-        std::atomic_bool subscriptionsRunning{true};
-        std::mutex writeMutex;
+    buffer.consume(buffer.size());
+    conn.connected.store(true);
 
-        std::thread subscriptionThread([&] {
-            std::unordered_set<std::string> subscribedSymbols;
+    std::atomic_bool subscriptionsRunning{true};
+    TrackedMutex<LockId::Write> writeMutex;
 
-            while (subscriptionsRunning.load()) {
-                std::unordered_set<std::string> desiredSymbols;
-                {
-                    std::unique_lock<std::mutex> lock(subscriptionMutex);
-                    subscriptionCv.wait(lock, [&] {
-                        return !subscriptionsRunning.load() || trackedSymbols != subscribedSymbols;
-                    });
+    std::thread subscriptionThread([&] {
+        enterThreadRole(ThreadRole::Worker, index);
+        SubscriptionMap subscribedSymbols;
 
+        while (subscriptionsRunning.load()) {
+            SubscriptionMap desiredSymbols;
+            {
+                std::unique_lock lock(subscriptionMutex);
+                subscriptionCv.wait(lock, [&] {
                     if (!subscriptionsRunning.load())
-                        return;
+                        return true;
+                    desiredSymbols = partition_share(index);
+                    return desiredSymbols != subscribedSymbols;
+                });
 
-                    desiredSymbols = trackedSymbols;
-                }
-
-                const auto symbolsToSubscribe =
-                    symbols_difference(desiredSymbols, subscribedSymbols);
-                const auto symbolsToUnsubscribe =
-                    symbols_difference(subscribedSymbols, desiredSymbols);
-
-                try {
-                    write_subscription_message(ws, writeMutex, "subscribe", symbolsToSubscribe);
-                    write_subscription_message(ws, writeMutex, "unsubscribe",
-                                               symbolsToUnsubscribe);
-                    subscribedSymbols = desiredSymbols;
-                } catch (const std::exception &e) {
-                    std::cerr << "Subscription error: " << e.what() << "\n";
-                    subscriptionsRunning.store(false);
-                    subscriptionCv.notify_all();
+                if (!subscriptionsRunning.load())
                     return;
-                }
             }
-        });
 
+            // diffed per stream, so narrowing a symbol to bars only drops its trades and quotes
+            const ChannelSymbols desired = channel_symbols(desiredSymbols);
+            const ChannelSymbols subscribed = channel_symbols(subscribedSymbols);
+            ChannelSymbols symbolsToSubscribe, symbolsToUnsubscribe;
+            for (std::size_t i = 0; i < desired.size(); ++i) {
+                symbolsToSubscribe[i] = symbols_difference(desired[i], subscribed[i]);
+                symbolsToUnsubscribe[i] = symbols_difference(subscribed[i], desired[i]);
+            }
+
+            try {
+                write_subscription_message(ws, writeMutex, "subscribe", symbolsToSubscribe);
+                write_subscription_message(ws, writeMutex, "unsubscribe", symbolsToUnsubscribe);
+                subscribedSymbols = desiredSymbols;
+            } catch (const std::exception &e) {
+                std::cerr << "Subscription error on feed connection " << index << ": "
+                          << e.what() << "\n";
+                subscriptionsRunning.store(false);
+                subscriptionCv.notify_all();
+                return;
+            }
+        }
+    });
+
+    subscriptionCv.notify_all();
+
+    auto stop_subscription_thread = [&] {
+        subscriptionsRunning.store(false);
         subscriptionCv.notify_all();
+        if (subscriptionThread.joinable())
+            subscriptionThread.join();
+    };
 
-        auto stop_subscription_thread = [&] {
-            subscriptionsRunning.store(false);
-            subscriptionCv.notify_all();
-            if (subscriptionThread.joinable())
-                subscriptionThread.join();
-        };
+    // keep reading updates forever
 
-        // keep reading updates forever
+    std::vector<EpisodeTransition> transitions;
+    std::vector<double> thresholds; // one per profile, reused by every evaluation
 
-        try {
-            for (;;) {
-                // read next message from the stream
-                ws.read(buffer);
+    // one flat batch reused across reads, events are trivially copyable
+    std::vector<MarketEvent> events;
+    events.reserve(1024);
+    std::unordered_set<SymbolId> changed;
+    std::int64_t lastExpireNs = 0;
+    QuoteConflator::Stage conflation(quoteConflator);
 
-                // Convert to string
-                std::string message = beast::buffers_to_string(buffer.data());
-                buffer.consume(buffer.size());
+    // reader-side copy of the detector masks and priorities, refreshed only when the tracked
+    // set changes; priorities are by id, symbols interned since the refresh count as normal
+    std::unordered_map<std::string, std::uint32_t> detectorMasks;
+    std::vector<SymbolPriority> priorities;
+    std::uint64_t seenGeneration = ~std::uint64_t{0};
+    auto priority_of = [&](SymbolId id) {
+        return id < priorities.size() ? priorities[id] : SymbolPriority::Normal;
+    };
 
-                auto events = parseMessage(message);
+    conn.lag.reset();
 
-                {
-                    std::lock_guard<std::mutex> lock(stateMutex);
-                    updateState(bySymbol, events);
+    try {
+        for (;;) {
+            // one scope per message, moved on as the message goes through the stages
+            AllocScope stage(AllocStage::Read);
+
+            // read next message from the stream
+            ws.read(buffer);
+            conn.messages.fetch_add(1, std::memory_order_relaxed);
+
+            // Convert to string
+            std::string message = beast::buffers_to_string(buffer.data());
+            buffer.consume(buffer.size());
+
+            stage.enter(AllocStage::Parse);
+            events.clear();
+            parseMessage(message, events);
+
+            stage.enter(AllocStage::Shed);
+
+            // how far behind the exchange this batch is decides how much of it we can afford
+            const ShedLevel shed = conn.lag.observe(events, wallClockNs());
+
+            // bytes still queued in the kernel tell us whether we are behind the feed
+            std::size_t backlog = 0;
+            if (quoteConflator.enabled()) {
+                beast::error_code ec;
+                backlog = beast::get_lowest_layer(ws).available(ec);
+                if (ec)
+                    backlog = 0;
+            }
+            conflation.process(events, backlog, shed >= ShedLevel::Conflate);
+
+            // new ids also refresh, a symbol is usually interned after it was tracked
+            if (const auto generation = subscriptionGeneration.load(std::memory_order_acquire);
+                generation != seenGeneration || symbolCount() != priorities.size()) {
+                std::lock_guard lock(subscriptionMutex);
+                detectorMasks.clear();
+                priorities.assign(symbolCount(), SymbolPriority::Normal);
+                for (const auto &[symbol, subscription] : trackedSymbols) {
+                    detectorMasks.emplace(symbol, subscription.detectors);
+                    if (const SymbolId id = findSymbol(symbol); id < priorities.size())
+                        priorities[id] = subscription.priority;
+                }
+                seenGeneration = generation;
+            }
 
-                    std::unordered_set<std::string> changed;
-                    changed.reserve(events.size());
-                    for (const auto &ev : events)
-                        changed.insert(ev.symbol);
+            // last resort: only high-priority symbols keep their quotes
+            if (shed >= ShedLevel::DropQuotes) {
+                const std::size_t before = events.size();
+                std::erase_if(events, [&](const MarketEvent &ev) {
+                    return ev.type == MarketEventType::Quote &&
+                           priority_of(ev.symbol) != SymbolPriority::High;
+                });
+                conn.lag.countDroppedQuotes(before - events.size());
+            }
 
-                    for (const auto &symbol : changed) {
-                        if (auto a = detectPriceAnomaly(symbol, bySymbol, 2.0)) {
-                            record_anomaly(*a);
-                        }
-                        if (auto a = detectSpreadAnomaly(symbol, bySymbol, 2.0)) {
-                            record_anomaly(*a);
+            {
+                std::lock_guard lock(stateMutex);
+                stage.enter(AllocStage::Update);
+                updateState(bySymbol, events);
+
+                // trade prints and bar closes feed the cross-symbol return grid
+                for (const auto &ev : events) {
+                    if (ev.type == MarketEventType::Trade)
+                        correlationEngine.observe(std::string(ev.symbolName()), ev.ts_ns,
+                                                  ev.trade.price);
+                    else if (ev.type == MarketEventType::Bar)
+                        correlationEngine.observe(std::string(ev.symbolName()), ev.ts_ns,
+                                                  ev.bar.close);
+                }
+                stage.enter(AllocStage::Detect);
+                sync_profiles(transitions);
+                const std::size_t profileCount = profileEpisodes.size();
+
+                // market and sector moves are scored by the correlation engine; a profile keeps
+                // one only if it runs that detector, the move clears its own threshold and the
+                // engine has seen enough buckets, the same gating the per-symbol detectors get
+                for (auto &a : correlationEngine.takeAnomalies()) {
+                    for (auto &[profile, episodes] : profileEpisodes) {
+                        if (!profile.runs(a.type))
+                            continue;
+                        std::optional<Anomaly> kept;
+                        if (std::abs(a.zscore) > episodes.threshold(a.symbol, a.type, profile.k) &&
+                            a.points >= profile.minPoints) {
+                            kept = a;
+                            kept->profile = profile.name;
                         }
-                        if (auto a = detectVolumeAnomaly(symbol, bySymbol, 2.0)) {
-                            record_anomaly(*a);
+                        episodes.observe(a.symbol, a.type, profile.k, std::move(kept), a.ts_ns,
+                                         transitions);
+                    }
+                }
+
+                changed.clear();
+                std::int64_t latestNs = 0;
+                for (const auto &ev : events) {
+                    changed.insert(ev.symbol);
+                    latestNs = std::max(latestNs, ev.ts_ns);
+                }
+
+                // detectors run at the exit band while an episode is open (hysteresis)
+                // symbols still in flight after an untrack keep every detector
+                //
+                // each detector runs once per symbol, at the loosest threshold of any profile
+                // that has it on; every profile then keeps the reading only if it clears its
+                // own threshold and has enough baseline points. a detector whose source (last
+                // trade, quote or bar) has not moved since it was scored is not run at all
+                auto evaluate = [&](const std::string &symbol, AnomalyType type, auto detect) {
+                    const auto mask = detectorMasks.find(symbol);
+                    if (mask != detectorMasks.end() && !(mask->second & detectorBit(type)))
+                        return;
+
+                    const std::int64_t sourceNs = detectorSourceNs(type, bySymbol.at(symbol));
+                    constexpr double OFF = std::numeric_limits<double>::infinity();
+                    thresholds.assign(profileCount, OFF);
+                    double loosest = OFF;
+                    for (std::size_t i = 0; i < profileCount; ++i) {
+                        const auto &[profile, episodes] = profileEpisodes[i];
+                        if (profile.runs(type) && episodes.fresh(symbol, type, sourceNs))
+                            thresholds[i] = episodes.threshold(symbol, type, profile.k);
+                        loosest = std::min(loosest, thresholds[i]);
+                    }
+                    if (loosest == OFF)
+                        return;
+
+                    std::optional<Anomaly> reading = detect(symbol, bySymbol, loosest);
+                    for (std::size_t i = 0; i < profileCount; ++i) {
+                        if (thresholds[i] == OFF)
+                            continue;
+                        auto &[profile, episodes] = profileEpisodes[i];
+                        std::optional<Anomaly> kept;
+                        if (reading && std::abs(reading->zscore) > thresholds[i] &&
+                            reading->points >= profile.minPoints) {
+                            kept = *reading;
+                            kept->profile = profile.name;
                         }
+                        episodes.observe(symbol, type, profile.k, std::move(kept), sourceNs,
+                                         transitions);
                     }
+                };
+
+                // the in-process board for the API and the shared memory copy for local readers
+                auto publish_stats = [&](SymbolId id, const std::string &symbol) {
+                    const SymbolStats stats = summarizeState(symbol, bySymbol.at(symbol));
+                    statsBoard.publish(id, stats);
+                    shmPublisher.publishStats(id, stats);
+                };
+
+                std::uint64_t skipped = 0;
+                for (const SymbolId id : changed) {
+                    const std::string symbol(symbolName(id));
+
+                    // low-priority symbols keep their state and stats but skip detection
+                    if (shed >= ShedLevel::SkipDetectors &&
+                        priority_of(id) == SymbolPriority::Low) {
+                        ++skipped;
+                        stage.enter(AllocStage::Publish);
+                        publish_stats(id, symbol);
+                        continue;
+                    }
+
+                    stage.enter(AllocStage::Detect);
+
+                    evaluate(symbol, AnomalyType::Price, detectPriceAnomaly);
+                    evaluate(symbol, AnomalyType::Spread, detectSpreadAnomaly);
+                    evaluate(symbol, AnomalyType::Volume, detectVolumeAnomaly);
+                    evaluate(symbol, AnomalyType::Volatility, detectVolatilityAnomaly);
+                    evaluate(symbol, AnomalyType::Range, detectRangeAnomaly);
+                    evaluate(symbol, AnomalyType::Gap, detectGapAnomaly);
+                    evaluate(symbol, AnomalyType::Liquidity, detectLiquidityAnomaly);
+                    evaluate(symbol, AnomalyType::TradeSize, detectTradeSizeAnomaly);
+                    evaluate(symbol, AnomalyType::TradeFlow, detectTradeFlowAnomaly);
+                    evaluate(symbol, AnomalyType::Vwap, detectVwapAnomaly);
+
+                    stage.enter(AllocStage::Publish);
+                    publish_stats(id, symbol);
                 }
+                if (skipped > 0)
+                    conn.lag.countSkippedDetectors(skipped);
+
+                // idle episodes are swept at most once per second of feed time
+                stage.enter(AllocStage::Detect);
+                if (latestNs - lastExpireNs >= 1'000'000'000LL) {
+                    for (auto &tracked : profileEpisodes)
+                        tracked.episodes.expire(latestNs, transitions);
+                    lastExpireNs = latestNs;
+                }
+
+                stage.enter(AllocStage::Publish);
+                record_anomalies(transitions);
             }
+        }
+    } catch (...) {
+        conn.connected.store(false);
+        stop_subscription_thread();
+        throw;
+    }
+}
+
+template <typename WebSocket> static void remember_socket(std::size_t index, WebSocket &ws) {
+    std::lock_guard<std::mutex> lock(feedSlots[index].fdMutex);
+    feedSlots[index].fd = beast::get_lowest_layer(ws).native_handle();
+}
+
+static void forget_socket(std::size_t index) {
+    std::lock_guard<std::mutex> lock(feedSlots[index].fdMutex);
+    feedSlots[index].fd = -1;
+}
+
+template <typename Socket>
+static void run_connection(std::size_t index, const FeedEndpoint &endpoint,
+                           const std::string &key, const std::string &secret) {
+    // object that runs all network work for this connection
+    net::io_context ioc;
+
+    // This object helps find the server address to connect to
+    tcp::resolver resolver{ioc};
+    auto const results = resolver.resolve(endpoint.host, endpoint.port);
+
+    if (!endpoint.tls) {
+        // plain websocket, only meant for a local stand-in server
+        websocket::stream<Socket> ws{ioc};
+        net::connect(ws.next_layer(), results.begin(), results.end());
+        start_polling(ws.next_layer());
+        remember_socket(index, ws);
+        try {
+            ws.handshake(endpoint.host, endpoint.target);
+            run_session(ws, index, key, secret);
         } catch (...) {
-            stop_subscription_thread();
+            forget_socket(index);
             throw;
         }
+        return;
+    }
+
+    // object holds the rules for making a secure connection as a client
+    ssl::context ctx{ssl::context::tls_client};
+
+    // This tells the program to trust the normal certificate list on the computer
+    ctx.set_default_verify_paths();
+
+    // This tells the program to check the server identity before sending secrets
+    ctx.set_verify_mode(ssl::verify_peer);
+
+    // create socket
+    websocket::stream<beast::ssl_stream<Socket>> ws{ioc, ctx};
+
+    // connect TCP first so the SSL handshake has a valid socket
+    net::connect(ws.next_layer().next_layer(), results.begin(), results.end());
+    start_polling(ws.next_layer().next_layer());
+    remember_socket(index, ws);
+
+    try {
+        // This sets the server name so the secure connection is made to the right site.
+        if (!SSL_set_tlsext_host_name(ws.next_layer().native_handle(), endpoint.host.c_str())) {
+            // This builds an error code if setting the server name fails.
+            beast::error_code ec{static_cast<int>(::ERR_get_error()),
+                                 net::error::get_ssl_category()};
+            // This stops with a readable error.
+            throw beast::system_error{ec};
+        }
+
+        // start TLS handshake with server
+        ws.next_layer().handshake(ssl::stream_base::client);
+
+        // start the WebSocket session on top of the encrypted connection
+        ws.handshake(endpoint.host, endpoint.target);
+
+        run_session(ws, index, key, secret);
+    } catch (...) {
+        forget_socket(index);
+        throw;
+    }
+}
+
+int run_socket() {
+    std::string key, secret;
+    FeedEndpoint endpoint;
+    try {
+        key = getenv_or_throw("APCA_API_KEY_ID");
+        secret = getenv_or_throw("APCA_API_SECRET_KEY");
+        endpoint = feed_endpoint();
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << "\n";
         return 1;
     }
+
+    // Alpaca limits connections per account, so more than one needs a plan that allows it
+    const std::size_t count = std::clamp<std::size_t>(
+        std::strtoul(getenv_or("SAR_FEED_CONNECTIONS", "1").c_str(), nullptr, 10), 1,
+        MAX_FEED_CONNECTIONS);
+    {
+        std::lock_guard lock(subscriptionMutex);
+        partitioner.emplace(count);
+        partitionedGeneration = ~std::uint64_t{0};
+    }
+    feedSlotCount.store(count);
+
+    std::cout << "Feed: " << count << " connection(s) to " << (endpoint.tls ? "wss://" : "ws://")
+              << endpoint.host << ":" << endpoint.port << endpoint.target << "\n";
+
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        threads.emplace_back([&, i] {
+            enterThreadRole(ThreadRole::Reader, i);
+            try {
+                if (runtimeStatus().busyPoll)
+                    run_connection<BusyPollSocket>(i, endpoint, key, secret);
+                else
+                    run_connection<tcp::socket>(i, endpoint, key, secret);
+            } catch (const std::exception &e) {
+                std::cerr << "Error on feed connection " << i << ": " << e.what() << "\n";
+            }
+            stop_all_connections();
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    {
+        // nothing can extend them once the feed is gone
+        std::lock_guard lock(stateMutex);
+        close_open_episodes();
+    }
+    return 1;
 }
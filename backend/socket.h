@@ -11,10 +11,28 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "anomaly_detector.h"
 #include "data_parser.h"
+#include "episode_tracker.h"
+#include "feed_lag.h"
 #include "shared_state.h"
 #include <mutex>
 
-int run_socket();
\ No newline at end of file
+struct FeedConnectionInfo {
+    std::size_t index = 0;
+    bool connected = false;
+    std::size_t symbols = 0;
+    std::uint64_t messages = 0;
+    FeedLagStats lag;
+};
+
+// runs SAR_FEED_CONNECTIONS feed connections until one of them fails
+int run_socket();
+
+// safe to call from any thread
+std::vector<FeedConnectionInfo> feedConnections();
+
+// closes and records every open anomaly episode, caller must hold stateMutex
+void close_open_episodes();
\ No newline at end of file
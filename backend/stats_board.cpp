@@ -0,0 +1,201 @@
+#include "stats_board.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+// mean and population stdev in one pass, same convention as calcSTDEV
+template <typename Range> static void mean_stdev(const Range &values, double &mean, double &stdev) {
+    mean = 0.0;
+    stdev = 0.0;
+    if (values.empty())
+        return;
+
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (auto v : values) {
+        const double x = static_cast<double>(v);
+        sum += x;
+        sumSq += x * x;
+    }
+    const double n = static_cast<double>(values.size());
+    mean = sum / n;
+    stdev = std::sqrt(std::max(0.0, sumSq / n - mean * mean));
+}
+
+SymbolStats summarizeState(std::string_view symbol, const SymbolState &state,
+                           std::size_t windowN) {
+    SymbolStats stats{};
+    std::memcpy(stats.symbol, symbol.data(), std::min(symbol.size(), sizeof(stats.symbol) - 1));
+    stats.updated_ns = state.lastEventNs;
+
+    if (state.lastTrade) {
+        stats.trade_price = state.lastTrade->price;
+        stats.trade_size = state.lastTrade->size;
+        stats.trade_ns = state.lastTradeNs;
+    }
+    if (state.lastQuote) {
+        stats.bid_price = state.lastQuote->bid_price;
+        stats.ask_price = state.lastQuote->ask_price;
+        stats.quote_ns = state.lastQuoteNs;
+    }
+    if (!state.spreads.empty())
+        stats.spread = state.spreads.back();
+    if (state.lastBar) {
+        stats.bar_close = state.lastBar->close;
+        stats.bar_volume = state.lastBar->volume;
+        stats.bar_ns = state.lastBarNs;
+    }
+
+    mean_stdev(state.prices, stats.price_mean, stats.price_stdev);
+    mean_stdev(state.spreads, stats.spread_mean, stats.spread_stdev);
+    mean_stdev(state.barVolumes, stats.volume_mean, stats.volume_stdev);
+
+    const QuantileSketch &sizes = state.tradeSizeQuantiles;
+    const QuantileSketch &spreads = state.spreadQuantiles;
+    if (!sizes.empty()) {
+        stats.trade_size_p50 = sizes.quantile(0.5);
+        stats.trade_size_p90 = sizes.quantile(0.9);
+        stats.trade_size_p99 = sizes.quantile(0.99);
+        stats.trade_size_p999 = sizes.quantile(0.999);
+        stats.trade_size_count = sizes.count();
+    }
+    if (!spreads.empty()) {
+        stats.spread_p50 = spreads.quantile(0.5);
+        stats.spread_p99 = spreads.quantile(0.99);
+        stats.spread_count = spreads.count();
+    }
+
+    const SessionVwap &session = state.vwap;
+    stats.vwap = session.value();
+    stats.bar_vwap = session.barValue();
+    stats.vwap_volume = session.volume;
+    stats.session_start_ns = session.session.startNs;
+
+    stats.price_points = static_cast<std::uint32_t>(state.prices.size());
+    stats.spread_points = static_cast<std::uint32_t>(state.spreads.size());
+    stats.volume_points = static_cast<std::uint32_t>(state.barVolumes.size());
+    stats.window_size = static_cast<std::uint32_t>(windowN);
+    return stats;
+}
+
+static std::string ts_or_empty(std::int64_t ns) { return ns > 0 ? formatTimestampNs(ns) : ""; }
+
+nlohmann::json statsJson(const SymbolStats &s, const FieldSet &fields) {
+    nlohmann::json out = nlohmann::json::object();
+    putField(out, fields, "symbol", std::string(s.symbol, strnlen(s.symbol, sizeof(s.symbol))));
+    if (fields.empty() || fields.contains("updatedTs"))
+        out["updatedTs"] = ts_or_empty(s.updated_ns);
+    putField(out, fields, "updates", s.updates);
+
+    if (fields.empty() || fields.contains("lastTrade")) {
+        out["lastTrade"] = s.trade_ns > 0 ? nlohmann::json{{"price", s.trade_price},
+                                                           {"size", s.trade_size},
+                                                           {"ts", formatTimestampNs(s.trade_ns)}}
+                                          : nlohmann::json(nullptr);
+    }
+    if (fields.empty() || fields.contains("lastQuote")) {
+        out["lastQuote"] = s.quote_ns > 0 ? nlohmann::json{{"bid", s.bid_price},
+                                                           {"ask", s.ask_price},
+                                                           {"ts", formatTimestampNs(s.quote_ns)}}
+                                          : nlohmann::json(nullptr);
+    }
+    putField(out, fields, "lastSpread", s.spread);
+    if (fields.empty() || fields.contains("lastBar")) {
+        out["lastBar"] = s.bar_ns > 0 ? nlohmann::json{{"close", s.bar_close},
+                                                       {"volume", s.bar_volume},
+                                                       {"ts", formatTimestampNs(s.bar_ns)}}
+                                      : nlohmann::json(nullptr);
+    }
+
+    putField(out, fields, "price",
+             nlohmann::json{{"mean", s.price_mean},
+                            {"stdev", s.price_stdev},
+                            {"points", s.price_points}});
+    putField(out, fields, "spread",
+             nlohmann::json{{"mean", s.spread_mean},
+                            {"stdev", s.spread_stdev},
+                            {"points", s.spread_points}});
+    putField(out, fields, "volume",
+             nlohmann::json{{"mean", s.volume_mean},
+                            {"stdev", s.volume_stdev},
+                            {"points", s.volume_points}});
+    putField(out, fields, "windowSize", s.window_size);
+
+    putField(out, fields, "tradeSizeQuantiles",
+             nlohmann::json{{"p50", s.trade_size_p50},
+                            {"p90", s.trade_size_p90},
+                            {"p99", s.trade_size_p99},
+                            {"p99.9", s.trade_size_p999},
+                            {"count", s.trade_size_count}});
+    putField(out, fields, "spreadQuantiles",
+             nlohmann::json{{"p50", s.spread_p50},
+                            {"p99", s.spread_p99},
+                            {"count", s.spread_count}});
+    if (fields.empty() || fields.contains("vwap")) {
+        out["vwap"] = s.session_start_ns > 0
+                          ? nlohmann::json{{"trades", s.vwap},
+                                           {"bars", s.bar_vwap},
+                                           {"volume", s.vwap_volume},
+                                           {"sessionStart", formatTimestampNs(s.session_start_ns)}}
+                          : nlohmann::json(nullptr);
+    }
+    return out;
+}
+
+StatsBoard::StatsBoard() : blocks(new std::atomic<StatBlock *>[MAX_SYMBOLS]) {
+    for (std::size_t i = 0; i < MAX_SYMBOLS; ++i)
+        blocks[i].store(nullptr, std::memory_order_relaxed);
+}
+
+StatsBoard::~StatsBoard() {
+    for (std::size_t i = 0; i < MAX_SYMBOLS; ++i)
+        delete blocks[i].load(std::memory_order_relaxed);
+    for (StatBlock *block : spare)
+        delete block;
+}
+
+void StatsBoard::reserve(std::size_t count) {
+    count = std::min(count, MAX_SYMBOLS);
+    while (spare.size() < count)
+        spare.push_back(new StatBlock);
+}
+
+void StatsBoard::publish(SymbolId id, const SymbolStats &stats) {
+    if (id >= MAX_SYMBOLS)
+        return;
+
+    StatBlock *block = blocks[id].load(std::memory_order_relaxed);
+    if (!block) {
+        // filled before readers can see the pointer
+        if (spare.empty()) {
+            block = new StatBlock;
+        } else {
+            block = spare.back();
+            spare.pop_back();
+        }
+        block->publish(stats);
+        blocks[id].store(block, std::memory_order_release);
+        return;
+    }
+    block->publish(stats);
+}
+
+bool StatsBoard::read(SymbolId id, SymbolStats &out) const {
+    if (id >= MAX_SYMBOLS)
+        return false;
+    const StatBlock *block = blocks[id].load(std::memory_order_acquire);
+    return block && block->read(out);
+}
+
+std::vector<SymbolStats> StatsBoard::readAll() const {
+    std::vector<SymbolStats> out;
+    const std::size_t count = std::min(symbolCount(), MAX_SYMBOLS);
+    SymbolStats stats;
+    for (std::size_t id = 0; id < count; ++id) {
+        if (read(static_cast<SymbolId>(id), stats))
+            out.push_back(stats);
+    }
+    return out;
+}
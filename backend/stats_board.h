@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "data_parser.h"
+#include "symbol_table.h"
+#include "wire_format.h"
+
+/*
+
+Live per-symbol statistics that can be read without stateMutex.
+
+After every batch the feed reader summarizes each symbol it touched into a SymbolStats and
+publishes it into that symbol's StatBlock. A block is a seqlock: the writer bumps the sequence
+to odd, stores the words, then bumps it back to even; a reader copies the words and retries if
+the sequence was odd or moved underneath it. Readers never write anything, so any number of
+API requests cost the feed nothing beyond the cache lines they pull.
+
+Blocks are indexed by SymbolId and allocated the first time a symbol is published. They live as
+long as the process (ids are never reused either), which is what lets readers skip any lock.
+
+Writers are serialized by stateMutex, so each block has a single writer at a time.
+
+*/
+
+// fixed layout, every field is 8 bytes apart from the trailing counts
+struct SymbolStats {
+    char symbol[16]; // NUL padded
+    std::int64_t updated_ns; // newest event folded in
+    std::uint64_t updates;   // times this block was published, stamped by StatBlock
+
+    double trade_price;
+    std::int64_t trade_size;
+    std::int64_t trade_ns;
+
+    double bid_price;
+    double ask_price;
+    double spread; // last observed, conflated quotes report their time-weighted spread
+    std::int64_t quote_ns;
+
+    double bar_close;
+    std::int64_t bar_volume;
+    std::int64_t bar_ns;
+
+    double price_mean; // baselines over the count windows the detectors use
+    double price_stdev;
+    double spread_mean;
+    double spread_stdev;
+    double volume_mean;
+    double volume_stdev;
+
+    double trade_size_p50; // long-horizon sketches, see QuantileSketch
+    double trade_size_p90;
+    double trade_size_p99;
+    double trade_size_p999;
+    double spread_p50;
+    double spread_p99;
+    double trade_size_count; // weight in each sketch
+    double spread_count;
+
+    double vwap;        // session VWAP from trades, see SessionVwap
+    double bar_vwap;    // the same from the bars' vw, a cross-check on the trade figure
+    double vwap_volume; // shares behind vwap
+    std::int64_t session_start_ns;
+
+    std::uint32_t price_points; // window fill, out of window_size
+    std::uint32_t spread_points;
+    std::uint32_t volume_points;
+    std::uint32_t window_size;
+};
+
+static_assert(std::is_trivially_copyable_v<SymbolStats>);
+static_assert(sizeof(SymbolStats) % sizeof(std::uint64_t) == 0);
+
+SymbolStats summarizeState(std::string_view symbol, const SymbolState &state,
+                           std::size_t windowN = DEFAULT_WINDOW);
+
+nlohmann::json statsJson(const SymbolStats &stats, const FieldSet &fields);
+
+// also laid out in the shared memory region, see shm_layout.h
+class alignas(64) StatBlock {
+  public:
+    void publish(const SymbolStats &stats);
+
+    // false until the first publish
+    bool read(SymbolStats &out) const;
+
+  private:
+    static constexpr std::size_t WORDS = sizeof(SymbolStats) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> sequence{0};
+    std::atomic<std::uint64_t> words[WORDS]{};
+};
+
+inline void StatBlock::publish(const SymbolStats &stats) {
+    std::uint64_t raw[WORDS];
+    std::memcpy(raw, &stats, sizeof(raw));
+
+    // the single writer is the only one that reads its own count back, it cannot tear
+    constexpr std::size_t UPDATES = offsetof(SymbolStats, updates) / sizeof(std::uint64_t);
+    raw[UPDATES] = words[UPDATES].load(std::memory_order_relaxed) + 1;
+
+    // odd while the words are in flux; the release fence keeps the stores after the bump
+    const std::uint64_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < WORDS; ++i)
+        words[i].store(raw[i], std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+inline bool StatBlock::read(SymbolStats &out) const {
+    std::uint64_t raw[WORDS];
+    for (;;) {
+        const std::uint64_t before = sequence.load(std::memory_order_acquire);
+        if (before == 0)
+            return false;
+        if (before & 1)
+            continue;
+
+        for (std::size_t i = 0; i < WORDS; ++i)
+            raw[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (sequence.load(std::memory_order_relaxed) == before)
+            break;
+    }
+    std::memcpy(&out, raw, sizeof(out));
+    return true;
+}
+
+class StatsBoard {
+  public:
+    StatsBoard();
+    ~StatsBoard();
+
+    StatsBoard(const StatsBoard &) = delete;
+    StatsBoard &operator=(const StatsBoard &) = delete;
+
+    // allocates blocks for count symbols up front so publish never allocates, call it before
+    // the feed starts
+    void reserve(std::size_t count);
+
+    // caller holds stateMutex
+    void publish(SymbolId id, const SymbolStats &stats);
+
+    // lock free, any thread
+    bool read(SymbolId id, SymbolStats &out) const;
+    std::vector<SymbolStats> readAll() const;
+
+  private:
+    std::unique_ptr<std::atomic<StatBlock *>[]> blocks;
+    std::vector<StatBlock *> spare; // from reserve, handed out by publish under stateMutex
+};
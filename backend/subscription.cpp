@@ -0,0 +1,118 @@
+#include "subscription.h"
+
+namespace {
+
+constexpr AnomalyType SYMBOL_DETECTORS[] = {
+    AnomalyType::Price, AnomalyType::Volume, AnomalyType::Spread, AnomalyType::Volatility,
+    AnomalyType::Range, AnomalyType::Gap,    AnomalyType::Liquidity, AnomalyType::TradeSize,
+    AnomalyType::TradeFlow, AnomalyType::Vwap,
+};
+
+} // namespace
+
+std::string_view channelName(SubscriptionChannel channel) {
+    switch (channel) {
+    case CHANNEL_TRADES:
+        return "trades";
+    case CHANNEL_QUOTES:
+        return "quotes";
+    case CHANNEL_BARS:
+        return "bars";
+    }
+    return "";
+}
+
+std::optional<SubscriptionChannel> parseChannel(std::string_view name) {
+    for (auto channel : SUBSCRIPTION_CHANNELS) {
+        if (channelName(channel) == name)
+            return channel;
+    }
+    return std::nullopt;
+}
+
+std::string_view detectorName(AnomalyType type) {
+    switch (type) {
+    case AnomalyType::Price:
+        return "price";
+    case AnomalyType::Volume:
+        return "volume";
+    case AnomalyType::Spread:
+        return "spread";
+    case AnomalyType::Volatility:
+        return "volatility";
+    case AnomalyType::Range:
+        return "range";
+    case AnomalyType::Gap:
+        return "gap";
+    case AnomalyType::Liquidity:
+        return "liquidity";
+    case AnomalyType::TradeSize:
+        return "tradeSize";
+    case AnomalyType::TradeFlow:
+        return "tradeFlow";
+    case AnomalyType::Vwap:
+        return "vwap";
+    case AnomalyType::Market:
+        return "market";
+    case AnomalyType::Sector:
+        return "sector";
+    default:
+        return "";
+    }
+}
+
+std::optional<AnomalyType> parseDetector(std::string_view name) {
+    for (auto type : SYMBOL_DETECTORS) {
+        if (detectorName(type) == name)
+            return type;
+    }
+    return std::nullopt;
+}
+
+std::string_view priorityName(SymbolPriority priority) {
+    switch (priority) {
+    case SymbolPriority::Low:
+        return "low";
+    case SymbolPriority::Normal:
+        return "normal";
+    case SymbolPriority::High:
+        return "high";
+    }
+    return "";
+}
+
+std::optional<SymbolPriority> parsePriority(std::string_view name) {
+    for (auto priority : {SymbolPriority::Low, SymbolPriority::Normal, SymbolPriority::High}) {
+        if (priorityName(priority) == name)
+            return priority;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> channelNames(std::uint8_t channels) {
+    std::vector<std::string> out;
+    for (auto channel : SUBSCRIPTION_CHANNELS) {
+        if (channels & channel)
+            out.emplace_back(channelName(channel));
+    }
+    return out;
+}
+
+std::vector<std::string> detectorNames(std::uint32_t detectors) {
+    std::vector<std::string> out;
+    for (auto type : SYMBOL_DETECTORS) {
+        if (detectors & detectorBit(type))
+            out.emplace_back(detectorName(type));
+    }
+    return out;
+}
+
+std::unordered_set<std::string> symbolsOnChannel(const SubscriptionMap &subscriptions,
+                                                 SubscriptionChannel channel) {
+    std::unordered_set<std::string> out;
+    for (const auto &[symbol, subscription] : subscriptions) {
+        if (subscription.has(channel))
+            out.insert(symbol);
+    }
+    return out;
+}
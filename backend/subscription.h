@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "anomaly_detector.h"
+
+/*
+
+What each tracked symbol is subscribed to.
+
+Every symbol used to get trades, quotes and bars plus every detector. A symbol that only needs
+minute bars was still paying for the full quote stream. Each tracked symbol now carries a
+channel mask (which Alpaca streams to subscribe) and a detector mask (bit i = AnomalyType i).
+
+PUT /api/tickers/tracked accepts either plain symbols (everything on, as before) or objects:
+
+    ["AAPL", {"symbol": "SPY", "channels": ["bars"], "detectors": ["volume", "range"]}]
+
+An object may also set "priority" to "low", "normal" (the default) or "high". Priority only
+matters when the feed falls behind and sheds load (feed_lag.h): low-priority symbols lose
+their detectors first, and only high-priority symbols keep their quotes at the last stage.
+
+*/
+
+enum SubscriptionChannel : std::uint8_t {
+    CHANNEL_TRADES = 1 << 0,
+    CHANNEL_QUOTES = 1 << 1,
+    CHANNEL_BARS = 1 << 2,
+};
+
+constexpr std::uint8_t ALL_CHANNELS = CHANNEL_TRADES | CHANNEL_QUOTES | CHANNEL_BARS;
+
+constexpr std::uint32_t detectorBit(AnomalyType type) {
+    return 1u << static_cast<unsigned>(type);
+}
+
+// the per-symbol detectors; market and sector moves come from the correlation engine
+constexpr std::uint32_t ALL_DETECTORS =
+    detectorBit(AnomalyType::Price) | detectorBit(AnomalyType::Volume) |
+    detectorBit(AnomalyType::Spread) | detectorBit(AnomalyType::Volatility) |
+    detectorBit(AnomalyType::Range) | detectorBit(AnomalyType::Gap) |
+    detectorBit(AnomalyType::Liquidity) | detectorBit(AnomalyType::TradeSize) |
+    detectorBit(AnomalyType::TradeFlow) | detectorBit(AnomalyType::Vwap);
+
+enum class SymbolPriority : std::uint8_t { Low, Normal, High };
+
+struct Subscription {
+    std::uint8_t channels = ALL_CHANNELS;
+    std::uint32_t detectors = ALL_DETECTORS;
+    SymbolPriority priority = SymbolPriority::Normal;
+
+    bool has(SubscriptionChannel channel) const { return (channels & channel) != 0; }
+    bool runs(AnomalyType type) const { return (detectors & detectorBit(type)) != 0; }
+
+    bool operator==(const Subscription &) const = default;
+};
+
+using SubscriptionMap = std::unordered_map<std::string, Subscription>;
+
+// Alpaca stream names, in the order subscription messages list them
+constexpr SubscriptionChannel SUBSCRIPTION_CHANNELS[] = {CHANNEL_TRADES, CHANNEL_QUOTES,
+                                                         CHANNEL_BARS};
+
+std::string_view channelName(SubscriptionChannel channel);
+std::optional<SubscriptionChannel> parseChannel(std::string_view name);
+
+// "price", "volume", ... for the detectors in ALL_DETECTORS
+std::string_view detectorName(AnomalyType type);
+std::optional<AnomalyType> parseDetector(std::string_view name);
+
+std::string_view priorityName(SymbolPriority priority);
+std::optional<SymbolPriority> parsePriority(std::string_view name);
+
+std::vector<std::string> channelNames(std::uint8_t channels);
+std::vector<std::string> detectorNames(std::uint32_t detectors);
+
+// symbols whose mask includes channel
+std::unordered_set<std::string> symbolsOnChannel(const SubscriptionMap &subscriptions,
+                                                 SubscriptionChannel channel);
@@ -0,0 +1,212 @@
+#include "symbol_lifecycle.h"
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <tuple>
+
+#include "shared_state.h"
+#include "snapshot.h"
+
+namespace {
+
+// libstdc++ deques hold 512-byte nodes plus a pointer map
+template <typename T> std::size_t deque_bytes(const std::deque<T> &dq) {
+    constexpr std::size_t NODE_BYTES = 512;
+    const std::size_t nodes = dq.size() * sizeof(T) / NODE_BYTES + 1;
+    return nodes * NODE_BYTES + (nodes + 8) * sizeof(void *);
+}
+
+std::size_t string_bytes(const std::string &s) {
+    // short strings live inside the object
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+std::size_t volatility_bytes(const ReturnVolatility &vol) {
+    return deque_bytes(vol.shortReturns.values) + deque_bytes(vol.longReturns.values);
+}
+
+std::filesystem::path cold_path(const std::filesystem::path &dir, const std::string &symbol) {
+    return dir / (symbol + ".state");
+}
+
+} // namespace
+
+std::size_t symbolMemoryBytes(const std::string &symbol, const SymbolState &state) {
+    // map node: key, value and the bucket pointer
+    std::size_t bytes = sizeof(std::string) + sizeof(SymbolState) + 2 * sizeof(void *);
+    bytes += string_bytes(symbol);
+
+    bytes += deque_bytes(state.prices) + deque_bytes(state.barVolumes) +
+             deque_bytes(state.tradeSizes) + deque_bytes(state.spreads);
+    bytes += volatility_bytes(state.tradeVolatility) + volatility_bytes(state.barVolatility);
+    bytes += deque_bytes(state.tradeFlow.signedSizes.values) +
+             deque_bytes(state.tradeFlow.sizes.values) +
+             deque_bytes(state.tradeFlow.imbalances.values);
+    bytes += deque_bytes(state.barRanges.values) + deque_bytes(state.barGaps.values) +
+             deque_bytes(state.quoteDepths.values);
+    bytes += state.series.allocatedBytes();
+    bytes += state.timedPrices.allocatedBytes() + state.timedSpreads.allocatedBytes() +
+             state.timedDepths.allocatedBytes();
+    bytes += state.tradeSizeQuantiles.allocatedBytes() + state.spreadQuantiles.allocatedBytes();
+    return bytes;
+}
+
+void SymbolLifecycle::configure(LifecycleConfig next) {
+    config = std::move(next);
+    if (!config.coldDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(config.coldDir, ec);
+    }
+}
+
+void SymbolLifecycle::drop(const std::string &symbol,
+                           std::vector<std::pair<std::string, std::string>> &cold) {
+    auto it = bySymbol.find(symbol);
+    if (it == bySymbol.end())
+        return;
+
+    if (!config.coldDir.empty()) {
+        std::unordered_map<std::string, SymbolState> one;
+        one.emplace(symbol, std::move(it->second));
+        cold.emplace_back(symbol, encodeSnapshot(one));
+    }
+
+    bySymbol.erase(it);
+    correlationEngine.remove(symbol);
+    untrackedSince.erase(symbol);
+}
+
+void SymbolLifecycle::tick() {
+    SubscriptionMap tracked;
+    {
+        std::lock_guard lock(subscriptionMutex);
+        tracked = trackedSymbols;
+    }
+
+    const auto now = Clock::now();
+    std::vector<std::pair<std::string, std::string>> cold;
+    {
+        std::lock_guard lock(stateMutex);
+
+        // start or cancel grace periods
+        for (auto it = untrackedSince.begin(); it != untrackedSince.end();) {
+            if (tracked.contains(it->first) || !bySymbol.contains(it->first))
+                it = untrackedSince.erase(it);
+            else
+                ++it;
+        }
+        for (const auto &[symbol, state] : bySymbol) {
+            if (!tracked.contains(symbol))
+                untrackedSince.try_emplace(symbol, now);
+        }
+
+        std::vector<std::string> expired;
+        for (const auto &[symbol, since] : untrackedSince) {
+            if (now - since >= config.reclaimGrace)
+                expired.push_back(symbol);
+        }
+        for (const auto &symbol : expired) {
+            drop(symbol, cold);
+            ++reclaimed;
+        }
+
+        if (config.memoryBudgetBytes > 0) {
+            std::size_t total = 0;
+            // tracked symbols count against the budget but are never evicted, the stalest
+            // untracked ones go first
+            std::vector<std::tuple<std::int64_t, std::size_t, std::string>> candidates;
+            candidates.reserve(bySymbol.size());
+            for (const auto &[symbol, state] : bySymbol) {
+                const std::size_t bytes = symbolMemoryBytes(symbol, state);
+                total += bytes;
+                if (!tracked.contains(symbol))
+                    candidates.emplace_back(state.lastEventNs, bytes, symbol);
+            }
+
+            if (total > config.memoryBudgetBytes) {
+                std::sort(candidates.begin(), candidates.end());
+                for (const auto &[lastEventNs, bytes, symbol] : candidates) {
+                    if (total <= config.memoryBudgetBytes)
+                        break;
+                    drop(symbol, cold);
+                    total -= bytes;
+                    ++evicted;
+                }
+            }
+        }
+    }
+
+    // file writes happen after the lock is gone
+    for (const auto &[symbol, encoded] : cold) {
+        try {
+            writeSnapshotFile(cold_path(config.coldDir, symbol), encoded);
+        } catch (const std::exception &e) {
+            std::cerr << "Cold state write failed for " << symbol << ": " << e.what() << "\n";
+        }
+    }
+}
+
+void SymbolLifecycle::restore(const std::unordered_set<std::string> &symbols) {
+    // file reads happen before the lock is taken
+    std::unordered_map<std::string, SymbolState> cold;
+    if (!config.coldDir.empty()) {
+        const auto maxAgeNs = std::chrono::nanoseconds(config.coldMaxAge).count();
+        for (const auto &symbol : symbols) {
+            const auto path = cold_path(config.coldDir, symbol);
+            loadSnapshotFile(path, cold, maxAgeNs, DEFAULT_WINDOW);
+
+            std::error_code ec;
+            std::filesystem::remove(path, ec);
+        }
+    }
+
+    std::lock_guard lock(stateMutex);
+    for (const auto &symbol : symbols) {
+        untrackedSince.erase(symbol);
+        auto it = cold.find(symbol);
+        if (it == cold.end() || bySymbol.contains(symbol))
+            continue;
+        bySymbol.emplace(symbol, std::move(it->second));
+        ++restored;
+    }
+}
+
+MemoryReport SymbolLifecycle::report() {
+    SubscriptionMap tracked;
+    {
+        std::lock_guard lock(subscriptionMutex);
+        tracked = trackedSymbols;
+    }
+
+    MemoryReport out;
+    out.budgetBytes = config.memoryBudgetBytes;
+
+    const auto now = Clock::now();
+    {
+        std::lock_guard lock(stateMutex);
+        out.reclaimed = reclaimed;
+        out.evicted = evicted;
+        out.restored = restored;
+        out.symbols.reserve(bySymbol.size());
+
+        for (const auto &[symbol, state] : bySymbol) {
+            SymbolMemory entry;
+            entry.symbol = symbol;
+            entry.bytes = symbolMemoryBytes(symbol, state);
+            entry.tracked = tracked.contains(symbol);
+            entry.lastEventNs = state.lastEventNs;
+            if (auto it = untrackedSince.find(symbol); it != untrackedSince.end()) {
+                const auto left = config.reclaimGrace - (now - it->second);
+                entry.reclaimInSec = std::max<std::int64_t>(
+                    0, std::chrono::duration_cast<std::chrono::seconds>(left).count());
+            }
+            out.totalBytes += entry.bytes;
+            out.symbols.push_back(std::move(entry));
+        }
+    }
+
+    std::sort(out.symbols.begin(), out.symbols.end(),
+              [](const SymbolMemory &a, const SymbolMemory &b) { return a.bytes > b.bytes; });
+    return out;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "data_parser.h"
+
+/*
+
+bySymbol only ever grew: removing a ticker unsubscribed it but kept its windows forever.
+
+Each tick (every few seconds) this:
+
+1. marks symbols that are no longer tracked and starts their grace period, a symbol that is
+   tracked again before it runs out keeps its state untouched
+2. reclaims symbols whose grace period ran out; if a cold directory is configured their
+   windows are written to <coldDir>/<SYMBOL>.state first and restored if the symbol is
+   tracked again later
+3. enforces a global memory budget by evicting the least recently updated untracked
+   symbols; tracked ones count against it but are never evicted
+
+Memory is an estimate from container sizes, close enough to rank symbols and spot growth.
+
+Lock order is subscriptionMutex then stateMutex, never both at once.
+
+*/
+
+struct LifecycleConfig {
+    std::chrono::seconds reclaimGrace{300};
+    std::size_t memoryBudgetBytes = 0; // 0 = unlimited
+    std::filesystem::path coldDir;     // empty = reclaimed state is dropped
+    std::chrono::seconds coldMaxAge{8 * 3600};
+};
+
+struct SymbolMemory {
+    std::string symbol;
+    std::size_t bytes = 0;
+    bool tracked = false;
+    std::int64_t lastEventNs = 0;
+    std::int64_t reclaimInSec = -1; // -1 when not pending
+};
+
+struct MemoryReport {
+    std::size_t totalBytes = 0;
+    std::size_t budgetBytes = 0;
+    std::uint64_t reclaimed = 0;
+    std::uint64_t evicted = 0;
+    std::uint64_t restored = 0;
+    std::vector<SymbolMemory> symbols; // largest first
+};
+
+// estimated heap + inline bytes held by one symbol's state; its volume profile belongs to
+// the seasonality store and survives eviction, so it is not counted
+std::size_t symbolMemoryBytes(const std::string &symbol, const SymbolState &state);
+
+class SymbolLifecycle {
+  public:
+    void configure(LifecycleConfig config);
+
+    // one reclaim/evict pass, takes the locks itself
+    void tick();
+
+    // brings back cold state for symbols about to be tracked again; reads the files first,
+    // then takes stateMutex to swap them in
+    void restore(const std::unordered_set<std::string> &symbols);
+
+    // takes subscriptionMutex, then stateMutex
+    MemoryReport report();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    // caller holds stateMutex; queues the encoded state for writing when cold storage is on
+    void drop(const std::string &symbol, std::vector<std::pair<std::string, std::string>> &cold);
+
+    LifecycleConfig config;
+
+    // guarded by stateMutex
+    std::unordered_map<std::string, Clock::time_point> untrackedSince;
+    std::uint64_t reclaimed = 0;
+    std::uint64_t evicted = 0;
+    std::uint64_t restored = 0;
+};
@@ -0,0 +1,69 @@
+#include "symbol_table.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+struct SymbolNameSlot {
+    char name[MAX_SYMBOL_LENGTH + 1];
+};
+
+struct StringViewHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+};
+
+// 1 MB of bss, only the pages that hold names are ever touched
+SymbolNameSlot names[MAX_SYMBOLS];
+std::atomic<std::uint32_t> count{0};
+
+std::shared_mutex idsMutex;
+std::unordered_map<std::string, SymbolId, StringViewHash, std::equal_to<>> idsByName;
+
+} // namespace
+
+SymbolId internSymbol(std::string_view symbol) {
+    if (symbol.empty() || symbol.size() > MAX_SYMBOL_LENGTH)
+        return INVALID_SYMBOL;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(idsMutex);
+        if (auto it = idsByName.find(symbol); it != idsByName.end())
+            return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(idsMutex);
+    if (auto it = idsByName.find(symbol); it != idsByName.end())
+        return it->second;
+
+    const std::uint32_t id = count.load(std::memory_order_relaxed);
+    if (id >= MAX_SYMBOLS)
+        return INVALID_SYMBOL;
+
+    std::memcpy(names[id].name, symbol.data(), symbol.size());
+    names[id].name[symbol.size()] = '\0';
+    idsByName.emplace(std::string(symbol), id);
+
+    // publishes the name before any thread can see the id as valid
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+SymbolId findSymbol(std::string_view symbol) {
+    std::shared_lock<std::shared_mutex> lock(idsMutex);
+    auto it = idsByName.find(symbol);
+    return it == idsByName.end() ? INVALID_SYMBOL : it->second;
+}
+
+std::string_view symbolName(SymbolId id) {
+    if (id >= count.load(std::memory_order_acquire))
+        return {};
+    return names[id].name;
+}
+
+std::size_t symbolCount() { return count.load(std::memory_order_acquire); }
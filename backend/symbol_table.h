@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+
+Process-wide symbol interning so events can carry a 4-byte id instead of a std::string.
+
+Ids are dense and never reused. Names live in one fixed array that is written once per id, so
+symbolName() is a plain array read and can be called from any thread without a lock. Interning
+takes a shared lock for the lookup and an exclusive lock only the first time a symbol is seen.
+
+*/
+
+using SymbolId = std::uint32_t;
+
+constexpr SymbolId INVALID_SYMBOL = ~SymbolId{0};
+constexpr std::size_t MAX_SYMBOL_LENGTH = 15;
+constexpr std::size_t MAX_SYMBOLS = 1 << 16;
+
+// returns INVALID_SYMBOL for empty or over-long names, or when the table is full
+SymbolId internSymbol(std::string_view symbol);
+
+// lookup only, INVALID_SYMBOL for names that were never interned
+SymbolId findSymbol(std::string_view symbol);
+
+// empty view for INVALID_SYMBOL or ids that were never handed out
+std::string_view symbolName(SymbolId id);
+
+std::size_t symbolCount();
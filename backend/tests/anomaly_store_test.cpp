@@ -0,0 +1,182 @@
+#include "check.h"
+
+#include <fstream>
+
+#include "anomaly_store.h"
+
+namespace {
+
+constexpr std::int64_t SEC = 1'000'000'000LL;
+constexpr std::size_t HEADER_BYTES = 4096; // segment header, see anomaly_store.cpp
+
+std::filesystem::path fresh_dir(const char *name) {
+    const auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+Anomaly closed_episode(const std::string &symbol, std::uint64_t id, std::int64_t tsNs,
+                       const std::string &profile = "") {
+    Anomaly a;
+    a.type = AnomalyType::Spread;
+    a.source = SourceType::Quote;
+    a.direction = Direction::Down;
+    a.symbol = symbol;
+    a.ts_ns = tsNs;
+    a.endTimestamp = formatTimestampNs(tsNs + 5 * SEC);
+    a.episodeId = id;
+    a.eventCount = 4;
+    a.value = 1.5;
+    a.mean = 1.0;
+    a.stdev = 0.25;
+    a.zscore = -2.5;
+    a.peakZscore = -3.5;
+    a.k = 2.0;
+    a.profile = profile;
+    return a;
+}
+
+std::vector<std::uint64_t> ids(const AnomalyStore &store, std::optional<std::string> symbol,
+                               std::optional<std::string> profile, std::int64_t fromNs,
+                               std::int64_t toNs, std::size_t limit = 1000) {
+    std::vector<std::uint64_t> out;
+    store.query(symbol, profile, fromNs, toNs, limit,
+                [&](const AnomalyRecord &r) { out.push_back(r.episode_id); });
+    return out;
+}
+
+void record_encoding() {
+    const Anomaly a = closed_episode("BRK.B", 42, 1000 * SEC, "tight");
+    const AnomalyRecord r = toAnomalyRecord(a);
+    CHECK(recordSymbol(r) == "BRK.B");
+    CHECK(recordProfile(r) == "tight");
+    CHECK(r.ts_ns == 1000 * SEC && r.end_ns == 1005 * SEC);
+    CHECK(r.episode_id == 42 && r.event_count == 4);
+    CHECK(r.type == static_cast<std::uint8_t>(AnomalyType::Spread));
+    CHECK(r.direction == static_cast<std::uint8_t>(Direction::Down));
+    CHECK(r.peak_zscore == -3.5);
+
+    // no profile reads back as the default one, long symbols are cut to fit
+    CHECK(recordProfile(toAnomalyRecord(closed_episode("X", 1, SEC))) == "default");
+    const AnomalyRecord longName = toAnomalyRecord(closed_episode(std::string(40, 'Z'), 1, SEC));
+    CHECK(recordSymbol(longName) == std::string(15, 'Z'));
+}
+
+void append_query_and_reopen() {
+    const auto dir = fresh_dir("sar-anomaly-store-test");
+    {
+        AnomalyStore store(64, 8);
+        store.open(dir);
+        CHECK(store.isOpen());
+        CHECK(store.recordCount() == 0 && store.maxEpisodeId() == 0);
+
+        // appended out of order, as episodes close
+        store.append(closed_episode("AAPL", 1, 30 * SEC));
+        store.append(closed_episode("MSFT", 2, 10 * SEC, "loose"));
+        store.append(closed_episode("AAPL", 3, 20 * SEC, "loose"));
+        store.append(closed_episode("AAPL", 4, 20 * SEC));
+        store.sync();
+    }
+
+    AnomalyStore store(64, 8);
+    store.open(dir);
+    CHECK(store.recordCount() == 4);
+    CHECK(store.maxEpisodeId() == 4);
+
+    CHECK((ids(store, std::nullopt, std::nullopt, 0, 100 * SEC) ==
+           std::vector<std::uint64_t>{2, 3, 4, 1}));
+    CHECK((ids(store, "AAPL", std::nullopt, 0, 100 * SEC) == std::vector<std::uint64_t>{3, 4, 1}));
+    CHECK((ids(store, "AAPL", std::nullopt, 20 * SEC, 25 * SEC) ==
+           std::vector<std::uint64_t>{3, 4}));
+    CHECK((ids(store, std::nullopt, "loose", 0, 100 * SEC) == std::vector<std::uint64_t>{2, 3}));
+    CHECK((ids(store, "AAPL", "default", 0, 100 * SEC) == std::vector<std::uint64_t>{4, 1}));
+    CHECK(ids(store, "TSLA", std::nullopt, 0, 100 * SEC).empty());
+    CHECK((ids(store, std::nullopt, std::nullopt, 0, 100 * SEC, 2) ==
+           std::vector<std::uint64_t>{2, 3}));
+
+    std::filesystem::remove_all(dir);
+}
+
+void recovers_a_torn_tail() {
+    const auto dir = fresh_dir("sar-anomaly-store-tail-test");
+    {
+        AnomalyStore store(64, 8);
+        store.open(dir);
+        for (std::uint64_t id = 1; id <= 10; ++id)
+            store.append(closed_episode("AAPL", id, static_cast<std::int64_t>(id) * SEC));
+        store.sync();
+    }
+
+    // tear the last record as a crash mid-write would
+    {
+        std::fstream file(dir / "anomalies-000000.seg",
+                          std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(HEADER_BYTES + 9 * sizeof(AnomalyRecord) +
+                                               offsetof(AnomalyRecord, value)));
+        file.put('\x7f');
+    }
+
+    {
+        AnomalyStore store(64, 8);
+        store.open(dir);
+        CHECK(store.recordCount() == 9);
+        CHECK(store.maxEpisodeId() == 9);
+
+        // the next append takes the torn slot
+        store.append(closed_episode("AAPL", 11, 11 * SEC));
+        store.sync();
+    }
+
+    AnomalyStore store(64, 8);
+    store.open(dir);
+    CHECK(store.recordCount() == 10);
+    CHECK(store.maxEpisodeId() == 11);
+    CHECK((ids(store, std::nullopt, std::nullopt, 9 * SEC, 100 * SEC) ==
+           std::vector<std::uint64_t>{9, 11}));
+    std::filesystem::remove_all(dir);
+}
+
+void rotates_and_drops_old_segments() {
+    const auto dir = fresh_dir("sar-anomaly-store-rotate-test");
+    {
+        AnomalyStore store(16, 3);
+        store.open(dir);
+        for (std::uint64_t id = 1; id <= 40; ++id) {
+            store.append(closed_episode("AAPL", id, static_cast<std::int64_t>(id) * SEC));
+            if (id % 8 == 0)
+                store.maintain();
+        }
+        CHECK(store.recordCount() == 40);
+
+        // without maintain() the append path makes its own spare
+        for (std::uint64_t id = 41; id <= 100; ++id)
+            store.append(closed_episode("AAPL", id, static_cast<std::int64_t>(id) * SEC));
+        CHECK(store.recordCount() == 100);
+
+        // old segments go on the next maintain(), a spare is mapped ahead
+        store.maintain();
+        CHECK(store.recordCount() == 16 + 16 + 4);
+        CHECK(store.maxEpisodeId() == 100);
+        const auto kept = ids(store, std::nullopt, std::nullopt, 0, 1000 * SEC);
+        CHECK(kept.size() == 36 && kept.front() == 65 && kept.back() == 100);
+        store.sync();
+    }
+
+    // the unused spare is picked up again instead of counting against maxSegments
+    AnomalyStore store(16, 3);
+    store.open(dir);
+    CHECK(store.recordCount() == 36);
+    store.append(closed_episode("AAPL", 101, 101 * SEC));
+    CHECK(store.recordCount() == 37);
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    record_encoding();
+    append_query_and_reopen();
+    recovers_a_torn_tail();
+    rotates_and_drops_old_segments();
+    return finish();
+}
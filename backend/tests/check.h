@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+/*
+
+Bare checks for the unit tests in this directory, no framework: a failed CHECK prints the
+file, line and expression and the test carries on, and main returns finish() so ctest sees a
+non-zero exit when anything failed.
+
+*/
+
+inline int checkFailures = 0;
+
+#define CHECK(cond)                                                                            \
+    do {                                                                                       \
+        if (!(cond)) {                                                                         \
+            ++checkFailures;                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed\n";         \
+        }                                                                                      \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                                                  \
+    do {                                                                                       \
+        const double checkA = (a);                                                             \
+        const double checkB = (b);                                                             \
+        if (!(std::abs(checkA - checkB) <= (eps))) {                                           \
+            ++checkFailures;                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #a ", " #b ") failed, " \
+                      << checkA << " vs " << checkB << "\n";                                   \
+        }                                                                                      \
+    } while (0)
+
+inline int finish() {
+    if (checkFailures > 0)
+        std::cerr << checkFailures << " check(s) failed\n";
+    return checkFailures > 0 ? 1 : 0;
+}
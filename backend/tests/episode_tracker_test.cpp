@@ -0,0 +1,154 @@
+#include "check.h"
+
+#include "episode_tracker.h"
+
+namespace {
+
+constexpr std::int64_t SEC = 1'000'000'000LL;
+constexpr double K = 2.0;
+
+Anomaly reading(double zscore, std::int64_t tsNs) {
+    Anomaly a;
+    a.type = AnomalyType::Price;
+    a.symbol = "AAPL";
+    a.ts_ns = tsNs;
+    a.timestamp = std::to_string(tsNs);
+    a.direction = zscore > 0 ? Direction::Up : Direction::Down;
+    a.mean = 100.0;
+    a.stdev = 1.0;
+    a.value = a.mean + zscore * a.stdev;
+    a.zscore = zscore;
+    return a;
+}
+
+std::vector<EpisodeTransition> feed(EpisodeTracker &tracker, std::optional<Anomaly> a,
+                                    std::int64_t sourceNs) {
+    std::vector<EpisodeTransition> out;
+    tracker.observe("AAPL", AnomalyType::Price, K, std::move(a), sourceNs, out);
+    return out;
+}
+
+void opens_extends_and_closes_when_quiet() {
+    EpisodeTracker tracker(0.5, 3, 60 * SEC);
+
+    // inside the band, nothing to do
+    CHECK(feed(tracker, std::nullopt, 1 * SEC).empty());
+    // the exit band alone does not open an episode
+    CHECK(feed(tracker, reading(1.5, 2 * SEC), 2 * SEC).empty());
+
+    auto out = feed(tracker, reading(3.0, 3 * SEC), 3 * SEC);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Opened);
+    const std::uint64_t id = out[0].record.episodeId;
+    CHECK(id > 0);
+    CHECK(out[0].record.active && out[0].record.eventCount == 1);
+    CHECK(out[0].record.k == K);
+    CHECK(tracker.openCount() == 1);
+    CHECK(tracker.threshold("AAPL", AnomalyType::Price, K) == K * 0.5);
+
+    // a reading inside k but beyond the exit band extends it
+    out = feed(tracker, reading(1.5, 4 * SEC), 4 * SEC);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Extended);
+    CHECK(out[0].record.episodeId == id && out[0].record.eventCount == 2);
+    CHECK(out[0].record.peakZscore == 3.0);
+    CHECK(out[0].record.durationMs == 1000);
+
+    out = feed(tracker, reading(4.0, 5 * SEC), 5 * SEC);
+    CHECK(out.size() == 1 && out[0].record.peakZscore == 4.0 && out[0].record.eventCount == 3);
+
+    // quietLimit evaluations back inside the exit band close it
+    CHECK(feed(tracker, std::nullopt, 6 * SEC).empty());
+    CHECK(feed(tracker, std::nullopt, 7 * SEC).empty());
+    out = feed(tracker, std::nullopt, 8 * SEC);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Closed);
+    CHECK(out[0].record.episodeId == id && !out[0].record.active);
+    CHECK(out[0].record.eventCount == 3);
+    CHECK(tracker.openCount() == 0);
+    CHECK(tracker.threshold("AAPL", AnomalyType::Price, K) == K);
+}
+
+void only_scores_a_source_once() {
+    EpisodeTracker tracker(0.5, 1, 60 * SEC);
+
+    CHECK(tracker.fresh("AAPL", AnomalyType::Price, 10 * SEC));
+    CHECK(!tracker.fresh("AAPL", AnomalyType::Price, 0));
+
+    auto out = feed(tracker, reading(3.0, 10 * SEC), 10 * SEC);
+    CHECK(out.size() == 1);
+    CHECK(!tracker.fresh("AAPL", AnomalyType::Price, 10 * SEC));
+    CHECK(tracker.fresh("AAPL", AnomalyType::Spread, 10 * SEC));
+
+    // the same observation scored again neither extends nor counts as quiet
+    CHECK(feed(tracker, reading(3.0, 10 * SEC), 10 * SEC).empty());
+    CHECK(feed(tracker, std::nullopt, 10 * SEC).empty());
+    CHECK(feed(tracker, std::nullopt, 9 * SEC).empty());
+    CHECK(tracker.openCount() == 1);
+
+    out = feed(tracker, std::nullopt, 11 * SEC);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Closed);
+}
+
+void reversal_closes_and_reopens() {
+    EpisodeTracker tracker(0.5, 3, 60 * SEC);
+
+    auto out = feed(tracker, reading(3.0, 1 * SEC), 1 * SEC);
+    CHECK(out.size() == 1);
+    const std::uint64_t up = out[0].record.episodeId;
+
+    out = feed(tracker, reading(-3.0, 2 * SEC), 2 * SEC);
+    CHECK(out.size() == 2);
+    CHECK(out[0].kind == EpisodeTransition::Kind::Closed && out[0].record.episodeId == up);
+    CHECK(out[1].kind == EpisodeTransition::Kind::Opened);
+    CHECK(out[1].record.direction == Direction::Down && out[1].record.episodeId > up);
+    CHECK(tracker.openCount() == 1);
+}
+
+void expires_on_the_source_clock() {
+    EpisodeTracker tracker(0.5, 3, 60 * SEC);
+    std::vector<EpisodeTransition> out;
+
+    feed(tracker, reading(3.0, 100 * SEC), 100 * SEC);
+    // a newer observation back in the band, not yet quiet long enough to close
+    CHECK(feed(tracker, std::nullopt, 200 * SEC).empty());
+
+    // the source moved on 100s without extending it, longer than the idle timeout
+    tracker.expire(210 * SEC, out);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Closed);
+
+    // a source that never reports again closes after SILENT_TIMEOUTS idle timeouts
+    feed(tracker, reading(3.0, 300 * SEC), 300 * SEC);
+    out.clear();
+    tracker.expire(300 * SEC + 60 * SEC, out);
+    CHECK(out.empty());
+    tracker.expire(300 * SEC + 5 * 60 * SEC + 1, out);
+    CHECK(out.size() == 1 && out[0].kind == EpisodeTransition::Kind::Closed);
+
+    // pruned source times stay rejected
+    tracker.expire(1000 * SEC, out);
+    CHECK(!tracker.fresh("AAPL", AnomalyType::Price, 300 * SEC));
+    CHECK(!tracker.fresh("MSFT", AnomalyType::Price, 300 * SEC));
+    CHECK(tracker.fresh("MSFT", AnomalyType::Price, 1000 * SEC));
+}
+
+void close_all_and_seeded_ids() {
+    EpisodeTracker::seedIds(5000);
+    EpisodeTracker tracker(0.5, 3, 60 * SEC);
+
+    auto out = feed(tracker, reading(3.0, 1 * SEC), 1 * SEC);
+    CHECK(out.size() == 1 && out[0].record.episodeId >= 5000);
+
+    std::vector<EpisodeTransition> closed;
+    tracker.closeAll(closed);
+    CHECK(closed.size() == 1 && !closed[0].record.active);
+    CHECK(tracker.openCount() == 0);
+}
+
+} // namespace
+
+int main() {
+    opens_extends_and_closes_when_quiet();
+    only_scores_a_source_once();
+    reversal_closes_and_reopens();
+    expires_on_the_source_clock();
+    close_all_and_seeded_ids();
+    return finish();
+}
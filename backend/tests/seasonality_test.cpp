@@ -0,0 +1,90 @@
+#include "check.h"
+
+#include "seasonality.h"
+
+namespace {
+
+std::int64_t utc_ns(std::int64_t y, unsigned m, unsigned d, int hour, int minute) {
+    return (daysFromCivil(y, m, d) * 86400 + hour * 3600 + minute * 60) * 1'000'000'000LL;
+}
+
+// the open is 14:30 UTC in winter (EST) and 13:30 UTC in summer (EDT)
+void session_minute_follows_daylight_saving() {
+    // 2026 switches to EDT on Sunday March 8 and back to EST on Sunday November 1
+    CHECK(sessionMinute(utc_ns(2026, 3, 6, 14, 30)) == 0);   // Friday, EST
+    CHECK(sessionMinute(utc_ns(2026, 3, 6, 13, 30)) == -1);  // an hour before the open
+    CHECK(sessionMinute(utc_ns(2026, 3, 6, 20, 59)) == 389); // last minute
+    CHECK(sessionMinute(utc_ns(2026, 3, 6, 21, 0)) == -1);   // the close
+
+    CHECK(sessionMinute(utc_ns(2026, 3, 9, 13, 30)) == 0); // Monday, EDT
+    CHECK(sessionMinute(utc_ns(2026, 3, 9, 14, 30)) == 60);
+    CHECK(sessionMinute(utc_ns(2026, 3, 9, 19, 59)) == 389);
+    CHECK(sessionMinute(utc_ns(2026, 3, 9, 20, 0)) == -1);
+
+    CHECK(sessionMinute(utc_ns(2026, 10, 30, 13, 30)) == 0); // Friday, still EDT
+    CHECK(sessionMinute(utc_ns(2026, 11, 2, 13, 30)) == -1); // Monday, EST again
+    CHECK(sessionMinute(utc_ns(2026, 11, 2, 14, 30)) == 0);
+    CHECK(sessionMinute(utc_ns(2026, 11, 2, 20, 59)) == 389);
+
+    // 2025: March 9 and November 2
+    CHECK(sessionMinute(utc_ns(2025, 3, 10, 13, 30)) == 0);
+    CHECK(sessionMinute(utc_ns(2025, 11, 3, 14, 30)) == 0);
+
+    // weekends and bad timestamps
+    CHECK(sessionMinute(utc_ns(2026, 3, 7, 15, 0)) == -1);
+    CHECK(sessionMinute(utc_ns(2026, 3, 8, 15, 0)) == -1);
+    CHECK(sessionMinute(0) == -1);
+}
+
+void session_span_follows_daylight_saving() {
+    SessionSpan winter = sessionSpan(utc_ns(2026, 3, 6, 16, 0));
+    CHECK(winter.startNs == utc_ns(2026, 3, 6, 14, 30));
+    CHECK(winter.endNs == utc_ns(2026, 3, 6, 21, 0));
+
+    // the first session after the switch, asked for before the open
+    SessionSpan summer = sessionSpan(utc_ns(2026, 3, 9, 12, 0));
+    CHECK(summer.startNs == utc_ns(2026, 3, 9, 13, 30));
+    CHECK(summer.endNs == utc_ns(2026, 3, 9, 20, 0));
+    CHECK(summer.contains(utc_ns(2026, 3, 9, 13, 30)));
+    CHECK(!summer.contains(utc_ns(2026, 3, 9, 20, 0)));
+
+    // 02:00 UTC Tuesday is still Monday evening in New York
+    SessionSpan evening = sessionSpan(utc_ns(2026, 3, 10, 2, 0));
+    CHECK(evening.startNs == summer.startNs);
+    CHECK(evening.endNs == summer.endNs);
+
+    SessionSpan november = sessionSpan(utc_ns(2026, 11, 2, 18, 0));
+    CHECK(november.startNs == utc_ns(2026, 11, 2, 14, 30));
+    CHECK(november.endNs == utc_ns(2026, 11, 2, 21, 0));
+
+    // 03:00 UTC Monday is Sunday evening in New York, no session
+    SessionSpan sunday = sessionSpan(utc_ns(2026, 11, 2, 3, 0));
+    CHECK(sunday.startNs == 0 && sunday.endNs == 0);
+    CHECK(!sunday.contains(utc_ns(2026, 11, 2, 3, 0)));
+
+    CHECK(sessionSpan(utc_ns(2026, 3, 7, 15, 0)).endNs == 0); // Saturday
+}
+
+void volume_profile_learns_per_minute() {
+    VolumeProfile profile;
+    for (int session = 0; session < 5; ++session)
+        profile.observe(0, 1000.0 + session * 100.0);
+    profile.observe(-1, 5.0);
+    profile.observe(static_cast<int>(SESSION_MINUTES), 5.0);
+
+    const SeasonalExpectation open = profile.expected(0);
+    CHECK(open.minute == 0);
+    CHECK(open.sessions == 5);
+    CHECK_NEAR(open.mean, 1200.0, 1e-3);
+    CHECK(open.stdev > 0.0);
+    CHECK(profile.expected(1).sessions == 0);
+}
+
+} // namespace
+
+int main() {
+    session_minute_follows_daylight_saving();
+    session_span_follows_daylight_saving();
+    volume_profile_learns_per_minute();
+    return finish();
+}
@@ -0,0 +1,222 @@
+#include "check.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "snapshot.h"
+
+namespace {
+
+constexpr std::int64_t SEC = 1'000'000'000LL;
+
+// Monday 2026-03-09 14:00 UTC, inside the regular session
+const std::int64_t T0 = (daysFromCivil(2026, 3, 9) * 86400 + 14 * 3600) * SEC;
+
+MarketEvent quote(const char *symbol, std::int64_t tsNs, double bid, double ask) {
+    MarketEvent ev;
+    ev.type = MarketEventType::Quote;
+    ev.symbol = internSymbol(symbol);
+    ev.ts_ns = tsNs;
+    ev.quote.bid_price = bid;
+    ev.quote.ask_price = ask;
+    ev.quote.bid_size = 3;
+    ev.quote.ask_size = 5;
+    return ev;
+}
+
+MarketEvent trade(const char *symbol, std::int64_t tsNs, double price, std::int64_t size) {
+    MarketEvent ev;
+    ev.type = MarketEventType::Trade;
+    ev.symbol = internSymbol(symbol);
+    ev.ts_ns = tsNs;
+    ev.trade = Trade{};
+    ev.trade.price = price;
+    ev.trade.size = size;
+    return ev;
+}
+
+MarketEvent bar(const char *symbol, std::int64_t tsNs, double close, std::int64_t volume) {
+    MarketEvent ev;
+    ev.type = MarketEventType::Bar;
+    ev.symbol = internSymbol(symbol);
+    ev.ts_ns = tsNs;
+    ev.bar = Bar{};
+    ev.bar.open = close - 0.5;
+    ev.bar.high = close + 1.0;
+    ev.bar.low = close - 1.0;
+    ev.bar.close = close;
+    ev.bar.volume = volume;
+    ev.bar.trade_count = 10;
+    ev.bar.vwap = close - 0.1;
+    return ev;
+}
+
+std::unordered_map<std::string, SymbolState> sample_state() {
+    std::vector<MarketEvent> events;
+    for (int i = 0; i < 120; ++i) {
+        const std::int64_t ts = T0 + i * SEC;
+        const double mid = 100.0 + (i % 7) * 0.25;
+        events.push_back(quote("AAPL", ts, mid - 0.05, mid + 0.05 + (i % 3) * 0.01));
+        events.push_back(trade("AAPL", ts + 1, mid + (i % 2 ? 0.04 : -0.04), 100 + i));
+        if (i % 10 == 0)
+            events.push_back(bar("AAPL", T0 + i * 60 * SEC, mid, 5000 + i * 10));
+    }
+    events.push_back(trade("MSFT", T0, 400.0, 50));
+
+    std::unordered_map<std::string, SymbolState> bySymbol;
+    updateState(bySymbol, events);
+    return bySymbol;
+}
+
+template <typename A, typename B> bool same_values(const A &a, const B &b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+void symbol_state_round_trips() {
+    const auto bySymbol = sample_state();
+    const SymbolState &before = bySymbol.at("AAPL");
+
+    std::string encoded;
+    encodeSymbolState(encoded, "AAPL", before);
+
+    std::size_t pos = 0;
+    std::string symbol;
+    SymbolState after;
+    CHECK(decodeSymbolState(encoded, pos, symbol, after));
+    CHECK(pos == encoded.size());
+    CHECK(symbol == "AAPL");
+
+    CHECK(after.lastBarNs == before.lastBarNs);
+    CHECK(after.lastBar.has_value() && after.lastBar->close == before.lastBar->close);
+    CHECK(after.lastBar->vwap == before.lastBar->vwap);
+    CHECK(same_values(after.prices, before.prices));
+    CHECK(same_values(after.barVolumes, before.barVolumes));
+    CHECK(same_values(after.tradeSizes, before.tradeSizes));
+    CHECK(same_values(after.spreads, before.spreads));
+    CHECK(same_values(after.barRanges.values, before.barRanges.values));
+    CHECK(same_values(after.barGaps.values, before.barGaps.values));
+    CHECK(same_values(after.quoteDepths.values, before.quoteDepths.values));
+    CHECK(after.lastGap == before.lastGap);
+
+    CHECK_NEAR(after.tradeVolatility.longReturns.variance(),
+               before.tradeVolatility.longReturns.variance(), 1e-15);
+    CHECK(after.tradeVolatility.lastLogPrice == before.tradeVolatility.lastLogPrice);
+    CHECK(after.barVolatility.longReturns.size() == before.barVolatility.longReturns.size());
+
+    CHECK(after.tradeSizeQuantiles.count() == before.tradeSizeQuantiles.count());
+    CHECK_NEAR(after.tradeSizeQuantiles.quantile(0.5), before.tradeSizeQuantiles.quantile(0.5),
+               1e-9);
+    CHECK(after.spreadQuantiles.min() == before.spreadQuantiles.min());
+    CHECK(after.spreadQuantiles.max() == before.spreadQuantiles.max());
+
+    CHECK(before.tradeFlow.imbalances.size() > 0);
+    CHECK(after.tradeFlow.lastPrice == before.tradeFlow.lastPrice);
+    CHECK(after.tradeFlow.lastSign == before.tradeFlow.lastSign);
+    CHECK(after.tradeFlow.imbalance() == before.tradeFlow.imbalance());
+    CHECK(same_values(after.tradeFlow.imbalances.values, before.tradeFlow.imbalances.values));
+
+    CHECK(before.vwap.trades > 0);
+    CHECK(after.vwap.session.startNs == before.vwap.session.startNs);
+    CHECK(after.vwap.session.endNs == before.vwap.session.endNs);
+    CHECK(after.vwap.trades == before.vwap.trades);
+    CHECK(after.vwap.value() == before.vwap.value());
+    CHECK(after.vwap.barValue() == before.vwap.barValue());
+}
+
+void decode_trims_to_window() {
+    const auto bySymbol = sample_state();
+    std::string encoded;
+    encodeSymbolState(encoded, "AAPL", bySymbol.at("AAPL"));
+
+    std::size_t pos = 0;
+    std::string symbol;
+    SymbolState state;
+    CHECK(decodeSymbolState(encoded, pos, symbol, state, 10));
+    CHECK(state.prices.size() == 10);
+    CHECK(state.prices.back() == bySymbol.at("AAPL").prices.back());
+    CHECK(state.tradeSizes.size() == 10);
+    CHECK(state.tradeVolatility.longReturns.size() <= 10);
+}
+
+void decode_rejects_truncated_entries() {
+    const auto bySymbol = sample_state();
+    std::string encoded;
+    encodeSymbolState(encoded, "AAPL", bySymbol.at("AAPL"));
+
+    bool allRejected = true;
+    for (std::size_t length = 0; length < encoded.size(); length += 8) {
+        std::size_t pos = 0;
+        std::string symbol;
+        SymbolState state;
+        if (decodeSymbolState(std::string_view(encoded).substr(0, length), pos, symbol, state))
+            allRejected = false;
+    }
+    CHECK(allRejected);
+}
+
+void snapshot_file_round_trips() {
+    const auto dir = std::filesystem::temp_directory_path() / "sar-snapshot-test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "state.snap";
+
+    const auto bySymbol = sample_state();
+    writeSnapshotFile(path, encodeSnapshot(bySymbol));
+
+    std::unordered_map<std::string, SymbolState> loaded;
+    CHECK(loadSnapshotFile(path, loaded, 3600 * SEC) == 2);
+    CHECK(loaded.contains("AAPL") && loaded.contains("MSFT"));
+    CHECK(same_values(loaded["AAPL"].prices, bySymbol.at("AAPL").prices));
+    CHECK(loaded["MSFT"].tradeSizes.size() == 1);
+
+    // the window is applied on load too
+    loaded.clear();
+    CHECK(loadSnapshotFile(path, loaded, 3600 * SEC, 5) == 2);
+    CHECK(loaded["AAPL"].prices.size() == 5);
+
+    // too old
+    loaded.clear();
+    CHECK(loadSnapshotFile(path, loaded, -1) == 0);
+    CHECK(loadSnapshotFile(dir / "missing.snap", loaded, 3600 * SEC) == 0);
+
+    std::string bytes;
+    {
+        std::ifstream in(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    auto write = [&](const std::string &data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    // header: magic, u32 version, u32 reserved, i64 createdNs, u64 symbolCount
+    std::string corrupt = bytes;
+    const std::uint64_t huge = std::numeric_limits<std::uint64_t>::max();
+    std::memcpy(corrupt.data() + 24, &huge, sizeof(huge));
+    write(corrupt);
+    CHECK(loadSnapshotFile(path, loaded, 3600 * SEC) == 2);
+
+    corrupt = bytes;
+    const std::uint32_t version = SNAPSHOT_VERSION + 1;
+    std::memcpy(corrupt.data() + 8, &version, sizeof(version));
+    write(corrupt);
+    loaded.clear();
+    CHECK(loadSnapshotFile(path, loaded, 3600 * SEC) == 0);
+
+    // a file cut short keeps the symbols before the cut
+    write(bytes.substr(0, bytes.size() - 8));
+    CHECK(loadSnapshotFile(path, loaded, 3600 * SEC) == 1);
+
+    std::filesystem::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    symbol_state_round_trips();
+    decode_trims_to_window();
+    decode_rejects_truncated_entries();
+    snapshot_file_round_trips();
+    return finish();
+}
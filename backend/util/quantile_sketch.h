@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// merging t-digest (Dunning). keeps at most ~compression centroids, sized so the tails stay
+// nearly exact, so the extreme quantiles a block-trade detector cares about are the best
+// resolved ones. new values go to
+// a small buffer that is merged in one sorted pass when full, so adds are amortized
+// O(log BUFFER). two sketches merge by feeding one's centroids into the other, which is how
+// snapshots carry a distribution across sessions. about 4 KB per sketch at compression 100
+class QuantileSketch {
+  public:
+    struct Centroid {
+        double mean = 0.0;
+        double weight = 0.0;
+    };
+
+    QuantileSketch() = default;
+    explicit QuantileSketch(double compression) : compression(compression) {}
+
+    void add(double x, double weight = 1.0) {
+        if (!std::isfinite(x) || weight <= 0.0)
+            return;
+        if (buffer.empty() && centroids.empty()) {
+            minValue = x;
+            maxValue = x;
+        } else {
+            minValue = std::min(minValue, x);
+            maxValue = std::max(maxValue, x);
+        }
+        buffer.push_back({x, weight});
+        total += weight;
+        if (buffer.size() >= BUFFER)
+            compress();
+    }
+
+    void merge(const QuantileSketch &other) {
+        other.forEachCentroid([&](const Centroid &c) { add(c.mean, c.weight); });
+    }
+
+    // restores the observed range, for sketches rebuilt from their centroids
+    void setRange(double lo, double hi) {
+        minValue = lo;
+        maxValue = hi;
+    }
+
+    void clear() {
+        centroids.clear();
+        buffer.clear();
+        total = 0.0;
+        minValue = maxValue = 0.0;
+    }
+
+    double count() const { return total; }
+    bool empty() const { return total <= 0.0; }
+    double min() const { return minValue; }
+    double max() const { return maxValue; }
+
+    // value below which a fraction q of the weight falls
+    double quantile(double q) const {
+        compress();
+        if (centroids.empty())
+            return 0.0;
+        if (centroids.size() == 1)
+            return centroids.front().mean;
+
+        q = std::clamp(q, 0.0, 1.0);
+        const double target = q * total;
+
+        // each centroid's weight is centred on its mean; interpolate between neighbours and
+        // against the observed min / max at the ends
+        double cumulative = 0.0;
+        for (std::size_t i = 0; i < centroids.size(); ++i) {
+            const Centroid &c = centroids[i];
+            const double mid = cumulative + c.weight / 2.0;
+            if (target < mid) {
+                if (i == 0)
+                    return minValue + target / mid * (c.mean - minValue);
+                const Centroid &prev = centroids[i - 1];
+                const double prevMid = cumulative - prev.weight / 2.0;
+                const double t = (target - prevMid) / (mid - prevMid);
+                return prev.mean + t * (c.mean - prev.mean);
+            }
+            cumulative += c.weight;
+        }
+
+        const Centroid &last = centroids.back();
+        const double lastMid = total - last.weight / 2.0;
+        const double t = (target - lastMid) / (total - lastMid);
+        return last.mean + std::clamp(t, 0.0, 1.0) * (maxValue - last.mean);
+    }
+
+    // fraction of the weight at or below x
+    double cdf(double x) const {
+        compress();
+        if (centroids.empty())
+            return 0.0;
+        if (x < minValue)
+            return 0.0;
+        if (x >= maxValue)
+            return 1.0;
+
+        double cumulative = 0.0;
+        double prevMean = minValue;
+        double prevMid = 0.0;
+        for (const Centroid &c : centroids) {
+            const double mid = cumulative + c.weight / 2.0;
+            if (x < c.mean) {
+                const double span = c.mean - prevMean;
+                const double t = span > 0.0 ? (x - prevMean) / span : 1.0;
+                return (prevMid + t * (mid - prevMid)) / total;
+            }
+            cumulative += c.weight;
+            prevMean = c.mean;
+            prevMid = mid;
+        }
+        const double span = maxValue - prevMean;
+        const double t = span > 0.0 ? (x - prevMean) / span : 1.0;
+        return (prevMid + t * (total - prevMid)) / total;
+    }
+
+    // merged centroids and still-buffered points, in no particular order
+    template <typename F> void forEachCentroid(F &&f) const {
+        for (const Centroid &c : centroids)
+            f(c);
+        for (const Centroid &c : buffer)
+            f(c);
+    }
+
+    std::size_t allocatedBytes() const {
+        return (centroids.capacity() + buffer.capacity()) * sizeof(Centroid);
+    }
+
+  private:
+    static constexpr std::size_t BUFFER = 64;
+
+    // merging only reorganizes, so the read-only queries may trigger it
+    void compress() const {
+        if (buffer.empty())
+            return;
+
+        buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+        std::sort(buffer.begin(), buffer.end(),
+                  [](const Centroid &a, const Centroid &b) { return a.mean < b.mean; });
+
+        // k2 scale: a centroid may span at most one unit of k, which grows like log(q/(1-q)),
+        // so centroids shrink towards single points in both tails and the middle is coarse
+        const double normalizer = 4.0 * std::log(std::max(total / compression, 1.0)) + 24.0;
+        const auto scale = [&](double q) {
+            q = std::clamp(q, 1e-15, 1.0 - 1e-15);
+            return compression / normalizer * std::log(q / (1.0 - q));
+        };
+
+        centroids.clear();
+        Centroid current = buffer.front();
+        double before = 0.0;
+        double kLeft = scale(0.0);
+        for (std::size_t i = 1; i < buffer.size(); ++i) {
+            const Centroid &next = buffer[i];
+            const double proposed = current.weight + next.weight;
+            if (scale((before + proposed) / total) - kLeft <= 1.0) {
+                current.mean += (next.mean - current.mean) * next.weight / proposed;
+                current.weight = proposed;
+            } else {
+                before += current.weight;
+                kLeft = scale(before / total);
+                centroids.push_back(current);
+                current = next;
+            }
+        }
+        centroids.push_back(current);
+        buffer.clear();
+    }
+
+    double compression = 100.0;
+    double total = 0.0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+    mutable std::vector<Centroid> centroids; // sorted by mean
+    mutable std::vector<Centroid> buffer;
+};
+
+// standard normal quantile (Acklam's rational approximation, |error| < 1.2e-9), used to put
+// percentile ranks on the same z scale the other detectors report
+inline double normalQuantile(double p) {
+    if (p <= 0.0)
+        return -std::numeric_limits<double>::infinity();
+    if (p >= 1.0)
+        return std::numeric_limits<double>::infinity();
+
+    static constexpr double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                                   -2.759285104469687e+02, 1.383577518672690e+02,
+                                   -3.066479806614716e+01, 2.506628277459239e+00};
+    static constexpr double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                                   -1.556989798598866e+02, 6.680131188771972e+01,
+                                   -1.328068155288572e+01};
+    static constexpr double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                                   -2.400758277161838e+00, -2.549732539343734e+00,
+                                   4.374664141464968e+00,  2.938163982698783e+00};
+    static constexpr double d[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                                   2.445134137142996e+00, 3.754408661907416e+00};
+
+    constexpr double LOW = 0.02425;
+    if (p < LOW) {
+        const double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - LOW) {
+        const double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    const double q = p - 0.5;
+    const double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
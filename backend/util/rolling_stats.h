@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+
+// count-based window that keeps a running sum and sum of squares, so mean and
+// stdev are O(1) instead of rescanning the whole deque like calcSTDEV does
+struct RollingStats {
+    std::deque<double> values;
+    double sum = 0.0;
+    double sumSq = 0.0;
+
+    void push(double x, std::size_t maxN) {
+        values.push_back(x);
+        sum += x;
+        sumSq += x * x;
+        if (values.size() > maxN) {
+            const double old = values.front();
+            values.pop_front();
+            sum -= old;
+            sumSq -= old * old;
+        }
+    }
+
+    void clear() {
+        values.clear();
+        sum = 0.0;
+        sumSq = 0.0;
+    }
+
+    std::size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+
+    double mean() const {
+        if (values.empty())
+            return 0.0;
+        return sum / static_cast<double>(values.size());
+    }
+
+    // population variance, same convention as calcSTDEV
+    double variance() const {
+        if (values.empty())
+            return 0.0;
+        const double n = static_cast<double>(values.size());
+        const double m = sum / n;
+        // running sums can drift slightly negative when the window is flat
+        return std::max(0.0, sumSq / n - m * m);
+    }
+
+    double stdev() const { return std::sqrt(variance()); }
+
+    // mean of squared values, i.e. realized variance when the values are returns
+    double meanSquare() const {
+        if (values.empty())
+            return 0.0;
+        return sumSq / static_cast<double>(values.size());
+    }
+};
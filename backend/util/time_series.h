@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// one time bucket: OHLC and volume from trades, spread from quotes
+struct SeriesBucket {
+    std::int64_t start_ns = 0; // 0 for a slot that was never filled
+    double open = 0.0;
+    double high = 0.0;
+    double low = 0.0;
+    double close = 0.0;
+    std::int64_t volume = 0;
+    double spreadSum = 0.0;
+    std::uint32_t trades = 0;
+    std::uint32_t quotes = 0;
+
+    double spreadMean() const { return quotes ? spreadSum / quotes : 0.0; }
+};
+
+static_assert(sizeof(SeriesBucket) == 64, "one bucket per cache line");
+
+// fixed ring of buckets at one resolution, slot = bucket number % capacity. an event either
+// lands in its slot's current bucket or restarts the slot, so every update is O(1). events
+// older than whatever now owns their slot are dropped. storage is allocated on first use
+class SeriesRing {
+  public:
+    SeriesRing(std::int64_t resolutionNs, std::size_t capacity)
+        : resolution(resolutionNs), capacity(capacity) {}
+
+    void addTrade(std::int64_t tsNs, double price, std::int64_t size) {
+        SeriesBucket *b = bucket(tsNs);
+        if (!b)
+            return;
+        if (b->trades == 0) {
+            b->open = b->high = b->low = price;
+        } else {
+            b->high = std::max(b->high, price);
+            b->low = std::min(b->low, price);
+        }
+        b->close = price;
+        b->volume += size;
+        ++b->trades;
+    }
+
+    void addQuote(std::int64_t tsNs, double spread) {
+        SeriesBucket *b = bucket(tsNs);
+        if (!b)
+            return;
+        b->spreadSum += spread;
+        ++b->quotes;
+    }
+
+    // filled buckets with start in [fromNs, toNs], oldest first, at most limit of the newest
+    template <typename F>
+    void forEach(std::int64_t fromNs, std::int64_t toNs, std::size_t limit, F &&f) const {
+        if (slots.empty() || newest == 0)
+            return;
+
+        // walk back from the newest bucket until the ring wraps or the range ends
+        std::vector<const SeriesBucket *> picked;
+        const std::int64_t newestIndex = newest / resolution;
+        for (std::size_t back = 0; back < capacity && picked.size() < limit; ++back) {
+            const std::int64_t index = newestIndex - static_cast<std::int64_t>(back);
+            const std::int64_t start = index * resolution;
+            if (start < fromNs)
+                break;
+            const SeriesBucket &b = slots[slot(index)];
+            if (b.start_ns == start && start <= toNs)
+                picked.push_back(&b);
+        }
+        for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+            f(**it);
+    }
+
+    std::int64_t resolutionNs() const { return resolution; }
+    std::size_t size() const { return capacity; }
+    std::size_t allocatedBytes() const { return slots.capacity() * sizeof(SeriesBucket); }
+
+  private:
+    std::size_t slot(std::int64_t index) const {
+        return static_cast<std::size_t>(index % static_cast<std::int64_t>(capacity));
+    }
+
+    SeriesBucket *bucket(std::int64_t tsNs) {
+        if (tsNs <= 0)
+            return nullptr;
+        if (slots.empty())
+            slots.resize(capacity);
+
+        const std::int64_t index = tsNs / resolution;
+        const std::int64_t start = index * resolution;
+        SeriesBucket &b = slots[slot(index)];
+        if (b.start_ns > start)
+            return nullptr; // slot already holds a newer bucket
+        if (b.start_ns != start) {
+            b = SeriesBucket{};
+            b.start_ns = start;
+        }
+        newest = std::max(newest, start);
+        return &b;
+    }
+
+    std::int64_t resolution;
+    std::size_t capacity;
+    std::int64_t newest = 0; // start of the newest bucket
+    std::vector<SeriesBucket> slots;
+};
+
+enum class SeriesResolution { Second, Minute, FiveMinutes };
+
+inline std::optional<SeriesResolution> parseSeriesResolution(std::string_view name) {
+    if (name == "1s")
+        return SeriesResolution::Second;
+    if (name == "1m")
+        return SeriesResolution::Minute;
+    if (name == "5m")
+        return SeriesResolution::FiveMinutes;
+    return std::nullopt;
+}
+
+// downsampled chart data per symbol: the last hour at 1s, a full extended session
+// (04:00-20:00 ET) at 1m and a whole day at 5m, about 300 KB once all three are in use
+struct SeriesStore {
+    static constexpr std::int64_t SECOND_NS = 1'000'000'000LL;
+
+    SeriesRing seconds{SECOND_NS, 3600};
+    SeriesRing minutes{60 * SECOND_NS, 960};
+    SeriesRing fiveMinutes{300 * SECOND_NS, 288};
+
+    void addTrade(std::int64_t tsNs, double price, std::int64_t size) {
+        for (SeriesRing *ring : {&seconds, &minutes, &fiveMinutes})
+            ring->addTrade(tsNs, price, size);
+    }
+
+    void addQuote(std::int64_t tsNs, double spread) {
+        for (SeriesRing *ring : {&seconds, &minutes, &fiveMinutes})
+            ring->addQuote(tsNs, spread);
+    }
+
+    const SeriesRing &ring(SeriesResolution resolution) const {
+        switch (resolution) {
+        case SeriesResolution::Second:
+            return seconds;
+        case SeriesResolution::Minute:
+            return minutes;
+        case SeriesResolution::FiveMinutes:
+            break;
+        }
+        return fiveMinutes;
+    }
+
+    std::size_t allocatedBytes() const {
+        return seconds.allocatedBytes() + minutes.allocatedBytes() + fiveMinutes.allocatedBytes();
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// time-based window keyed on event timestamps: everything newer than horizonNs before the
+// latest event, capped at maxPoints so a very liquid name cannot grow it without bound.
+// points sit in a ring in timestamp order (late events are clamped to the newest time), so
+// eviction only ever pops the head and push is amortized O(1). running sums are kept
+// relative to a pivot and rebuilt exactly once per ring's worth of evictions, so the
+// cancellation that creeps into add/subtract sums over millions of quotes never piles up
+class TimeWindow {
+  public:
+    void push(std::int64_t tsNs, double x, std::int64_t horizonNs, std::size_t maxPoints) {
+        if (maxPoints == 0)
+            return;
+        newest = std::max(newest, tsNs);
+
+        const std::int64_t cutoff = newest - horizonNs;
+        while (count > 0 && ring[head].ts_ns < cutoff)
+            popFront();
+        if (count >= maxPoints)
+            popFront();
+
+        if (count == 0)
+            pivot = x;
+        if (count == ring.size())
+            grow(maxPoints);
+
+        ring[(head + count) % ring.size()] = {newest, x};
+        ++count;
+        const double d = x - pivot;
+        sum += d;
+        sumSq += d * d;
+    }
+
+    void clear() {
+        ring.clear();
+        head = count = 0;
+        sum = sumSq = 0.0;
+        evictions = 0;
+        newest = 0;
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    double mean() const { return count ? pivot + sum / static_cast<double>(count) : 0.0; }
+
+    // population variance, same convention as RollingStats
+    double variance() const {
+        if (count == 0)
+            return 0.0;
+        const double n = static_cast<double>(count);
+        const double m = sum / n;
+        return std::max(0.0, sumSq / n - m * m);
+    }
+
+    double stdev() const { return std::sqrt(variance()); }
+
+    // time covered by the points currently held
+    std::int64_t spanNs() const {
+        return count ? ring[(head + count - 1) % ring.size()].ts_ns - ring[head].ts_ns : 0;
+    }
+
+    std::size_t allocatedBytes() const { return ring.capacity() * sizeof(Point); }
+
+  private:
+    struct Point {
+        std::int64_t ts_ns;
+        double value;
+    };
+
+    void popFront() {
+        const double d = ring[head].value - pivot;
+        sum -= d;
+        sumSq -= d * d;
+        head = (head + 1) % ring.size();
+        --count;
+        if (++evictions >= ring.size())
+            rebuild();
+    }
+
+    // re-pivot on the current mean and resum exactly, amortized O(1) over the evictions
+    void rebuild() {
+        evictions = 0;
+        const double m = mean();
+        pivot = m;
+        sum = sumSq = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            const double d = ring[(head + i) % ring.size()].value - pivot;
+            sum += d;
+            sumSq += d * d;
+        }
+    }
+
+    // doubles up to maxPoints, unrolling the ring so the head is back at 0
+    void grow(std::size_t maxPoints) {
+        const std::size_t capacity =
+            std::min(std::max<std::size_t>(16, ring.size() * 2), maxPoints);
+        std::vector<Point> next(capacity);
+        for (std::size_t i = 0; i < count; ++i)
+            next[i] = ring[(head + i) % ring.size()];
+        ring = std::move(next);
+        head = 0;
+    }
+
+    std::vector<Point> ring;
+    std::size_t head = 0;
+    std::size_t count = 0;
+    double pivot = 0.0;
+    double sum = 0.0;
+    double sumSq = 0.0;
+    std::size_t evictions = 0;
+    std::int64_t newest = 0;
+};
@@ -0,0 +1,148 @@
+#include "wire_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+WireFormat negotiateWireFormat(std::string_view formatParam, std::string_view accept) {
+    if (formatParam == "msgpack")
+        return WireFormat::MsgPack;
+    if (formatParam == "cbor")
+        return WireFormat::Cbor;
+    if (formatParam == "records")
+        return WireFormat::Records;
+    if (formatParam == "json")
+        return WireFormat::Json;
+
+    // first listed type we know wins, quality values are not worth parsing here
+    struct Known {
+        std::string_view type;
+        WireFormat format;
+    };
+    constexpr Known KNOWN[] = {
+        {"application/json", WireFormat::Json},
+        {"application/msgpack", WireFormat::MsgPack},
+        {"application/x-msgpack", WireFormat::MsgPack},
+        {"application/cbor", WireFormat::Cbor},
+        {"application/vnd.sar.records", WireFormat::Records},
+    };
+
+    std::size_t best = std::string_view::npos;
+    WireFormat format = WireFormat::Json;
+    for (const auto &known : KNOWN) {
+        const auto pos = accept.find(known.type);
+        if (pos < best) {
+            best = pos;
+            format = known.format;
+        }
+    }
+    return format;
+}
+
+std::string_view wireContentType(WireFormat format) {
+    switch (format) {
+    case WireFormat::MsgPack:
+        return "application/msgpack";
+    case WireFormat::Cbor:
+        return "application/cbor";
+    case WireFormat::Records:
+        return "application/vnd.sar.records";
+    case WireFormat::Json:
+        break;
+    }
+    return "application/json";
+}
+
+std::string encodeDocument(const nlohmann::json &document, WireFormat format) {
+    std::string out;
+    switch (format) {
+    case WireFormat::MsgPack:
+        nlohmann::json::to_msgpack(document, nlohmann::detail::output_adapter<char>(out));
+        break;
+    case WireFormat::Cbor:
+        nlohmann::json::to_cbor(document, nlohmann::detail::output_adapter<char>(out));
+        break;
+    default:
+        out = document.dump();
+        break;
+    }
+    return out;
+}
+
+FieldSet parseFieldSet(std::string_view fields) {
+    FieldSet out;
+    while (!fields.empty()) {
+        const auto comma = fields.find(',');
+        const std::string_view name = fields.substr(0, comma);
+        if (!name.empty())
+            out.emplace(name);
+        if (comma == std::string_view::npos)
+            break;
+        fields.remove_prefix(comma + 1);
+    }
+    return out;
+}
+
+template <typename Range> static double mean_of(const Range &values) {
+    if (values.empty())
+        return 0.0;
+    double sum = 0.0;
+    for (auto v : values)
+        sum += v;
+    return sum / static_cast<double>(values.size());
+}
+
+StateRecord toStateRecord(const std::string &symbol, const SymbolState &state) {
+    StateRecord record{};
+    std::memcpy(record.symbol, symbol.data(), std::min(symbol.size(), sizeof(record.symbol) - 1));
+    record.last_event_ns = state.lastEventNs;
+
+    if (state.lastTrade) {
+        record.trade_price = state.lastTrade->price;
+        record.trade_size = state.lastTrade->size;
+    }
+    if (state.lastQuote) {
+        record.bid_price = state.lastQuote->bid_price;
+        record.ask_price = state.lastQuote->ask_price;
+        record.bid_size = state.lastQuote->bid_size;
+        record.ask_size = state.lastQuote->ask_size;
+    }
+    if (state.lastBar) {
+        record.bar_ns = state.lastBarNs;
+        record.bar_close = state.lastBar->close;
+        record.bar_volume = state.lastBar->volume;
+    }
+
+    record.price_mean = mean_of(state.prices);
+    if (state.prices.size() > 1) {
+        double sq = 0.0;
+        for (double p : state.prices)
+            sq += (p - record.price_mean) * (p - record.price_mean);
+        record.price_stdev = std::sqrt(sq / static_cast<double>(state.prices.size()));
+    }
+    record.spread_mean = mean_of(state.spreads);
+    record.window_points = static_cast<std::uint32_t>(state.prices.size());
+    return record;
+}
+
+nlohmann::json stateJson(const StateRecord &r, const FieldSet &fields) {
+    nlohmann::json out = nlohmann::json::object();
+    putField(out, fields, "symbol", std::string(r.symbol, strnlen(r.symbol, sizeof(r.symbol))));
+    if (fields.empty() || fields.contains("lastEventTs"))
+        out["lastEventTs"] = r.last_event_ns > 0 ? formatTimestampNs(r.last_event_ns) : "";
+    putField(out, fields, "tradePrice", r.trade_price);
+    putField(out, fields, "tradeSize", r.trade_size);
+    putField(out, fields, "bidPrice", r.bid_price);
+    putField(out, fields, "askPrice", r.ask_price);
+    putField(out, fields, "bidSize", r.bid_size);
+    putField(out, fields, "askSize", r.ask_size);
+    if (fields.empty() || fields.contains("barTs"))
+        out["barTs"] = r.bar_ns > 0 ? formatTimestampNs(r.bar_ns) : "";
+    putField(out, fields, "barClose", r.bar_close);
+    putField(out, fields, "barVolume", r.bar_volume);
+    putField(out, fields, "priceMean", r.price_mean);
+    putField(out, fields, "priceStdev", r.price_stdev);
+    putField(out, fields, "spreadMean", r.spread_mean);
+    putField(out, fields, "windowPoints", r.window_points);
+    return out;
+}
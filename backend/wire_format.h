@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <nlohmann/json.hpp>
+
+#include "anomaly_store.h"
+#include "data_parser.h"
+
+/*
+
+Response encodings for bulk API consumers.
+
+/api/anomalies, /api/anomalies/history and /api/state pick their encoding from ?format= or,
+failing that, the Accept header:
+
+    json      application/json (default)
+    msgpack   application/msgpack, same document as the JSON
+    cbor      application/cbor, same document as the JSON
+    records   application/vnd.sar.records, a bare stream of fixed little-endian records:
+              AnomalyRecord (anomaly_store.h) for anomalies, StateRecord below for state.
+              X-Record-Type / X-Record-Size / X-Record-Version describe the stream.
+
+fields=a,b,c keeps only those keys in JSON/MessagePack/CBOR objects, e.g. fields=symbol,zscore
+to drop the English notes. Records are fixed, so they ignore it.
+
+*/
+
+enum class WireFormat { Json, MsgPack, Cbor, Records };
+
+WireFormat negotiateWireFormat(std::string_view formatParam, std::string_view accept);
+std::string_view wireContentType(WireFormat format);
+
+// JSON document in the requested structured encoding (not Records)
+std::string encodeDocument(const nlohmann::json &document, WireFormat format);
+
+// empty set means every field
+using FieldSet = std::unordered_set<std::string>;
+FieldSet parseFieldSet(std::string_view fields);
+
+// adds name: value to object unless the projection leaves it out
+template <typename T>
+void putField(nlohmann::json &object, const FieldSet &fields, const char *name, const T &value) {
+    if (fields.empty() || fields.contains(name))
+        object[name] = value;
+}
+
+// latest top of book, last trade, last bar and window baselines for one symbol
+struct StateRecord {
+    char symbol[16]; // NUL padded
+    std::int64_t last_event_ns;
+
+    double trade_price;
+    std::int64_t trade_size;
+
+    double bid_price;
+    double ask_price;
+    std::int64_t bid_size;
+    std::int64_t ask_size;
+
+    std::int64_t bar_ns; // bar start
+    double bar_close;
+    std::int64_t bar_volume;
+
+    double price_mean;  // over the price window
+    double price_stdev;
+    double spread_mean; // over the spread window
+
+    std::uint32_t window_points; // prices currently in the window
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(StateRecord) == 128, "state records are fixed 128-byte rows");
+static_assert(std::is_trivially_copyable_v<StateRecord>);
+
+constexpr std::uint32_t STATE_RECORD_VERSION = 1;
+
+StateRecord toStateRecord(const std::string &symbol, const SymbolState &state);
+
+nlohmann::json stateJson(const StateRecord &record, const FieldSet &fields);
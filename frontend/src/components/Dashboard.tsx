@@ -21,10 +21,16 @@ const ANOMALY_TYPE_LABELS = [
   'Liquidity',
   'Stale data',
   'Parse error',
+  'Market',
+  'Sector',
+  'Trade size',
+  'Trade flow',
+  'VWAP',
 ] as const;
 
 const ANOMALY_SOURCE_LABELS = ['Trade', 'Quote', 'Bar'] as const;
 const ANOMALY_DIRECTION_LABELS = ['Up', 'Down', 'None'] as const;
+const ANOMALY_SCOPE_LABELS = ['Unclassified', 'Idiosyncratic', 'Sector', 'Systemic'] as const;
 
 function anomalyTypeLabel(type: Anomaly['type']) {
   return ANOMALY_TYPE_LABELS[type] ?? 'Unknown';
@@ -38,6 +44,10 @@ function anomalyDirectionLabel(direction: Anomaly['direction']) {
   return ANOMALY_DIRECTION_LABELS[direction] ?? 'Unknown';
 }
 
+function anomalyScopeLabel(scope: Anomaly['scope']) {
+  return ANOMALY_SCOPE_LABELS[scope ?? 0] ?? 'Unknown';
+}
+
 function formatNumber(value: number) {
   return new Intl.NumberFormat('en-US', {
     maximumFractionDigits: 4,
@@ -167,6 +177,10 @@ export default function Dashboard({ tickers }: DashboardProps) {
                         <dt>Source</dt>
                         <dd>{anomalySourceLabel(anomaly.source)}</dd>
                       </div>
+                      <div>
+                        <dt>Move</dt>
+                        <dd>{anomalyScopeLabel(anomaly.scope)}</dd>
+                      </div>
                       <div>
                         <dt>Value</dt>
                         <dd>{formatNumber(anomaly.value)}</dd>
@@ -179,6 +193,16 @@ export default function Dashboard({ tickers }: DashboardProps) {
                         <dt>Z-score</dt>
                         <dd>{formatNumber(anomaly.zscore)}</dd>
                       </div>
+                      <div>
+                        <dt>Events</dt>
+                        <dd>
+                          {`${anomaly.eventCount ?? 1}${anomaly.active ? ' (ongoing)' : ''}`}
+                        </dd>
+                      </div>
+                      <div>
+                        <dt>Peak z</dt>
+                        <dd>{formatNumber(anomaly.peakZscore ?? anomaly.zscore)}</dd>
+                      </div>
                       <div>
                         <dt>Lower</dt>
                         <dd>{formatNumber(anomaly.lower)}</dd>
@@ -1,9 +1,11 @@
-export type AnomalyType = 0 | 1 | 2 | 3 | 4 | 5 | 6 | 7 | 8;
+export type AnomalyType = 0 | 1 | 2 | 3 | 4 | 5 | 6 | 7 | 8 | 9 | 10 | 11 | 12 | 13;
 
 export type AnomalySource = 0 | 1 | 2;
 
 export type AnomalyDirection = 0 | 1 | 2;
 
+export type AnomalyScope = 0 | 1 | 2 | 3;
+
 export type Anomaly = {
   type: AnomalyType;
   source: AnomalySource;
@@ -17,5 +19,12 @@ export type Anomaly = {
   lower: number;
   upper: number;
   k: number;
+  scope?: AnomalyScope;
+  episodeId?: number;
+  active?: boolean;
+  endTimestamp?: string;
+  durationMs?: number;
+  eventCount?: number;
+  peakZscore?: number;
   note: string;
 };
@@ -14,6 +14,13 @@ type Anomaly = {
   lower?: number;
   upper?: number;
   k?: number;
+  scope?: number;
+  episodeId?: number;
+  active?: boolean;
+  endTimestamp?: string;
+  durationMs?: number;
+  eventCount?: number;
+  peakZscore?: number;
   note?: string;
 };
 